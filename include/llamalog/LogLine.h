@@ -46,8 +46,11 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SO
 
 #include <windows.h>
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <cwchar>
 #include <exception>
 #include <memory>
 #include <new>
@@ -55,6 +58,12 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SO
 #include <string_view>
 #include <system_error>
 #include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(_HAS_CXX20) && _HAS_CXX20
+#include <span>
+#endif
 
 #ifndef LLAMALOG_LOGLINE_SIZE
 /// @brief The size of a log line in bytes.
@@ -102,6 +111,97 @@ struct escape final {  // NOLINT(readability-identifier-naming): Infrastructure
 	const T& value;  ///< @brief The parameter value.
 };
 
+/// @brief Wrap a string literal in this type to store only its address and length instead of a copy of the string.
+/// @details Logging the argument takes constant time regardless of the length of the string. The argument supports
+/// the same formatting options as regular strings including `escape`.
+/// @note The string MUST have static storage duration because it is accessed when the message is formatted. With C++20
+/// this is enforced by the compiler, i.e. a `literal` can only be created from a constant expression.
+struct literal final {  // NOLINT(readability-identifier-naming): Infrastructure is less prominent in lower case.
+	/// @brief Create a new wrapper for a string literal.
+	/// @details The string ends at the first null character or at the end of the array.
+	/// @tparam kSize The size of the string literal including the terminating null character.
+	/// @param str The string literal.
+	template <std::size_t kSize>
+#if defined(_HAS_CXX20) && _HAS_CXX20
+	consteval
+#else
+	constexpr
+#endif
+		explicit literal(const char (&str)[kSize]) noexcept
+		: value(str)
+		, length(GetLength(str, kSize)) {
+		// empty
+	}
+
+	const char* value;   ///< @brief The address of the string.
+	std::size_t length;  ///< @brief The number of characters without the terminating null character.
+
+private:
+	/// @brief Get the length of a string without reading beyond the end of the array.
+	/// @param str The string.
+	/// @param size The size of the array.
+	/// @return The number of characters before the first null character or @p size.
+	[[nodiscard]] static constexpr std::size_t GetLength(const char* const str, const std::size_t size) noexcept {
+		std::size_t length = 0;
+		while (length < size && str[length]) {
+			++length;
+		}
+		return length;
+	}
+};
+
+/// @brief Wrap binary data in this type to print the bytes as hex values.
+/// @details The bytes are copied to the buffer and encoded when the message is formatted. A maximum of 2^16 bytes is
+/// printed. The format pattern supports the following options in any order: `X` for upper case digits, `s` to separate
+/// the bytes by spaces, `o` and `a` to print lines of 16 bytes with a leading offset and a trailing ASCII column
+/// respectively and `.n` to print at most n bytes followed by `...`.
+struct hexdump final {  // NOLINT(readability-identifier-naming): Infrastructure is less prominent in lower case.
+	/// @brief Create a new wrapper for binary data.
+	/// @param data The address of the data.
+	/// @param size The number of bytes.
+	constexpr hexdump(_In_reads_bytes_(size) const void* const data, const std::size_t size) noexcept
+		: value(data)
+		, length(size) {
+		// empty
+	}
+
+	const void* value;   ///< @brief The address of the data.
+	std::size_t length;  ///< @brief The number of bytes.
+};
+
+namespace internal {
+
+/// @brief A deleter which returns the heap buffer of a `LogLine` to the pool of buffers.
+struct HeapBufferDeleter final {
+	/// @brief Release the buffer.
+	/// @param ptr The buffer.
+	void operator()(_In_opt_ std::byte* ptr) const noexcept;
+};
+
+/// @brief Temporary strings of at least this size in bytes are moved to the buffer instead of being copied.
+constexpr std::size_t kMinMovedStringBytes = 256u;
+
+/// @brief `true` if contiguous ranges of this type are stored inline in the buffer.
+/// @details All arithmetic types except `bool` and the character types are supported.
+/// @tparam T The type of the elements.
+template <typename T>
+constexpr bool kIsRangeElement = std::is_arithmetic_v<T> && !std::is_same_v<T, bool> && !std::is_same_v<T, char> && !std::is_same_v<T, wchar_t> && !std::is_same_v<T, char16_t> && !std::is_same_v<T, char32_t>;
+
+}  // namespace internal
+
+/// @brief Set the functions used for allocating additional buffers if the arguments do not fit into a `LogLine`.
+/// @details Released buffers of up to 64 KB are kept in a pool and re-used for the next events. Each buffer is always
+/// released using the function which was set at the time of its allocation. Buffers of a previous allocator are never
+/// re-used after the call.
+/// @note The function MAY be called while other threads are logging. However, a previous @p deallocate MUST remain
+/// usable as long as any events allocated before the call still exist. Therefore the function SHOULD be called before
+/// logging starts.
+/// @param allocate A function returning memory of at least `size` bytes aligned to `__STDCPP_DEFAULT_NEW_ALIGNMENT__`.
+/// The function MUST throw an exception if no memory is available. Set to `nullptr` to use `operator new`.
+/// @param deallocate A function releasing the memory with `size` being the same value as used for @p allocate. Set to
+/// `nullptr` to use `operator delete`.
+void SetHeapBufferAllocator(_In_opt_ void* (*allocate)(std::size_t size), _In_opt_ void (*deallocate)(void* ptr, std::size_t size) noexcept) noexcept;
+
 /// @brief The class contains all data for formatting and output which happens asynchronously.
 /// @details @internal The stack buffer is allocated in the base class for a better memory layout.
 /// @copyright The interface of this class is based on `class NanoLogLine` from NanoLog.
@@ -329,12 +429,24 @@ public:
 	/// @copyright Based on `NanoLogLine::operator<<(const char*)` from NanoLog.
 	LogLine& operator<<(const std::string& arg);
 
+	/// @brief Add a temporary `std::string` as a log argument. @details Strings of at least
+	/// `internal::kMinMovedStringBytes` bytes are moved to the buffer instead of being copied and are not truncated.
+	/// @param arg The argument.
+	/// @return The current object for method chaining.
+	LogLine& operator<<(std::string&& arg);
+
 	/// @brief Add a log argument. @details The value is copied into the buffer. A maximum of 2^16 characters is printed.
 	/// @param arg The argument.
 	/// @return The current object for method chaining.
 	/// @copyright Based on `NanoLogLine::operator<<(const char*)` from NanoLog.
 	LogLine& operator<<(const std::wstring& arg);
 
+	/// @brief Add a temporary `std::wstring` as a log argument. @details Strings of at least
+	/// `internal::kMinMovedStringBytes` bytes are moved to the buffer instead of being copied and are not truncated.
+	/// @param arg The argument.
+	/// @return The current object for method chaining.
+	LogLine& operator<<(std::wstring&& arg);
+
 	/// @brief Add a log argument. @details The value is copied into the buffer. A maximum of 2^16 characters is printed.
 	/// @param arg The argument.
 	/// @return The current object for method chaining.
@@ -347,9 +459,57 @@ public:
 	/// @copyright Based on `NanoLogLine::operator<<(const char*)` from NanoLog.
 	LogLine& operator<<(const std::wstring_view& arg);
 
+	/// @brief Add a string literal as an argument. Only the address and length of the string are stored.
+	/// @param arg The argument.
+	/// @return The current object for method chaining.
+	LogLine& operator<<(const literal& arg);
+
+	/// @brief Add binary data as an argument. @details The bytes are copied into the buffer. A maximum of 2^16 bytes is printed.
+	/// @param arg The argument.
+	/// @return The current object for method chaining.
+	LogLine& operator<<(const hexdump& arg);
+
+	/// @brief Add the elements of a `std::vector` as a log argument. @details The values are copied into the buffer.
+	/// A maximum of 2^16 elements is printed.
+	/// @tparam T The type of the elements.
+	/// @tparam A The type of the allocator.
+	/// @param arg The argument.
+	/// @return The current object for method chaining.
+	template <typename T, typename A, typename std::enable_if_t<internal::kIsRangeElement<T>, int> = 0>
+	LogLine& operator<<(const std::vector<T, A>& arg) {
+		WriteRange(arg.data(), arg.size());
+		return *this;
+	}
+
+	/// @brief Add the elements of a `std::array` as a log argument. @details The values are copied into the buffer.
+	/// A maximum of 2^16 elements is printed.
+	/// @tparam T The type of the elements.
+	/// @tparam kSize The number of elements.
+	/// @param arg The argument.
+	/// @return The current object for method chaining.
+	template <typename T, std::size_t kSize, typename std::enable_if_t<internal::kIsRangeElement<T>, int> = 0>
+	LogLine& operator<<(const std::array<T, kSize>& arg) {
+		WriteRange(arg.data(), kSize);
+		return *this;
+	}
+
+#if defined(_HAS_CXX20) && _HAS_CXX20
+	/// @brief Add the elements of a `std::span` as a log argument. @details The values are copied into the buffer.
+	/// A maximum of 2^16 elements is printed.
+	/// @tparam T The type of the elements.
+	/// @tparam kExtent The number of elements or `std::dynamic_extent`.
+	/// @param arg The argument.
+	/// @return The current object for method chaining.
+	template <typename T, std::size_t kExtent, typename std::enable_if_t<internal::kIsRangeElement<std::remove_cv_t<T>>, int> = 0>
+	LogLine& operator<<(const std::span<T, kExtent>& arg) {
+		WriteRange<std::remove_cv_t<T>>(arg.data(), arg.size());
+		return *this;
+	}
+#endif
+
 	/// @brief Add a `std::exception` as an argument.
 	/// @details If the `std::exception` is of type `std::system_error` the additional details are made available for formatting.
-	/// @note The function MUST be called from within a catch block.
+	/// The function MAY be called outside of a catch block because it does not use the current exception.
 	/// @param arg The argument.
 	/// @return The current object for method chaining.
 	LogLine& operator<<(const std::exception& arg);
@@ -366,6 +526,12 @@ public:
 		return *this;
 	}
 
+	/// @brief Ensure that the buffer can hold at least @p additionalBytes more bytes without further allocations.
+	/// @details Use this function to avoid multiple re-allocations when the size of the arguments is known in advance.
+	/// @param additionalBytes The number of bytes that will be appended. Values exceeding the maximum capacity are
+	/// reduced to the maximum.
+	void Reserve(std::size_t additionalBytes);
+
 public:
 	/// @brief Get the timestamp for the log event.
 	/// @return The timestamp.
@@ -379,6 +545,21 @@ public:
 		GetSystemTimeAsFileTime(&m_timestamp);
 	}
 
+	/// @brief Get the sequence number of the log event.
+	/// @details The sequence number reflects the order in which events have been added to the logger. Events might
+	/// reach the writers in a different order because errors are processed before other events.
+	/// @return The sequence number.
+	[[nodiscard]] std::uint32_t GetSequence() const noexcept {
+		return m_sequence;
+	}
+
+	/// @brief Set the sequence number of the log event.
+	/// @note Not part of the constructor to support setting it from the logger.
+	/// @param sequence The sequence number.
+	void SetSequence(const std::uint32_t sequence) noexcept {
+		m_sequence = sequence;
+	}
+
 	/// @brief Get the priority.
 	/// @return The priority.
 	[[nodiscard]] Priority GetPriority() const noexcept {
@@ -428,6 +609,22 @@ public:
 	/// @return The log message.
 	[[nodiscard]] std::string GetLogMessage() const;
 
+	/// @brief Calculate a hash value from the message pattern and the encoded arguments.
+	/// @details The value is used for detecting repeated messages without formatting. Arguments holding pointers to
+	/// heap memory produce different values even if the formatted output is the same.
+	/// @return A hash value.
+	[[nodiscard]] std::uint64_t GetHash() const noexcept;
+
+	/// @brief Copy the encoded arguments for a later comparison using `#HasEncodedArguments`.
+	/// @param arguments Receives the encoded arguments. The existing capacity is re-used.
+	void CopyEncodedArgumentsTo(std::vector<std::byte>& arguments) const;
+
+	/// @brief Check if the encoded arguments are the same as a copy created by `#CopyEncodedArgumentsTo`.
+	/// @details The comparison has the same restrictions as `#GetHash`.
+	/// @param arguments The encoded arguments of another `LogLine`.
+	/// @return `true` if the encoded arguments are identical.
+	[[nodiscard]] bool HasEncodedArguments(const std::vector<std::byte>& arguments) const noexcept;
+
 	/// @brief Copy a log argument of a custom type to the argument buffer.
 	/// @details This function handles types which are trivially copyable.
 	/// @remark Include `<llamalog/custom_types.h>` in your implementation file before calling this function.
@@ -456,6 +653,17 @@ public:
 	template <typename T, bool kEscaped = false, typename std::enable_if_t<!std::is_trivially_copyable_v<T>, int> = 0>
 	LogLine& AddCustomArgument(const T& arg);
 
+	/// @brief Move a log argument of a custom type to the argument buffer.
+	/// @details This function handles temporary objects of types which are not trivially copyable. The object is move
+	/// constructed in the buffer. However, the type MUST also support copy construction.
+	/// @note The type @p T MUST be both copy constructible and either nothrow move constructible or nothrow copy constructible.
+	/// @remark Include `<llamalog/custom_types.h>` in your implementation file before calling this function.
+	/// @tparam T The type of the argument.
+	/// @param arg The object.
+	/// @return The current object for method chaining.
+	template <typename T, bool kEscaped = false, typename std::enable_if_t<!std::is_trivially_copyable_v<T> && !std::is_reference_v<T> && !std::is_const_v<T>, int> = 0>
+	LogLine& AddCustomArgument(T&& arg);
+
 	/// @brief Copy a log argument of a pointer to a custom type to the argument buffer.
 	/// @details This function handles types which are not trivially copyable. However, the type MUST support copy construction.
 	/// @note The type @p T MUST be both copy constructible and either nothrow move constructible or nothrow copy constructible.
@@ -528,6 +736,16 @@ private:
 	/// @copyright Derived from `NanoLogLine::encode_c_string` from NanoLog.
 	void WriteString(_In_reads_(len) const wchar_t* __restrict arg, std::size_t len);
 
+	/// @brief Copy a contiguous range of values to the argument buffer.
+	/// @details @internal The internal layout is the `TypeId` followed by the `TypeId` of the elements, the number of
+	/// elements, optional padding as required and finally the elements.
+	/// @remarks The function is instantiated in the translation unit for all types of `internal::kIsRangeElement`.
+	/// @tparam T The type of the elements.
+	/// @param arg The address of the first element.
+	/// @param count The number of elements.
+	template <typename T>
+	void WriteRange(_In_reads_(count) const T* __restrict arg, std::size_t count);
+
 	/// @brief Add an exception object to the argument buffer.
 	/// @param message The exception message.
 	/// @param pBaseException The (optional) `BaseException` object carrying additional logging information.
@@ -564,19 +782,23 @@ private:
 private:
 	/// @brief The stack buffer used for small payloads.
 	/// @copyright Same as `NanoLogLine::m_stack_buffer` from NanoLog.
-	std::byte m_stackBuffer[LLAMALOG_LOGLINE_SIZE                     // target size
-							- sizeof(Priority)                        // m_priority
-							- sizeof(bool)                            // m_hasNonTriviallyCopyable
-							- sizeof(FILETIME)                        // m_timestamp
-							- sizeof(const char*) * 3                 // m_file, m_function, m_message
-							- sizeof(DWORD)                           // m_threadId
-							- sizeof(std::uint32_t)                   // m_line
-							- sizeof(Size) * 2                        // m_used, m_size
-							- sizeof(std::unique_ptr<std::byte[]>)];  // m_heapBuffer
-
-	Priority m_priority;                     ///< @brief The entry's priority.
-	bool m_hasNonTriviallyCopyable = false;  ///< @brief `true` if at least one argument needs special handling on buffer operations. @hideinitializer
-	FILETIME m_timestamp;                    ///< @brief The timestamp at which this entry had been created.
+	std::byte m_stackBuffer[LLAMALOG_LOGLINE_SIZE                                                  // target size
+							- sizeof(Priority)                                                     // m_priority
+							- sizeof(bool)                                                         // m_hasNonTriviallyCopyable
+							- sizeof(bool)                                                         // m_hasNonTriviallyRelocatable
+							- sizeof(std::uint32_t)                                                // m_sequence
+							- sizeof(FILETIME)                                                     // m_timestamp
+							- sizeof(const char*) * 3                                              // m_file, m_function, m_message
+							- sizeof(DWORD)                                                        // m_threadId
+							- sizeof(std::uint32_t)                                                // m_line
+							- sizeof(Size) * 2                                                     // m_used, m_size
+							- sizeof(std::unique_ptr<std::byte[], internal::HeapBufferDeleter>)];  // m_heapBuffer
+
+	Priority m_priority;                        ///< @brief The entry's priority.
+	bool m_hasNonTriviallyCopyable = false;     ///< @brief `true` if at least one argument needs special handling on buffer operations. @hideinitializer
+	bool m_hasNonTriviallyRelocatable = false;  ///< @brief `true` if at least one argument MUST NOT be moved using `std::memcpy`. @hideinitializer
+	std::uint32_t m_sequence = 0;               ///< @brief The sequence number assigned by the logger. @hideinitializer
+	FILETIME m_timestamp;                       ///< @brief The timestamp at which this entry had been created.
 
 	/// @details Only a pointer is stored, i.e. the string MUST NOT go out of scope.
 	const char* __restrict m_file;  ///< @brief The source file of the log statement creating this entry.
@@ -597,7 +819,7 @@ private:
 	Size m_size = sizeof(m_stackBuffer);  ///< @brief The current capacity of the buffer in bytes.
 
 	/// @copyright Same as `NanoLogLine::m_heap_buffer` from NanoLog.
-	std::unique_ptr<std::byte[]> m_heapBuffer;  ///< The buffer on the heap if the stack buffer became too small.
+	std::unique_ptr<std::byte[], internal::HeapBufferDeleter> m_heapBuffer;  ///< The buffer on the heap if the stack buffer became too small.
 };
 
 #ifdef __clang_analyzer__
@@ -620,3 +842,154 @@ llamalog::LogLine& operator<<(llamalog::LogLine& logLine, std::align_val_t arg);
 /// @param arg The argument.
 /// @return The @p logLine for method chaining.
 llamalog::LogLine& operator<<(llamalog::LogLine& logLine, const std::align_val_t* arg);
+
+namespace llamalog::internal {
+
+/// @brief `true` if the argument is a narrow C string or character array.
+template <typename T>
+constexpr bool kIsCString = std::is_same_v<std::decay_t<T>, const char*> || std::is_same_v<std::decay_t<T>, char*>;
+
+/// @brief `true` if the argument is a wide C string or character array.
+template <typename T>
+constexpr bool kIsWideCString = std::is_same_v<std::decay_t<T>, const wchar_t*> || std::is_same_v<std::decay_t<T>, wchar_t*>;
+
+/// @brief `true` if the argument is wrapped in `escape`.
+template <typename T>
+constexpr bool kIsEscape = false;
+
+/// @brief `true` if the argument is wrapped in `escape`.
+template <typename T>
+constexpr bool kIsEscape<escape<T>> = true;
+
+/// @brief `true` if the argument is a contiguous range which is stored inline.
+template <typename T>
+constexpr bool kIsRange = false;
+
+/// @brief `true` if the argument is a contiguous range which is stored inline.
+template <typename T, typename A>
+constexpr bool kIsRange<std::vector<T, A>> = kIsRangeElement<T>;
+
+/// @brief `true` if the argument is a contiguous range which is stored inline.
+template <typename T, std::size_t kSize>
+constexpr bool kIsRange<std::array<T, kSize>> = kIsRangeElement<T>;
+
+#if defined(_HAS_CXX20) && _HAS_CXX20
+/// @brief `true` if the argument is a contiguous range which is stored inline.
+template <typename T, std::size_t kExtent>
+constexpr bool kIsRange<std::span<T, kExtent>> = kIsRangeElement<std::remove_cv_t<T>>;
+#endif
+
+/// @brief Get the length of an argument if it is a C string.
+/// @details This is the only place where the length of a C string is calculated when logging using `#Log`.
+/// @tparam T The type of the argument.
+/// @param arg The argument.
+/// @return The number of characters for C strings, else 0.
+template <typename T>
+[[nodiscard]] std::size_t GetStringLength(const T& arg) noexcept {
+	if constexpr (kIsCString<T>) {
+		const char* const str = arg;
+		return str ? std::strlen(str) : 0;
+	} else if constexpr (kIsWideCString<T>) {
+		const wchar_t* const str = arg;
+		return str ? std::wcslen(str) : 0;
+	} else {
+		return 0;
+	}
+}
+
+/// @brief Get the number of bytes required for encoding an argument in a `LogLine`.
+/// @details The value includes the worst case for padding. Types without a fixed encoding return 0 and let the buffer
+/// grow on demand. An estimate which is too low only costs an additional allocation.
+/// @tparam T The type of the argument as passed to `AddArguments`, i.e. a reference type for lvalues.
+/// @param arg The argument.
+/// @param length The length of the argument as returned by `GetStringLength`.
+/// @return The maximum number of bytes required for the argument.
+template <typename T>
+[[nodiscard]] constexpr std::size_t GetEncodedSize([[maybe_unused]] const std::remove_reference_t<T>& arg, [[maybe_unused]] const std::size_t length) noexcept {
+	using Type = std::decay_t<T>;
+	constexpr std::size_t kTypeIdSize = sizeof(std::uint8_t);
+	constexpr std::size_t kStringSize = kTypeIdSize + sizeof(LogLine::Length);
+
+	if constexpr (!std::is_reference_v<T> && !std::is_const_v<T> && (std::is_same_v<Type, std::string> || std::is_same_v<Type, std::wstring>)) {
+		if (arg.size() * sizeof(typename Type::value_type) >= kMinMovedStringBytes) {
+			// temporary strings are moved and stored as a custom argument
+			return kTypeIdSize + sizeof(LogLine::Align) + sizeof(void*) + sizeof(LogLine::Size) + alignof(Type) - 1 + sizeof(Type);
+		}
+	}
+	if constexpr (std::is_arithmetic_v<Type>) {
+		return kTypeIdSize + sizeof(Type);
+	} else if constexpr (kIsCString<T>) {
+		return kStringSize + length;
+	} else if constexpr (kIsWideCString<T>) {
+		return kStringSize + alignof(wchar_t) - 1 + length * sizeof(wchar_t);
+	} else if constexpr (std::is_same_v<Type, std::string> || std::is_same_v<Type, std::string_view>) {
+		return kStringSize + arg.size();
+	} else if constexpr (std::is_same_v<Type, std::wstring> || std::is_same_v<Type, std::wstring_view>) {
+		return kStringSize + alignof(wchar_t) - 1 + arg.size() * sizeof(wchar_t);
+	} else if constexpr (std::is_pointer_v<Type> && std::is_arithmetic_v<std::remove_cv_t<std::remove_pointer_t<Type>>>) {
+		return kTypeIdSize + alignof(std::remove_pointer_t<Type>) - 1 + sizeof(std::remove_pointer_t<Type>);
+	} else if constexpr (std::is_same_v<Type, const void*> || std::is_same_v<Type, void*> || std::is_null_pointer_v<Type>) {
+		return kTypeIdSize + sizeof(void*);
+	} else if constexpr (std::is_same_v<Type, literal>) {
+		return kTypeIdSize + alignof(literal) - 1 + sizeof(literal);
+	} else if constexpr (std::is_same_v<Type, hexdump>) {
+		return kStringSize + arg.length;
+	} else if constexpr (kIsRange<Type>) {
+		using Element = std::remove_cv_t<typename Type::value_type>;
+		return kTypeIdSize * 2 + sizeof(LogLine::Length) + alignof(Element) - 1 + arg.size() * sizeof(Element);
+	} else if constexpr (kIsEscape<Type>) {
+		return GetEncodedSize<decltype(arg.value)>(arg.value, length);
+	} else {
+		return 0;
+	}
+}
+
+/// @brief Add a single argument to a `LogLine`.
+/// @details C strings are added using the pre-calculated @p length to prevent a second call of `std::strlen`.
+/// @tparam T The type of the argument.
+/// @param logLine The `LogLine`.
+/// @param arg The argument.
+/// @param length The length of the argument as returned by `GetStringLength`.
+template <typename T>
+void AddArgument(LogLine& logLine, T&& arg, [[maybe_unused]] const std::size_t length) {
+	if constexpr (kIsCString<T>) {
+		if (const char* const str = arg; str) {
+			logLine << std::string_view(str, length);
+			return;
+		}
+	} else if constexpr (kIsWideCString<T>) {
+		if (const wchar_t* const str = arg; str) {
+			logLine << std::wstring_view(str, length);
+			return;
+		}
+	}
+	logLine << std::forward<T>(arg);
+}
+
+/// @brief Helper for `AddArguments` which gets the indexes of the arguments.
+/// @tparam kIndex The indexes of the arguments.
+/// @tparam T The types of the arguments.
+/// @param logLine The `LogLine`.
+/// @param args The arguments.
+template <std::size_t... kIndex, typename... T>
+void AddIndexedArguments(LogLine& logLine, std::index_sequence<kIndex...> /* unused */, T&&... args) {
+	const std::array<std::size_t, sizeof...(T)> lengths = {GetStringLength(args)...};
+	logLine.Reserve((GetEncodedSize<T>(args, lengths[kIndex]) + ...));
+	(AddArgument(logLine, std::forward<T>(args), lengths[kIndex]), ...);
+}
+
+/// @brief Add all arguments to a `LogLine` with at most a single allocation for arguments of known size.
+/// @details The size of all arguments is calculated before the first argument is added.
+/// @tparam T The types of the arguments.
+/// @param logLine The `LogLine`.
+/// @param args The arguments.
+/// @return The @p logLine for method chaining.
+template <typename... T>
+LogLine& AddArguments(LogLine& logLine, T&&... args) {
+	if constexpr (sizeof...(T) != 0) {
+		AddIndexedArguments(logLine, std::index_sequence_for<T...>(), std::forward<T>(args)...);
+	}
+	return logLine;
+}
+
+}  // namespace llamalog::internal
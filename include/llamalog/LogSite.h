@@ -0,0 +1,256 @@
+/*
+Copyright 2020 Michael Beckh
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/// @file
+/// @brief Runtime switches for individual logging statements.
+#pragma once
+
+#include <llamalog/LogLine.h>
+
+#include <sal.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace llamalog {
+
+/// @brief Settings for limiting the number of messages logged by a `LogSite`.
+/// @details The checks are done by the calling thread before any arguments are encoded.
+struct Sampling final {
+	/// @brief The type of the limit.
+	enum class Mode : std::uint8_t {
+		kNone,         ///< @brief Log every message.
+		kPerSecond,    ///< @brief Log at most `value` messages per second.
+		kEveryNth,     ///< @brief Log only every `value`-th message.
+		kProbability   ///< @brief Log a message with the probability `value / 2^32`.
+	};
+
+	/// @brief Do not limit the output.
+	/// @return A new `Sampling` object.
+	[[nodiscard]] static constexpr Sampling None() noexcept {
+		return {Mode::kNone, 0};
+	}
+
+	/// @brief Log at most @p count messages per second using a token bucket which holds up to @p count tokens.
+	/// @param count The maximum number of messages per second. A value of 0 suppresses all messages.
+	/// @return A new `Sampling` object.
+	[[nodiscard]] static constexpr Sampling PerSecond(const std::uint32_t count) noexcept {
+		return {Mode::kPerSecond, count};
+	}
+
+	/// @brief Log only the first and then every @p n-th message.
+	/// @param n The sampling interval. A value of 0 suppresses all messages.
+	/// @return A new `Sampling` object.
+	[[nodiscard]] static constexpr Sampling EveryNth(const std::uint32_t n) noexcept {
+		return {Mode::kEveryNth, n};
+	}
+
+	/// @brief Log a message with a certain probability.
+	/// @param probability The probability in the range [0, 1].
+	/// @return A new `Sampling` object.
+	[[nodiscard]] static constexpr Sampling Probability(const double probability) noexcept {
+		constexpr double kScale = 4294967296.0;  // 2^32
+		if (probability >= 1) {
+			return None();
+		}
+		return {Mode::kProbability, probability <= 0 ? 0 : static_cast<std::uint32_t>(probability * kScale)};
+	}
+
+	Mode mode;            ///< @brief The type of the limit.
+	std::uint32_t value;  ///< @brief The parameter for the limit.
+};
+
+/// @brief The static state of a single logging statement.
+/// @details Each expansion of `#LLAMALOG_LOG` owns a static instance of this class. The instance is registered in a
+/// global registry when the statement is executed for the first time. Afterwards, checking if a site without
+/// `Sampling` is enabled costs a single relaxed load and comparison. Messages with `Priority::kError` or higher are
+/// never suppressed, i.e. disabling a site or setting its `Sampling` affects only messages with lower priorities.
+/// @note All instances MUST have static storage duration because the registry stores references to them.
+class LogSite final {
+public:
+	/// @brief Creates a new site. The constructor is `constexpr` to allow constant initialization of static instances.
+	/// @param file The file name. This MUST be a literal string, typically from `__FILE__`.
+	/// @param line The line number, typically from `__LINE__`.
+	/// @param function The function name, typically from `__func__`, or `nullptr` if the name is passed to `#IsEnabled`.
+	/// @param sampling The default `Sampling` for this site.
+	constexpr LogSite(_In_z_ const char* __restrict const file, const std::uint32_t line, _In_opt_z_ const char* __restrict const function, const Sampling sampling = Sampling::None()) noexcept
+		: m_file(file)
+		, m_function(function)
+		, m_line(line)
+		, m_defaultSampling(sampling)
+		, m_samplingMode(sampling.mode)
+		, m_samplingValue(sampling.value) {
+		// empty
+	}
+	LogSite(const LogSite&) = delete;  ///< @nocopyconstructor
+	LogSite(LogSite&&) = delete;       ///< @nomoveconstructor
+	~LogSite() noexcept = default;
+
+public:
+	LogSite& operator=(const LogSite&) = delete;  ///< @noassignmentoperator
+	LogSite& operator=(LogSite&&) = delete;       ///< @nomoveoperator
+
+public:
+	/// @brief Check if the site is enabled and register it on first use.
+	/// @param priority The `#Priority` of the message. The value is used for reporting suppressed messages.
+	/// @param pOwner The value returned by `Logger::GetSiteOwner` for the target of the message or `nullptr` for the
+	/// default logger. The value is used for reporting suppressed messages.
+	/// @return `true` if the logging statement should be executed.
+	[[nodiscard]] bool IsEnabled(const Priority priority, const void* const pOwner = nullptr) noexcept {
+		const State state = m_state.load(std::memory_order_relaxed);
+		return state == State::kEnabled || (state == State::kDisabled ? priority >= Priority::kError : Check(priority, pOwner));
+	}
+
+	/// @brief Check if the site is enabled and register it on first use with the name of the calling function.
+	/// @details The macros for return values declare the site inside a lambda where `__func__` does not name the calling
+	/// function. Such a site is created without a function name to allow constant initialization.
+	/// @param priority The `#Priority` of the message. The value is used for reporting suppressed messages.
+	/// @param function The function name, typically from `__func__`. The value is only used for the first call.
+	/// @param pOwner The value returned by `Logger::GetSiteOwner` for the target of the message or `nullptr` for the
+	/// default logger. The value is used for reporting suppressed messages.
+	/// @return `true` if the logging statement should be executed.
+	[[nodiscard]] bool IsEnabled(const Priority priority, _In_z_ const char* const function, const void* const pOwner = nullptr) noexcept {
+		if (m_state.load(std::memory_order_relaxed) == State::kUnregistered) {
+			const char* expected = nullptr;
+			m_function.compare_exchange_strong(expected, function, std::memory_order_relaxed);
+		}
+		return IsEnabled(priority, pOwner);
+	}
+
+	/// @brief Enable or disable this site.
+	/// @param enabled `true` to enable logging for this site.
+	void SetEnabled(bool enabled) noexcept;
+
+	/// @brief Change the `Sampling` of this site.
+	/// @param sampling The new `Sampling`.
+	void SetSampling(Sampling sampling) noexcept;
+
+	/// @brief Get the file name of the site.
+	/// @return The file name.
+	[[nodiscard]] _Ret_z_ const char* GetFile() const noexcept {
+		return m_file;
+	}
+
+	/// @brief Get the line number of the site.
+	/// @return The line number.
+	[[nodiscard]] std::uint32_t GetLine() const noexcept {
+		return m_line;
+	}
+
+	/// @brief Get the function name of the site.
+	/// @return The function name or an empty string if the name has not yet been set.
+	[[nodiscard]] _Ret_z_ const char* GetFunction() const noexcept {
+		const char* const function = m_function.load(std::memory_order_relaxed);
+		return function ? function : "";
+	}
+
+	/// @brief Get the logger which receives the report of suppressed messages.
+	/// @details If a site sends messages to more than one logger, the target of the last suppressed message is used.
+	/// @return The value passed to `#IsEnabled` for the last suppressed message.
+	[[nodiscard]] const void* GetOwner() const noexcept {
+		return m_pOwner.load(std::memory_order_relaxed);
+	}
+
+	/// @brief Get the number of messages suppressed by `Sampling` since the last call and reset the counter.
+	/// @param priority Receives the `#Priority` of the last suppressed message.
+	/// @return The number of suppressed messages.
+	[[nodiscard]] std::uint32_t TakeSuppressed(Priority& priority) noexcept;
+
+private:
+	/// @brief The state of a site.
+	enum class State : std::uint8_t {
+		kUnregistered,  ///< @brief The site has not yet been executed.
+		kEnabled,       ///< @brief Logging is enabled without any `Sampling`.
+		kSampled,       ///< @brief Logging is enabled but limited by `Sampling`.
+		kDisabled       ///< @brief Logging is disabled.
+	};
+
+	/// @brief The slow path of `#IsEnabled`.
+	/// @param priority The `#Priority` of the message.
+	/// @param pOwner The target of the message.
+	/// @return `true` if the logging statement should be executed.
+	bool Check(Priority priority, const void* pOwner) noexcept;
+
+	/// @brief Add the site to the registry and apply all rules set by `#SetLogSitesEnabled` and `#SetLogSitesSampling`.
+	/// @return The state after registration.
+	State Register() noexcept;
+
+	/// @brief Get the state for an enabled site.
+	/// @return Either `State::kEnabled` or `State::kSampled`.
+	[[nodiscard]] State GetEnabledState() const noexcept {
+		return m_samplingMode.load(std::memory_order_relaxed) == Sampling::Mode::kNone ? State::kEnabled : State::kSampled;
+	}
+
+	/// @brief Change the `Sampling` without updating the state.
+	/// @param sampling The new `Sampling`.
+	void StoreSampling(Sampling sampling) noexcept;
+
+	/// @brief Check if a message passes the `Sampling`.
+	/// @return `true` if the message should be logged.
+	[[nodiscard]] bool Sample() noexcept;
+
+private:
+	const char* const m_file;                                 ///< @brief The file name.
+	std::atomic<const char*> m_function;                      ///< @brief The function name or `nullptr` if not yet set.
+	const std::uint32_t m_line;                               ///< @brief The line number.
+	const Sampling m_defaultSampling;                         ///< @brief The `Sampling` set in the constructor.
+	std::atomic<State> m_state = State::kUnregistered;        ///< @brief The current state. @hideinitializer
+	std::atomic<Sampling::Mode> m_samplingMode;               ///< @brief The current type of `Sampling`.
+	std::atomic<Priority> m_suppressedPriority = Priority{};  ///< @brief The `#Priority` of the last suppressed message. @hideinitializer
+	std::atomic_uint32_t m_samplingValue;                     ///< @brief The current parameter of the `Sampling`.
+	std::atomic_uint32_t m_suppressed = 0;                    ///< @brief The number of suppressed messages. @hideinitializer
+	std::atomic_int64_t m_samplingState = 0;                  ///< @brief Counter or next arrival time used for `Sampling`. @hideinitializer
+	std::atomic<const void*> m_pOwner = nullptr;              ///< @brief The target of the last suppressed message. @hideinitializer
+	LogSite* m_pNext = nullptr;                               ///< @brief The next site in the registry. @hideinitializer
+
+	friend std::vector<LogSite*> GetLogSites();
+	friend std::size_t SetLogSitesEnabled(std::string_view, std::string_view, bool);
+	friend std::size_t SetLogSitesSampling(std::string_view, std::string_view, Sampling);
+	friend void ResetLogSites();
+};
+
+/// @brief Get all sites which have been registered so far.
+/// @details A site is registered when the logging statement is executed for the first time.
+/// @return A snapshot of the registry.
+[[nodiscard]] std::vector<LogSite*> GetLogSites();
+
+/// @brief Enable or disable all sites matching a file and function pattern.
+/// @details Both patterns MAY use the wildcards `*` and `?`. An empty pattern matches everything. The rule is also
+/// applied to all sites which are registered later. Rules are applied in the order of the calls. Messages with
+/// `Priority::kError` or higher are logged even if their site is disabled.
+/// @param filePattern The pattern for the file name.
+/// @param functionPattern The pattern for the function name.
+/// @param enabled `true` to enable logging for the matching sites.
+/// @return The number of currently registered sites matching the patterns.
+std::size_t SetLogSitesEnabled(std::string_view filePattern, std::string_view functionPattern, bool enabled);
+
+/// @brief Set the `Sampling` for all sites matching a file and function pattern.
+/// @details The patterns and rules work the same as for `#SetLogSitesEnabled`. Messages with `Priority::kError` or higher
+/// are not sampled.
+/// @param filePattern The pattern for the file name.
+/// @param functionPattern The pattern for the function name.
+/// @param sampling The new `Sampling`.
+/// @return The number of currently registered sites matching the patterns.
+std::size_t SetLogSitesSampling(std::string_view filePattern, std::string_view functionPattern, Sampling sampling);
+
+/// @brief Remove all rules set by `#SetLogSitesEnabled` and `#SetLogSitesSampling`, enable all sites and restore
+/// their default `Sampling`.
+void ResetLogSites();
+
+}  // namespace llamalog
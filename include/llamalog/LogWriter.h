@@ -20,8 +20,11 @@ limitations under the License.
 #include <windows.h>
 
 #include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace llamalog {
 
@@ -59,6 +62,24 @@ public:
 	/// @param logLine The data.
 	virtual void Log(const LogLine& logLine) = 0;
 
+	/// @brief Complete any output which has been deferred, e.g. make written data durable.
+	/// @details The logger calls this function when its queue is empty, after a batch of events and from
+	/// `#llamalog::Flush` if durable output has been requested. The default implementation does nothing.
+	/// @param durable `true` if all output MUST be on stable storage when the function returns.
+	virtual void Commit(bool durable);
+
+	/// @brief Get the maximum time between two calls of `#Commit` while the logger has nothing to write.
+	/// @details The logger reads the value when it starts. The default implementation returns `INFINITE`, i.e. the
+	/// writer does not need periodic calls.
+	/// @return The interval in milliseconds.
+	[[nodiscard]] virtual std::uint32_t GetCommitInterval() const noexcept;
+
+	/// @brief Stop any background activity of the writer.
+	/// @details The logger calls this function from its thread after all remaining events have been written and before
+	/// the thread exits. Events which are logged during the call, e.g. by a background thread of the writer, are still
+	/// written. The default implementation does nothing.
+	virtual void Close();
+
 public:
 	/// @brief Return a string for a `#Priority`.
 	/// @param priority A `#Priority`.
@@ -73,10 +94,10 @@ public:
 	[[nodiscard]] static std::string FormatTimestamp(const FILETIME& timestamp);
 
 	/// @brief Format a timestamp as `YYYY-MM-DD HH:mm:ss.SSS` to a target buffer.
-	/// @details The buffer MUST be of type `fmt::basic_memory_buffer`.
+	/// @details The buffer MUST be of type `fmt::basic_memory_buffer` or `fmt::format_context::iterator`.
 	/// In case of an error, `0000-00-00 00:00:00.000` is written.
 	/// @remarks Using a template instead of the concrete type removes the need to add {fmt} as a dependency for this header.
-	/// @tparam Out The target buffer which MUST be of type `fmt::basic_memory_buffer`.
+	/// @tparam Out The target buffer which MUST be of type `fmt::basic_memory_buffer` or `fmt::format_context::iterator`.
 	/// @param out The target buffer.
 	/// @param timestamp The timestamp.
 	template <typename Out>
@@ -112,7 +133,8 @@ protected:
 
 
 /// @brief A `LogWriter` that writes all output to a file.
-/// @details A new file is started each day at 00:00:00 UTC.
+/// @details A new file is started each day at 00:00:00 UTC. Optionally, a new file is also started when the current
+/// file reaches a maximum size.
 /// @copyright Loosely based on `class FileWriter` from NanoLog.
 class RollingFileWriter : public LogWriter {
 public:
@@ -131,6 +153,8 @@ public:
 	/// @brief Create the writer.
 	/// @warning The logger deletes any log files older than the newest @p maxFiles files. Please ensure that any
 	/// files are copied to a different location if their contents are required for a longer period.
+	/// @details Old files are deleted by a background thread. The directory is searched once when the first file is
+	/// created. Afterwards, the thread only keeps track of the files created by this writer.
 	/// @param priority Only events at this `#Priority` or above will be logged by this writer.
 	/// @param directory Directory where to store the log files.
 	/// @param fileName File name for the log files.
@@ -146,16 +170,172 @@ public:
 	RollingFileWriter& operator=(const RollingFileWriter&) = delete;  ///< @noassignmentoperator
 	RollingFileWriter& operator=(RollingFileWriter&&) = delete;       ///< @nomoveoperator
 
+public:
+	/// @brief Start an additional file within the same period when the current file would grow beyond a size limit.
+	/// @details Additional files get an index after the time part of the name, e.g. `name.20200101_001.log`. A single
+	/// log line which is larger than @p maxFileSize is written to a file of its own. After index 999, all remaining lines
+	/// of the period are appended to the last file.
+	/// @note The limit MUST be set before the writer is added to a logger.
+	/// @param maxFileSize The maximum size of a log file in bytes. The default value 0 means no limit.
+	void SetMaxFileSize(std::uint64_t maxFileSize) noexcept;
+
+	/// @brief Compress log files after the writer has rolled over to a new file.
+	/// @details Files are compressed using the transparent file compression of NTFS by a background thread which runs
+	/// at background priority. Compressed files stay readable by any tool. NTFS compression typically reduces the size
+	/// of log files by a factor of 2 to 4 which is less than formats like gzip or zstd achieve. Compression fails with a
+	/// warning on file systems which do not support compression.
+	/// @note The setting MUST be changed before the writer is added to a logger.
+	/// @param compress `true` to compress rolled files.
+	void SetCompression(bool compress) noexcept;
+
+	/// @brief Open the file for the next period in the background shortly before rolling over.
+	/// @details The file is opened by the background thread when the first log line arrives within the last minute
+	/// (half a period for shorter periods) before the next roll over. An unused file which has been created in advance
+	/// is deleted when the writer is destroyed.
+	/// @note The setting MUST be changed before the writer is added to a logger.
+	/// @param prepare `true` to open the next file in advance.
+	void SetPrepareNextFile(bool prepare) noexcept;
+
+	/// @brief Reserve disk space for log files in chunks instead of growing the file with every write.
+	/// @details Space which has not been used is released by the file system when the file is closed.
+	/// @note The size MUST be set before the writer is added to a logger.
+	/// @param chunkSize The number of bytes to reserve at once. The default value 0 disables preallocation.
+	void SetPreallocationSize(std::uint32_t chunkSize) noexcept;
+
+	/// @brief Write to the log file using overlapped I/O so that the next line is formatted while the previous lines
+	/// are still being written.
+	/// @details Lines are appended in the order in which they are logged. The logger thread only waits if all buffers
+	/// are in use and before a file is closed.
+	/// @note The setting MUST be changed before the writer is added to a logger.
+	/// @param buffers The maximum number of writes in flight. The default value 0 writes synchronously.
+	void SetAsyncWriteBuffers(std::uint32_t buffers) noexcept;
+
+	/// @brief Copy log lines into a memory mapped view of the log file instead of calling `WriteFile` for each line.
+	/// @details The view is moved forward when it is full. The file is truncated to the length of the data when it is
+	/// closed. Until then, other readers see zeros after the last line. If the process ended without closing the file,
+	/// the zeros are removed when the file is opened again. The setting takes precedence over `#SetAsyncWriteBuffers`
+	/// and `#SetPreallocationSize`.
+	/// @note The setting MUST be changed before the writer is added to a logger.
+	/// @param viewSize The size of the view which is rounded up to a multiple of 64 KB. The default value 0 disables
+	/// memory mapping.
+	void SetMappingSize(std::uint32_t viewSize) noexcept;
+
+	/// @brief Flush the log file to disk after a log line at or above a certain `#Priority` has been written.
+	/// @details The file is flushed when the logger has written all available events or after a batch of events, so
+	/// that a single flush covers all lines written in the meantime. Until the file is flushed successfully after an
+	/// error, lines at @p priority only trigger another flush if one is also due by `#SetSyncInterval`.
+	/// @note The setting MUST be changed before the writer is added to a logger.
+	/// @param priority The minimum `#Priority`. The default value `Priority::kNone` never triggers a flush.
+	void SetSyncPriority(Priority priority) noexcept;
+
+	/// @brief Flush the log file to disk at most this many milliseconds after a log line has been written.
+	/// @details The interval is checked when the logger commits a batch of events. If the logger is idle, its thread
+	/// wakes up at least once per interval to flush the file.
+	/// @note The setting MUST be changed before the writer is added to a logger.
+	/// @param milliseconds The maximum age of unflushed data. The default value 0 disables periodic flushes.
+	void SetSyncInterval(std::uint32_t milliseconds) noexcept;
+
 protected:
 	/// @brief Produce output for a `LogLine`.
 	/// @param logLine The data.
 	/// @copyright Derived from `NanoLogLine::stringify(std::ostream&)` from NanoLog.
 	void Log(const LogLine& logLine) final;
 
+	/// @brief Flush the log file to disk if requested or required by `#SetSyncPriority` or `#SetSyncInterval`.
+	/// @param durable `true` if all output MUST be on stable storage when the function returns.
+	void Commit(bool durable) final;
+
+	/// @brief Get the interval set by `#SetSyncInterval`.
+	/// @return The interval in milliseconds or `INFINITE` if periodic flushes are disabled.
+	[[nodiscard]] std::uint32_t GetCommitInterval() const noexcept final;
+
+	/// @brief Wait for all tasks of the background thread and stop it.
+	void Close() final;
+
 private:
 	/// @brief Start the next file.
 	/// @param logLine The `LogLine` which triggered the roll over.
-	void RollFile(const LogLine& logLine);
+	/// @param nextIndex `true` if the roll over was triggered by the size limit, `false` for a new period.
+	void RollFile(const LogLine& logLine, bool nextIndex);
+
+	/// @brief Delete all log files except the newest `#m_maxFiles` files and the current file.
+	/// @details The function is called by the background thread only.
+	/// @param fileName The name of the file which has just been opened.
+	void DeleteOldFiles(const std::wstring& fileName);
+
+	/// @brief Let the background thread open the file for the next period.
+	void PrepareNextFile();
+
+	/// @brief Open a file and make it available for `#TakeNextFile`.
+	/// @details The function is called by the background thread only. `#m_nextFileLock` is held while opening the file,
+	/// i.e. a roll over at the same time waits for the file instead of opening it a second time.
+	/// @param path The path of the file.
+	void OpenNextFile(const std::wstring& path);
+
+	/// @brief Use the file opened by `#OpenNextFile` as the current log file.
+	/// @param path The path of the file.
+	/// @return `true` if a file with the path has been opened in advance.
+	bool TakeNextFile(const std::wstring& path) noexcept;
+
+	/// @brief Open a log file for appending.
+	/// @param path The path of the file.
+	/// @return The handle of the file or `INVALID_HANDLE_VALUE` on errors.
+	[[nodiscard]] HANDLE CreateLogFile(_In_z_ const wchar_t* path) const noexcept;
+
+private:
+	/// @brief A thread for running tasks in the background.
+	class Worker;
+
+	/// @brief A buffer for writing a log line using overlapped I/O.
+	struct PendingWrite;
+
+	/// @brief Get the buffer for the next asynchronous write.
+	/// @details The function waits until the buffer is no longer used by a previous write.
+	/// @return The empty buffer.
+	PendingWrite& GetNextWrite();
+
+	/// @brief Append the contents of a buffer to the log file using overlapped I/O.
+	/// @param write The buffer.
+	void WriteAsync(PendingWrite& write);
+
+	/// @brief Wait until a write has completed and log any error.
+	/// @param write The buffer.
+	void WaitForWrite(PendingWrite& write);
+
+	/// @brief Wait until all asynchronous writes have completed.
+	void WaitForPendingWrites();
+
+	/// @brief Copy data to the memory mapped view of the log file and move the view forward when required.
+	/// @details If a view cannot be mapped, none of the data is added to the file.
+	/// @param data The data.
+	/// @param length The number of bytes in @p data.
+	void WriteMapped(_In_reads_(length) const char* __restrict data, std::size_t length);
+
+	/// @brief Map the part of the log file starting at the current size.
+	/// @return `true` if the view has been mapped.
+	bool MapView();
+
+	/// @brief Unmap the current view of the log file.
+	void UnmapView();
+
+	/// @brief Unmap the current view and truncate the log file to the length of the data.
+	void CloseMapping();
+
+	/// @brief Write all data of the log file to disk.
+	void Sync();
+
+	/// @brief A file opened in advance by the background thread.
+	struct NextFile {
+		/// @brief Close the file and delete it if it has been created in advance.
+		void Discard();
+
+		std::wstring path;  ///< @brief The path of the file.
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast): INVALID_HANDLE_VALUE is part of the Windows API.
+		HANDLE hFile = INVALID_HANDLE_VALUE;  ///< @brief The handle of the file. @hideinitializer
+		std::uint64_t size = 0;               ///< @brief The size of the file. @hideinitializer
+		std::uint64_t allocated = 0;          ///< @brief The reserved disk space. @hideinitializer
+		bool created = false;                 ///< @brief `true` if the file did not exist before. @hideinitializer
+	};
 
 private:
 	static constexpr std::uint32_t kMaxFilesDefault = 60;
@@ -169,6 +349,42 @@ private:
 	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast): INVALID_HANDLE_VALUE is part of the Windows API.
 	HANDLE m_hFile = INVALID_HANDLE_VALUE;  ///< @brief The handle of the log file. @hideinitializer
 	FILETIME m_nextRollAt = {};             ///< @brief Next time to roll over. @hideinitializer
+	std::uint64_t m_maxFileSize = 0;        ///< @brief The maximum size of a log file or 0 for no limit. @hideinitializer
+	std::uint64_t m_fileSize = 0;           ///< @brief The current size of the log file if required for a size limit or preallocation. @hideinitializer
+	std::uint32_t m_fileIndex = 0;          ///< @brief The index of the log file within the current period. @hideinitializer
+	bool m_compress = false;                ///< @brief `true` if rolled files are compressed. @hideinitializer
+	bool m_prepareNextFile = false;         ///< @brief `true` if the next file is opened in advance. @hideinitializer
+	FILETIME m_prepareAt = {};              ///< @brief Time to open the next file in advance. @hideinitializer
+	std::uint32_t m_preallocationSize = 0;  ///< @brief The chunk size for reserving disk space or 0. @hideinitializer
+	std::uint64_t m_allocated = 0;          ///< @brief The reserved disk space of the log file. @hideinitializer
+	std::uint32_t m_asyncWriteBuffers = 0;  ///< @brief The maximum number of writes in flight or 0. @hideinitializer
+	std::uint32_t m_nextWrite = 0;          ///< @brief The index of the next buffer in `#m_pPendingWrites`. @hideinitializer
+	std::wstring m_path;                    ///< @brief The path of the log file.
+
+	std::unique_ptr<PendingWrite[]> m_pPendingWrites;  ///< @brief The buffers for asynchronous writes, created on first use.
+
+	std::uint32_t m_mappingSize = 0;  ///< @brief The size of the memory mapped view or 0. @hideinitializer
+	HANDLE m_hMapping = nullptr;      ///< @brief The file mapping object of the log file. @hideinitializer
+	char* m_pView = nullptr;          ///< @brief The memory mapped view of the log file. @hideinitializer
+	std::uint64_t m_viewOffset = 0;   ///< @brief The offset of `#m_pView` within the log file. @hideinitializer
+	bool m_mapped = false;            ///< @brief `true` if the log file has been extended for mapping. @hideinitializer
+
+	Priority m_syncPriority = Priority{};  ///< @brief The minimum `#Priority` which triggers a flush to disk. @hideinitializer
+	std::uint32_t m_syncInterval = 0;      ///< @brief The maximum age of unflushed data in milliseconds or 0. @hideinitializer
+	ULONGLONG m_syncAt = 0;                ///< @brief The tick count when the next periodic flush is due. @hideinitializer
+	bool m_unsynced = false;               ///< @brief `true` if data has been written since the last flush. @hideinitializer
+	bool m_syncRequired = false;           ///< @brief `true` if a line at `#m_syncPriority` has been written. @hideinitializer
+	bool m_syncError = false;              ///< @brief `true` if the last flush has failed. @hideinitializer
+
+	SRWLOCK m_nextFileLock = SRWLOCK_INIT;             ///< @brief Lock protecting `#m_nextFile`. @hideinitializer
+	_Guarded_by_(m_nextFileLock) NextFile m_nextFile;  ///< @brief The file opened in advance.
+
+	std::vector<std::wstring> m_files;  ///< @brief The sorted names of all log files. Only used by the background thread.
+	bool m_filesFound = false;          ///< @brief `true` if the directory has been searched for `#m_files`. @hideinitializer
+
+	/// @brief The background thread for opening, deleting and compressing files.
+	/// @details The thread is created on first use and MUST be deleted before any data used by the thread.
+	std::unique_ptr<Worker> m_pWorker;
 };
 
 }  // namespace llamalog
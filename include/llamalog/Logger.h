@@ -45,6 +45,7 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SO
 */
 
 #include <llamalog/LogLine.h>
+#include <llamalog/LogSite.h>  // IWYU pragma: export
 // IWYU pragma: no_include "llamalog/winapi_log.h"
 
 #include <sal.h>
@@ -64,6 +65,20 @@ class LogWriter;
 
 namespace internal {
 
+class Logger;
+
+/// @brief A deleter which allows using `std::unique_ptr` for the incomplete type `internal::Logger`.
+struct LoggerDeleter final {
+	/// @brief Shut down and delete the logger.
+	/// @param pLogger The logger.
+	void operator()(Logger* pLogger) const noexcept;
+};
+
+/// @brief Create an additional logger.
+/// @note The logger MUST be started before any logging takes place.
+/// @return The new logger.
+[[nodiscard]] std::unique_ptr<Logger, LoggerDeleter> CreateLogger();
+
 /// @brief Initialize the logger.
 /// @note `Start` MUST be called after `Initialize` before any logging takes place.
 /// @copyright Derived from `Initialize` from NanoLog.
@@ -73,6 +88,15 @@ void Initialize();
 /// @note `Start` MUST be called after `Initialize` before any logging takes place.
 void Start();
 
+/// @brief Get the logger which owns the current thread.
+/// @return The logger or `nullptr` if the current thread does not belong to any logger.
+[[nodiscard]] Logger* GetThreadLogger() noexcept;
+
+/// @brief Send messages without an explicit target from the current thread to a logger.
+/// @details Background threads of a `LogWriter` use this to send internal messages to the logger owning the writer.
+/// @param pLogger The logger or `nullptr` to use the default logger.
+void SetThreadLogger(Logger* pLogger) noexcept;
+
 /// @brief Calculate the `Priority` for internal logging messages.
 /// @remarks The function prevents endless loops by encoding an error counter in the priority.
 /// @param priority The desired logging priority.
@@ -150,6 +174,77 @@ constexpr __declspec(noalias) _Ret_z_ const char* GetFilename(_In_z_ const char*
 }
 
 
+/// @brief A logger which is independent from the default logger.
+/// @details Each instance has its own queue, thread and writers, i.e. unrelated streams of log events, e.g. an audit
+/// trail and the diagnostic output, do not compete for the same resources and can be configured separately. Use the
+/// macros `#LLAMALOG_LOG_TO` and `#LLAMALOG_LOG_TO_NOEXCEPT` or the overloads of `#llamalog::Log` and
+/// `#llamalog::LogNoExcept` taking a `Logger` as their first argument for logging to an instance. All other functions
+/// and macros always use the default logger.
+/// @note Messages logged by the writers of an instance, e.g. internal errors, are sent to the same instance.
+class Logger final {
+public:
+	/// @brief Create a new logger, add writers and start logging.
+	/// @tparam LogWriter MUST be of type `LogWriter`.
+	/// @param writers One or more `LogWriter` objects.
+	template <typename... LogWriter>
+	explicit Logger(std::unique_ptr<LogWriter>&&... writers)
+		: m_pLogger(internal::CreateLogger()) {
+		(..., AddWriter(std::move(writers)));
+		Start();
+	}
+	Logger(const Logger&) = delete;  ///< @nocopyconstructor
+	Logger(Logger&&) = delete;       ///< @nomoveconstructor
+
+	/// @brief Waits for all events to be written and ends logging.
+	~Logger() noexcept = default;
+
+public:
+	Logger& operator=(const Logger&) = delete;  ///< @noassignmentoperator
+	Logger& operator=(Logger&&) = delete;       ///< @nomoveoperator
+
+public:
+	/// @brief Log a `LogLine`.
+	/// @param logLine The `LogLine` to send to the logger.
+	void Log(LogLine& logLine);
+
+	/// @brief Log a `LogLine`.
+	/// @param logLine The `LogLine` to send to the logger.
+	void Log(LogLine&& logLine);
+
+	/// @brief Enable or disable the suppression of repeated messages.
+	/// @details The function is the same as `#llamalog::SetRepeatSuppression` but applies to this instance.
+	/// @param enabled `true` to collapse repeated messages.
+	void SetRepeatSuppression(bool enabled) noexcept;
+
+	/// @brief Enable or disable writing `Priority::kFatal` events on the calling thread.
+	/// @details The function is the same as `#llamalog::SetSynchronousFatal` but applies to this instance.
+	/// @param enabled `true` to write fatal events synchronously.
+	void SetSynchronousFatal(bool enabled) noexcept;
+
+	/// @brief Waits until all currently available entries have been written.
+	/// @details The function is the same as `#llamalog::Flush` but applies to this instance.
+	/// @param durable `true` to also wait until all writers have made their output durable.
+	void Flush(bool durable = false);
+
+	/// @brief Get the value which identifies this instance as the target of a `#llamalog::LogSite`.
+	/// @details The value is used for reporting messages suppressed by a `#llamalog::Sampling` to this instance.
+	/// @return An opaque value which MUST NOT be dereferenced.
+	[[nodiscard]] const void* GetSiteOwner() const noexcept {
+		return m_pLogger.get();
+	}
+
+private:
+	/// @brief Add a log writer.
+	/// @param writer The `LogWriter` to add.
+	void AddWriter(std::unique_ptr<LogWriter>&& writer);
+
+	/// @brief Actually start logging.
+	void Start();
+
+private:
+	std::unique_ptr<internal::Logger, internal::LoggerDeleter> m_pLogger;  ///< @brief The logger implementation.
+};
+
 /// @brief Log a `LogLine`.
 /// @param logLine The `LogLine` to send to the logger.
 /// @copyright Derived from `Log::operator==` from NanoLog.
@@ -171,7 +266,22 @@ void Log(LogLine&& logLine);
 template <typename... T>
 void Log(const Priority priority, _In_z_ const char* __restrict const file, const std::uint32_t line, _In_z_ const char* __restrict const function, _In_z_ const char* __restrict const message, T&&... args) {
 	LogLine logLine(priority, file, line, function, message);
-	Log((logLine << ... << std::forward<T>(args)));
+	Log(internal::AddArguments(logLine, std::forward<T>(args)...));
+}
+
+/// @brief Logs a new `LogLine` to a specific `Logger`.
+/// @tparam T The types of the message arguments.
+/// @param logger The target `Logger`.
+/// @param priority The `#Priority`.
+/// @param file The logged file name. This MUST be a literal string, typically from `__FILE__`, i.e. the value is not copied but always referenced by the pointer.
+/// @param line The logged line number, typically from `__LINE__`.
+/// @param function The logged function, typically from `__func__`. This MUST be a literal string, i.e. the value is not copied but always referenced by the pointer.
+/// @param message The logged message. This MUST be a literal string, i.e. the value is not copied but always referenced by the pointer.
+/// @param args Any arguments for @p message.
+template <typename... T>
+void Log(Logger& logger, const Priority priority, _In_z_ const char* __restrict const file, const std::uint32_t line, _In_z_ const char* __restrict const function, _In_z_ const char* __restrict const message, T&&... args) {
+	LogLine logLine(priority, file, line, function, message);
+	logger.Log(internal::AddArguments(logLine, std::forward<T>(args)...));
 }
 
 /// @brief Logs a new `LogLine` without throwing an exception.
@@ -188,7 +298,30 @@ template <typename... T>
 void LogNoExcept(const Priority priority, _In_z_ const char* __restrict const file, const std::uint32_t line, _In_z_ const char* __restrict const function, _In_z_ const char* __restrict const message, T&&... args) noexcept {
 	auto log = [priority, message, &args...](_In_z_ const char* const file, const std::uint32_t line, _In_z_ const char* const function) {
 		LogLine logLine(priority, file, line, function, message);
-		Log((logLine << ... << std::forward<T>(args)));
+		Log(internal::AddArguments(logLine, std::forward<T>(args)...));
+	};
+	auto thunk = [](_In_z_ const char* __restrict const file, const std::uint32_t line, _In_z_ const char* __restrict const function, _In_ void* const p) {
+		(*static_cast<decltype(log)*>(p))(file, line, function);
+	};
+
+	internal::CallNoExcept(file, line, function, thunk, &log);
+}
+
+/// @brief Logs a new `LogLine` to a specific `Logger` without throwing an exception.
+/// @details Errors while logging are sent to the default logger.
+/// @tparam T The types of the message arguments.
+/// @param logger The target `Logger`.
+/// @param priority The `#Priority`.
+/// @param file The logged file name. This MUST be a literal string, typically from `__FILE__`, i.e. the value is not copied but always referenced by the pointer.
+/// @param line The logged line number, typically from `__LINE__`.
+/// @param function The logged function, typically from `__func__`. This MUST be a literal string, i.e. the value is not copied but always referenced by the pointer.
+/// @param message The logged message. This MUST be a literal string, i.e. the value is not copied but always referenced by the pointer.
+/// @param args Any arguments for @p message.
+template <typename... T>
+void LogNoExcept(Logger& logger, const Priority priority, _In_z_ const char* __restrict const file, const std::uint32_t line, _In_z_ const char* __restrict const function, _In_z_ const char* __restrict const message, T&&... args) noexcept {
+	auto log = [&logger, priority, message, &args...](_In_z_ const char* const file, const std::uint32_t line, _In_z_ const char* const function) {
+		LogLine logLine(priority, file, line, function, message);
+		logger.Log(internal::AddArguments(logLine, std::forward<T>(args)...));
 	};
 	auto thunk = [](_In_z_ const char* __restrict const file, const std::uint32_t line, _In_z_ const char* __restrict const function, _In_ void* const p) {
 		(*static_cast<decltype(log)*>(p))(file, line, function);
@@ -214,13 +347,35 @@ void LogInternal(const Priority priority, _In_z_ const char* __restrict const fi
 		return;
 	}
 	LogLine logLine(internalPriority, file, line, function, message);
-	Log((logLine << ... << std::forward<T>(args)));
+	Log(internal::AddArguments(logLine, std::forward<T>(args)...));
 }
 
+/// @brief Enable or disable the suppression of repeated messages.
+/// @details If enabled, consecutive messages from the same location with identical arguments are not sent to the
+/// writers. Instead a single line `last message repeated N times` is written when a different message arrives, after
+/// a few seconds or at shutdown. Messages are compared using the encoded arguments, i.e. arguments holding pointers
+/// to heap memory, e.g. large strings in custom types or exceptions, are never treated as identical. Messages with
+/// `Priority::kError` or above are compared only with each other because they are written ahead of other messages.
+/// @param enabled `true` to collapse repeated messages.
+void SetRepeatSuppression(bool enabled) noexcept;
+
+/// @brief Enable or disable writing `Priority::kFatal` events on the calling thread.
+/// @details Events with `Priority::kError` or above are always processed before all other queued events. If enabled,
+/// a fatal event is not queued at all. Instead, the calling thread waits until all queued errors have been written and
+/// then writes the event itself. This ensures that the event has reached the writers before e.g. the process is
+/// terminated. The setting has no effect for events logged before logging has started or from within a `LogWriter`.
+/// Enabling the setting for the first time waits until the logger thread is idle. Afterwards, the logger thread
+/// synchronizes with the calling threads for every event.
+/// @param enabled `true` to write fatal events synchronously.
+void SetSynchronousFatal(bool enabled) noexcept;
+
 /// @brief Waits until all currently available entries have been written.
 /// @details This function might block for a long time and its main purpose is to flush the log for testing.
-/// Use with care in your own code.
-void Flush();
+/// Use with care in your own code. If @p durable is `true`, the function additionally waits until all writers have made
+/// their output durable, e.g. `RollingFileWriter` flushes the file buffers to disk. A single flush to disk covers all
+/// events written so far, i.e. concurrent calls share the cost.
+/// @param durable `true` to also wait until all writers have made their output durable.
+void Flush(bool durable = false);
 
 /// @brief End all logging. This MUST be the last function called.
 void Shutdown() noexcept;
@@ -237,24 +392,96 @@ void Shutdown() noexcept;
 
 /// @brief Emit a log line. @details Without the explicit variable `file_` the compiler does not reliably evaluate
 /// `#llamalog::GetFilename` at compile time. Add a `do-while`-loop to force a semicolon after the macro.
+/// Each expansion owns a `#llamalog::LogSite` which allows switching the statement on and off at runtime.
 /// @param priority_ The `Priority`.
 /// @param message_ The log message which MAY contain {fmt} placeholders. This MUST be a literal string
 // NOLINTNEXTLINE(cppcoreguidelines-macro-usage): Require access to __FILE__, __LINE__ and __func__.
-#define LLAMALOG_LOG(priority_, message_, ...)                                        \
-	do {                                                                              \
-		constexpr const char* file_ = llamalog::GetFilename(__FILE__);                \
-		llamalog::Log(priority_, file_, __LINE__, __func__, message_, ##__VA_ARGS__); \
+#define LLAMALOG_LOG(priority_, message_, ...)                                            \
+	do {                                                                                  \
+		constexpr const char* file_ = llamalog::GetFilename(__FILE__);                    \
+		static llamalog::LogSite site_(file_, __LINE__, __func__);                        \
+		if (site_.IsEnabled(priority_)) {                                                 \
+			llamalog::Log(priority_, file_, __LINE__, __func__, message_, ##__VA_ARGS__); \
+		}                                                                                 \
 	} while (0)
 
 /// @brief Emit a log line. @details Without the explicit variable `file_` the compiler does not reliably evaluate
 /// `#llamalog::GetFilename` at compile time. Add a `do-while`-loop to force a semicolon after the macro.
+/// Each expansion owns a `#llamalog::LogSite` which allows switching the statement on and off at runtime.
 /// @param priority_ The `Priority`.
 /// @param message_ The log message which MAY contain {fmt} placeholders. This MUST be a literal string
 // NOLINTNEXTLINE(cppcoreguidelines-macro-usage): Require access to __FILE__, __LINE__ and __func__.
-#define LLAMALOG_LOG_NOEXCEPT(priority_, message_, ...)                                       \
-	do {                                                                                      \
-		constexpr const char* file_ = llamalog::GetFilename(__FILE__);                        \
-		llamalog::LogNoExcept(priority_, file_, __LINE__, __func__, message_, ##__VA_ARGS__); \
+#define LLAMALOG_LOG_NOEXCEPT(priority_, message_, ...)                                           \
+	do {                                                                                          \
+		constexpr const char* file_ = llamalog::GetFilename(__FILE__);                            \
+		static llamalog::LogSite site_(file_, __LINE__, __func__);                                \
+		if (site_.IsEnabled(priority_)) {                                                         \
+			llamalog::LogNoExcept(priority_, file_, __LINE__, __func__, message_, ##__VA_ARGS__); \
+		}                                                                                         \
+	} while (0)
+
+/// @brief Emit a log line to a specific `#llamalog::Logger`.
+/// @details Same as `#LLAMALOG_LOG` but sends the event to @p logger_ instead of the default logger.
+/// @param logger_ The `#llamalog::Logger`.
+/// @param priority_ The `Priority`.
+/// @param message_ The log message which MAY contain {fmt} placeholders. This MUST be a literal string
+// NOLINTNEXTLINE(cppcoreguidelines-macro-usage): Require access to __FILE__, __LINE__ and __func__.
+#define LLAMALOG_LOG_TO(logger_, priority_, message_, ...)                                         \
+	do {                                                                                           \
+		constexpr const char* file_ = llamalog::GetFilename(__FILE__);                             \
+		static llamalog::LogSite site_(file_, __LINE__, __func__);                                 \
+		llamalog::Logger& target_ = (logger_);                                                     \
+		if (site_.IsEnabled(priority_, target_.GetSiteOwner())) {                                  \
+			llamalog::Log(target_, priority_, file_, __LINE__, __func__, message_, ##__VA_ARGS__); \
+		}                                                                                          \
+	} while (0)
+
+/// @brief Emit a log line to a specific `#llamalog::Logger` without throwing an exception.
+/// @details Same as `#LLAMALOG_LOG_NOEXCEPT` but sends the event to @p logger_ instead of the default logger.
+/// @param logger_ The `#llamalog::Logger`.
+/// @param priority_ The `Priority`.
+/// @param message_ The log message which MAY contain {fmt} placeholders. This MUST be a literal string
+// NOLINTNEXTLINE(cppcoreguidelines-macro-usage): Require access to __FILE__, __LINE__ and __func__.
+#define LLAMALOG_LOG_TO_NOEXCEPT(logger_, priority_, message_, ...)                                        \
+	do {                                                                                                   \
+		constexpr const char* file_ = llamalog::GetFilename(__FILE__);                                     \
+		static llamalog::LogSite site_(file_, __LINE__, __func__);                                         \
+		llamalog::Logger& target_ = (logger_);                                                             \
+		if (site_.IsEnabled(priority_, target_.GetSiteOwner())) {                                          \
+			llamalog::LogNoExcept(target_, priority_, file_, __LINE__, __func__, message_, ##__VA_ARGS__); \
+		}                                                                                                  \
+	} while (0)
+
+/// @brief Emit a log line if allowed by a `#llamalog::Sampling`.
+/// @details The check happens before any arguments are encoded. The consumer thread regularly logs the number of
+/// suppressed messages. Add a `do-while`-loop to force a semicolon after the macro.
+/// @param priority_ The `Priority`.
+/// @param sampling_ The `#llamalog::Sampling`, e.g. `llamalog::Sampling::PerSecond(10)`.
+/// @param message_ The log message which MAY contain {fmt} placeholders. This MUST be a literal string
+// NOLINTNEXTLINE(cppcoreguidelines-macro-usage): Require access to __FILE__, __LINE__ and __func__.
+#define LLAMALOG_LOG_SAMPLED(priority_, sampling_, message_, ...)                         \
+	do {                                                                                  \
+		constexpr const char* file_ = llamalog::GetFilename(__FILE__);                    \
+		static llamalog::LogSite site_(file_, __LINE__, __func__, sampling_);             \
+		if (site_.IsEnabled(priority_)) {                                                 \
+			llamalog::Log(priority_, file_, __LINE__, __func__, message_, ##__VA_ARGS__); \
+		}                                                                                 \
+	} while (0)
+
+/// @brief Emit a log line if allowed by a `#llamalog::Sampling` without throwing an exception.
+/// @details The check happens before any arguments are encoded. The consumer thread regularly logs the number of
+/// suppressed messages. Add a `do-while`-loop to force a semicolon after the macro.
+/// @param priority_ The `Priority`.
+/// @param sampling_ The `#llamalog::Sampling`, e.g. `llamalog::Sampling::PerSecond(10)`.
+/// @param message_ The log message which MAY contain {fmt} placeholders. This MUST be a literal string
+// NOLINTNEXTLINE(cppcoreguidelines-macro-usage): Require access to __FILE__, __LINE__ and __func__.
+#define LLAMALOG_LOG_SAMPLED_NOEXCEPT(priority_, sampling_, message_, ...)                        \
+	do {                                                                                          \
+		constexpr const char* file_ = llamalog::GetFilename(__FILE__);                            \
+		static llamalog::LogSite site_(file_, __LINE__, __func__, sampling_);                     \
+		if (site_.IsEnabled(priority_)) {                                                         \
+			llamalog::LogNoExcept(priority_, file_, __LINE__, __func__, message_, ##__VA_ARGS__); \
+		}                                                                                         \
 	} while (0)
 
 /// @brief Log a message at `#llamalog::Priority` @p priority_ for function return values.
@@ -263,11 +490,14 @@ void Shutdown() noexcept;
 /// @param message_ The message pattern which MAY use the syntax of {fmt}.
 /// @return The value of @p result_.
 // NOLINTNEXTLINE(cppcoreguidelines-macro-usage): Require access to __FILE__, __LINE__ and __func__.
-#define LLAMALOG_LOG_RESULT(priority_, result_, message_, ...)                                \
-	[&](decltype(result_) const result, const char* const function) -> decltype(result_) {    \
-		constexpr const char* file_ = llamalog::GetFilename(__FILE__);                        \
-		llamalog::Log(priority_, file_, __LINE__, function, message_, result, ##__VA_ARGS__); \
-		return result;                                                                        \
+#define LLAMALOG_LOG_RESULT(priority_, result_, message_, ...)                                    \
+	[&](decltype(result_) const result, const char* const function) -> decltype(result_) {        \
+		constexpr const char* file_ = llamalog::GetFilename(__FILE__);                            \
+		static llamalog::LogSite site_(file_, __LINE__, nullptr);                                 \
+		if (site_.IsEnabled(priority_, function)) {                                               \
+			llamalog::Log(priority_, file_, __LINE__, function, message_, result, ##__VA_ARGS__); \
+		}                                                                                         \
+		return result;                                                                            \
 	}(result_, __func__)
 
 /// @brief Log a message at `#llamalog::Priority` @p priority_ for function return values without throwing an exception.
@@ -276,11 +506,14 @@ void Shutdown() noexcept;
 /// @param message_ The message pattern which MAY use the syntax of {fmt}.
 /// @return The value of @p result_.
 // NOLINTNEXTLINE(cppcoreguidelines-macro-usage): Require access to __FILE__, __LINE__ and __func__.
-#define LLAMALOG_LOG_RESULT_NOEXCEPT(priority_, result_, message_, ...)                               \
-	[&](decltype(result_) const result, const char* const function) noexcept -> decltype(result_) {   \
-		constexpr const char* file_ = llamalog::GetFilename(__FILE__);                                \
-		llamalog::LogNoExcept(priority_, file_, __LINE__, function, message_, result, ##__VA_ARGS__); \
-		return result;                                                                                \
+#define LLAMALOG_LOG_RESULT_NOEXCEPT(priority_, result_, message_, ...)                                   \
+	[&](decltype(result_) const result, const char* const function) noexcept -> decltype(result_) {       \
+		constexpr const char* file_ = llamalog::GetFilename(__FILE__);                                    \
+		static llamalog::LogSite site_(file_, __LINE__, nullptr);                                         \
+		if (site_.IsEnabled(priority_, function)) {                                                       \
+			llamalog::LogNoExcept(priority_, file_, __LINE__, function, message_, result, ##__VA_ARGS__); \
+		}                                                                                                 \
+		return result;                                                                                    \
 	}(result_, __func__)
 
 /// @brief Emit a log line for an internal message from the logger itself.
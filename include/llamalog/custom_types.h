@@ -31,7 +31,63 @@ limitations under the License.
 #include <cstddef>
 #include <memory>
 #include <new>
+#include <string>
 #include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace llamalog {
+
+/// @brief Trait to mark types which can be moved to a different address by copying their bytes.
+/// @details A type is trivially relocatable if move constructing an object at a new address and destructing the
+/// original has the same effect as copying the bytes and forgetting the original. Arguments of such types are moved
+/// together with the rest of the buffer using a single `std::memcpy`. Specialize this template to opt in own types.
+/// @tparam T The type.
+template <typename T>
+struct IsTriviallyRelocatable : std::is_trivially_copyable<T> {
+	// empty
+};
+
+/// @brief Shortcut for `IsTriviallyRelocatable<T>::value`.
+/// @tparam T The type.
+template <typename T>
+constexpr bool kIsTriviallyRelocatable = IsTriviallyRelocatable<T>::value;
+
+/// @brief A `std::unique_ptr` is trivially relocatable if its deleter is.
+template <typename T, typename D>
+struct IsTriviallyRelocatable<std::unique_ptr<T, D>> : IsTriviallyRelocatable<D> {
+	// empty
+};
+
+/// @brief A `std::shared_ptr` holds two pointers only.
+template <typename T>
+struct IsTriviallyRelocatable<std::shared_ptr<T>> : std::true_type {
+	// empty
+};
+
+/// @brief A `std::weak_ptr` holds two pointers only.
+template <typename T>
+struct IsTriviallyRelocatable<std::weak_ptr<T>> : std::true_type {
+	// empty
+};
+
+#if defined(_MSVC_STL_VERSION) && _ITERATOR_DEBUG_LEVEL == 0
+// Containers hold a pointer to themselves when iterator debugging is active, other libraries may use one in short strings.
+
+/// @brief A `std::basic_string` is trivially relocatable when using the default allocator.
+template <typename T, typename Traits>
+struct IsTriviallyRelocatable<std::basic_string<T, Traits, std::allocator<T>>> : std::true_type {
+	// empty
+};
+
+/// @brief A `std::vector` is trivially relocatable when using the default allocator.
+template <typename T>
+struct IsTriviallyRelocatable<std::vector<T, std::allocator<T>>> : std::true_type {
+	// empty
+};
+#endif
+
+}  // namespace llamalog
 
 namespace llamalog::internal {
 
@@ -121,6 +177,8 @@ struct FunctionTable {
 	/// @brief A pointer to a function which has a single argument of type `std::byte*` and returns a
 	/// newly created `fmt::format_context::format_arg` object.
 	CreateFormatArg createFormatArg;
+	/// @brief `true` if the type may be moved by copying its bytes instead of calling `move` and `destruct`.
+	bool relocatable;
 };
 
 /// @brief A struct with all functions to manage objects in the buffer.
@@ -139,6 +197,8 @@ struct FunctionTableInstance {
 	/// @brief A pointer to a function which has a single argument of type `std::byte*` and returns a
 	/// newly created `fmt::format_context::format_arg` object.
 	FunctionTable::CreateFormatArg createFormatArg = CreateFormatArg<T, kPointer, kEscaped>;
+	/// @brief `true` if the type may be moved by copying its bytes instead of calling `move` and `destruct`.
+	bool relocatable = kIsTriviallyRelocatable<T>;
 };
 
 constexpr std::size_t kMaxCustomTypeSize = 0xFFFFFFFu;  // allow max. 255 MB
@@ -185,6 +245,7 @@ LogLine& LogLine::AddCustomArgument(const T& arg) {
 	static_assert(offsetof(FunctionTable, move) == offsetof(internal::FunctionTable, move));
 	static_assert(offsetof(FunctionTable, destruct) == offsetof(internal::FunctionTable, destruct));
 	static_assert(offsetof(FunctionTable, createFormatArg) == offsetof(internal::FunctionTable, createFormatArg));
+	static_assert(offsetof(FunctionTable, relocatable) == offsetof(internal::FunctionTable, relocatable));
 
 	static constexpr FunctionTable kFunctionTable;
 	std::byte* __restrict const ptr = WriteNonTriviallyCopyable(sizeof(X), alignof(X), static_cast<const void*>(&kFunctionTable));
@@ -192,6 +253,29 @@ LogLine& LogLine::AddCustomArgument(const T& arg) {
 	return *this;
 }
 
+template <typename T, bool kEscape, typename std::enable_if_t<!std::is_trivially_copyable_v<T> && !std::is_reference_v<T> && !std::is_const_v<T>, int>>
+LogLine& LogLine::AddCustomArgument(T&& arg) {
+	using X = std::remove_cv_t<T>;
+
+	static_assert(alignof(X) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "alignment of custom type");
+	static_assert(sizeof(X) <= internal::kMaxCustomTypeSize, "custom type is too large");
+	static_assert(std::is_copy_constructible_v<X>, "type MUST be copy constructible");
+	static_assert(std::is_move_constructible_v<X>, "type MUST be move constructible");
+
+	using FunctionTable = internal::FunctionTableInstance<X, false, kEscape>;  // offsetof does not support , in type
+	static_assert(sizeof(FunctionTable) == sizeof(internal::FunctionTable));
+	static_assert(offsetof(FunctionTable, copy) == offsetof(internal::FunctionTable, copy));
+	static_assert(offsetof(FunctionTable, move) == offsetof(internal::FunctionTable, move));
+	static_assert(offsetof(FunctionTable, destruct) == offsetof(internal::FunctionTable, destruct));
+	static_assert(offsetof(FunctionTable, createFormatArg) == offsetof(internal::FunctionTable, createFormatArg));
+	static_assert(offsetof(FunctionTable, relocatable) == offsetof(internal::FunctionTable, relocatable));
+
+	static constexpr FunctionTable kFunctionTable;
+	std::byte* __restrict const ptr = WriteNonTriviallyCopyable(sizeof(X), alignof(X), static_cast<const void*>(&kFunctionTable));
+	new (ptr) X(std::move(arg));
+	return *this;
+}
+
 template <typename T, bool kEscape, typename std::enable_if_t<!std::is_trivially_copyable_v<T>, int>>
 LogLine& LogLine::AddCustomArgument(const T* const arg) {
 	if (arg) {
@@ -207,6 +291,7 @@ LogLine& LogLine::AddCustomArgument(const T* const arg) {
 		static_assert(offsetof(FunctionTable, move) == offsetof(internal::FunctionTable, move));
 		static_assert(offsetof(FunctionTable, destruct) == offsetof(internal::FunctionTable, destruct));
 		static_assert(offsetof(FunctionTable, createFormatArg) == offsetof(internal::FunctionTable, createFormatArg));
+		static_assert(offsetof(FunctionTable, relocatable) == offsetof(internal::FunctionTable, relocatable));
 
 		static constexpr FunctionTable kFunctionTable;
 		std::byte* __restrict const ptr = WriteNonTriviallyCopyable(sizeof(X), alignof(X), static_cast<const void*>(&kFunctionTable));
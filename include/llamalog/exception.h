@@ -31,6 +31,8 @@ limitations under the License.
 namespace llamalog {
 
 /// @brief A helper class to carry additional logging context for exceptions.
+/// @details The context is stored in a reference counted block which is shared by all copies of an exception. Copying
+/// an exception therefore has the same cost regardless of the number and size of the arguments.
 class __declspec(novtable) BaseException {
 protected:
 	/// @brief Creates a new instance.
@@ -38,15 +40,33 @@ protected:
 	/// @param line The source code line where the exception happened.
 	/// @param function The function where the exception happened.
 	/// @param message An additional logging message which MAY use {fmt} pattern syntax.
-	BaseException(_In_z_ const char* __restrict file, std::uint32_t line, _In_z_ const char* __restrict function, _In_opt_z_ const char* __restrict message) noexcept;
+	/// @throws std::bad_alloc if no memory is available for the logging context. The exception then replaces the one
+	/// which was about to be thrown, the same as for any other argument which cannot be stored.
+	BaseException(_In_z_ const char* __restrict file, std::uint32_t line, _In_z_ const char* __restrict function, _In_opt_z_ const char* __restrict message);
 
-	BaseException(const BaseException&) = default;      ///< @defaultconstructor
-	BaseException(BaseException&&) noexcept = default;  ///< @defaultconstructor
-	~BaseException() noexcept = default;
+	/// @brief Creates a new instance sharing the logging context of another one.
+	/// @param baseException The source.
+	BaseException(const BaseException& baseException) noexcept;
+
+	/// @brief Creates a new instance sharing the logging context of another one.
+	/// @details A move shares the context the same as a copy, so the source stays valid.
+	/// @param baseException The source.
+	BaseException(BaseException&& baseException) noexcept;
+
+	/// @brief Releases the logging context if this is the last copy.
+	~BaseException() noexcept;
 
 public:
-	BaseException& operator=(const BaseException&) = default;      ///< @defaultoperator
-	BaseException& operator=(BaseException&&) noexcept = default;  ///< @defaultoperator
+	/// @brief Share the logging context of another instance.
+	/// @param baseException The source.
+	/// @return This instance.
+	BaseException& operator=(const BaseException& baseException) noexcept;
+
+	/// @brief Share the logging context of another instance.
+	/// @details A move shares the context the same as a copy, so the source stays valid.
+	/// @param baseException The source.
+	/// @return This instance.
+	BaseException& operator=(BaseException&& baseException) noexcept;
 
 protected:
 	/// @brief Create the formatted error message with placeholder replacement.
@@ -55,20 +75,22 @@ protected:
 	[[nodiscard]] _Ret_z_ const char* What(_In_opt_ const std::error_code* pCode) const noexcept;
 
 	/// @brief Allow access to the `LogLine` by base classes.
+	/// @note The `LogLine` is shared by all copies and MUST NOT be modified after the exception has been copied.
 	/// @return The log line.
-	[[nodiscard]] LogLine& GetLogLine() noexcept {
-		return m_logLine;
-	}
+	[[nodiscard]] LogLine& GetLogLine() noexcept;
 
 	/// @brief Allow access to the `LogLine` by base classes.
 	/// @return The log line.
-	[[nodiscard]] const LogLine& GetLogLine() const noexcept {
-		return m_logLine;
-	}
+	[[nodiscard]] const LogLine& GetLogLine() const noexcept;
 
 private:
-	LogLine m_logLine;                       ///< @brief Additional information for logging.
-	mutable std::shared_ptr<char[]> m_what;  ///< @brief The error message. @details Uses a `std::shared_ptr` because exceptions must be copyable.
+	struct Context;
+
+	/// @brief Decrement the reference count of the logging context and release it if it is no longer used.
+	void Release() noexcept;
+
+private:
+	Context* m_pContext;  ///< @brief The logging context shared by all copies which is never `nullptr`.
 
 	friend class LogLine;  ///< @brief Allow more straight forward code for copying the data.
 };
@@ -20,10 +20,11 @@ limitations under the License.
 #pragma once
 
 #include <fmt/core.h>
+#include <fmt/format.h>
 
 #include <windows.h>
 
-#include <string>
+#include <cstdint>
 
 namespace llamalog {
 
@@ -52,7 +53,15 @@ public:
 	fmt::format_context::iterator format(const llamalog::error_code& arg, fmt::format_context& ctx);  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
 
 private:
-	std::string m_format;  ///< @brief The format pattern for the numerical error code.
+	/// @brief The output of the numerical error code.
+	enum class Mode : std::uint8_t {
+		kDefault,  ///< @brief Print decimal or hex values depending on the error code.
+		kCustom,   ///< @brief Print using the format specification.
+		kSuppress  ///< @brief Do not print the error code.
+	};
+
+	fmt::formatter<std::uint32_t> m_formatter;  ///< @brief The formatter holding the parsed format specification for the numerical error code.
+	Mode m_mode = Mode::kDefault;                ///< @brief The output of the numerical error code. @hideinitializer
 };
 
 
@@ -72,7 +81,7 @@ public:
 	fmt::format_context::iterator format(const POINT& arg, fmt::format_context& ctx);  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
 
 private:
-	std::string m_format;  ///< @brief The format pattern for both values.
+	fmt::formatter<std::int32_t> m_formatter;  ///< @brief The formatter holding the parsed format specification for both values.
 };
 
 
@@ -92,5 +101,5 @@ public:
 	fmt::format_context::iterator format(const RECT& arg, fmt::format_context& ctx);  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
 
 private:
-	std::string m_format;  ///< @brief The format pattern for all four values.
+	fmt::formatter<std::int32_t> m_formatter;  ///< @brief The formatter holding the parsed format specification for all four values.
 };
@@ -134,11 +134,14 @@ llamalog::LogLine& operator<<(llamalog::LogLine& logLine, const RECT* arg);
 /// @param message_ The message pattern which MAY use the syntax of {fmt}.
 /// @return The value of @p result_.
 // NOLINTNEXTLINE(cppcoreguidelines-macro-usage): Require access to __FILE__, __LINE__ and __func__.
-#define LLAMALOG_LOG_HRESULT(priority_, result_, message_, ...)                                                                      \
-	[&](const HRESULT result, const char* const function) -> HRESULT {                                                               \
-		constexpr const char* file_ = llamalog::GetFilename(__FILE__);                                                               \
-		llamalog::Log(llamalog::Priority::kTrace, file_, __LINE__, function, message_, llamalog::error_code{result}, ##__VA_ARGS__); \
-		return result;                                                                                                               \
+#define LLAMALOG_LOG_HRESULT(priority_, result_, message_, ...)                                                                          \
+	[&](const HRESULT result, const char* const function) -> HRESULT {                                                                   \
+		constexpr const char* file_ = llamalog::GetFilename(__FILE__);                                                                   \
+		static llamalog::LogSite site_(file_, __LINE__, nullptr);                                                                        \
+		if (site_.IsEnabled(llamalog::Priority::kTrace, function)) {                                                                     \
+			llamalog::Log(llamalog::Priority::kTrace, file_, __LINE__, function, message_, llamalog::error_code{result}, ##__VA_ARGS__); \
+		}                                                                                                                                \
+		return result;                                                                                                                   \
 	}(result_, __func__)
 
 /// @brief Log a message at `#llamalog::Priority` @p priority_ for function return values of type `HRESULT` without throwing an exception.
@@ -147,11 +150,14 @@ llamalog::LogLine& operator<<(llamalog::LogLine& logLine, const RECT* arg);
 /// @param message_ The message pattern which MAY use the syntax of {fmt}.
 /// @return The value of @p result_.
 // NOLINTNEXTLINE(cppcoreguidelines-macro-usage): Require access to __FILE__, __LINE__ and __func__.
-#define LLAMALOG_LOG_HRESULT_NOEXCEPT(priority_, result_, message_, ...)                                                                     \
-	[&](const HRESULT result, const char* const function) noexcept -> HRESULT {                                                              \
-		constexpr const char* file_ = llamalog::GetFilename(__FILE__);                                                                       \
-		llamalog::LogNoExcept(llamalog::Priority::kTrace, file_, __LINE__, function, message_, llamalog::error_code{result}, ##__VA_ARGS__); \
-		return result;                                                                                                                       \
+#define LLAMALOG_LOG_HRESULT_NOEXCEPT(priority_, result_, message_, ...)                                                                         \
+	[&](const HRESULT result, const char* const function) noexcept -> HRESULT {                                                                  \
+		constexpr const char* file_ = llamalog::GetFilename(__FILE__);                                                                           \
+		static llamalog::LogSite site_(file_, __LINE__, nullptr);                                                                                \
+		if (site_.IsEnabled(llamalog::Priority::kTrace, function)) {                                                                             \
+			llamalog::LogNoExcept(llamalog::Priority::kTrace, file_, __LINE__, function, message_, llamalog::error_code{result}, ##__VA_ARGS__); \
+		}                                                                                                                                        \
+		return result;                                                                                                                           \
 	}(result_, __func__)
 
 
@@ -47,6 +47,7 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SO
 
 #include "buffer_management.h"
 #include "exception_types.h"
+#include "marker_format.h"  // IWYU pragma: keep
 #include "marker_types.h"
 
 #include "llamalog/Logger.h"
@@ -76,16 +77,18 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SO
 
 namespace llamalog {
 
+using buffer::AllocateHeapBuffer;
 using buffer::CallDestructors;
 using buffer::CopyArgumentsFromBufferTo;
 using buffer::CopyObjects;
-using buffer::GetNextChunk;
 using buffer::GetPadding;
 using buffer::GetTypeId;
 using buffer::kTypeSize;
 using buffer::MoveObjects;
 using buffer::TypeId;
 
+using marker::InlineRange;
+using marker::MovedString;
 using marker::NonTriviallyCopyable;
 using marker::NullValue;
 using marker::TriviallyCopyable;
@@ -98,6 +101,12 @@ using exception::PlainSystemError;
 using exception::StackBasedException;
 using exception::StackBasedSystemError;
 
+/// @brief A `MovedString` is trivially relocatable if the string is.
+template <typename T>
+struct IsTriviallyRelocatable<MovedString<T>> : IsTriviallyRelocatable<std::basic_string<T>> {
+	// empty
+};
+
 //
 // Definitions
 //
@@ -115,18 +124,17 @@ static_assert(__STDCPP_DEFAULT_NEW_ALIGNMENT__ <= std::numeric_limits<LogLine::A
 }
 
 /// @brief Get information for `std::error_code`.
-/// @note The function MUST be called from within a catch block to get the object, else `nullptr` is returned.
+/// @details The type is checked using `dynamic_cast` which is a lot cheaper than re-throwing the current exception.
+/// @param arg The exception.
 /// @return A pointer which is set if the exception is of type `std::system_error` or `system_error` (else `nullptr`).
-[[nodiscard]] _Ret_maybenull_ const std::error_code* GetCurrentExceptionCode() noexcept {
-	try {
-		throw;
-	} catch (const system_error& e) {
-		return &e.code();  // using address is valid because code() returns reference
-	} catch (const std::system_error& e) {
-		return &e.code();  // using address is valid because code() returns reference
-	} catch (...) {
-		return nullptr;
+[[nodiscard]] _Ret_maybenull_ const std::error_code* GetExceptionCode(const std::exception& arg) noexcept {
+	if (const system_error* const pSystemError = dynamic_cast<const system_error*>(&arg); pSystemError) {
+		return &pSystemError->code();  // using address is valid because code() returns reference
+	}
+	if (const std::system_error* const pSystemError = dynamic_cast<const std::system_error*>(&arg); pSystemError) {
+		return &pSystemError->code();  // using address is valid because code() returns reference
 	}
+	return nullptr;
 }
 
 }  // namespace
@@ -146,17 +154,19 @@ LogLine::LogLine(const Priority priority, _In_z_ const char* __restrict file, st
 
 	static_assert(offsetof(LogLine, m_stackBuffer) == 0, "offset of m_stackBuffer");
 #if UINTPTR_MAX == UINT64_MAX
-	static_assert(offsetof(LogLine, m_priority) == LLAMALOG_LOGLINE_SIZE - 58, "offset of m_priority");                                // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
-	static_assert(offsetof(LogLine, m_hasNonTriviallyCopyable) == LLAMALOG_LOGLINE_SIZE - 57, "offset of m_hasNonTriviallyCopyable");  // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
-	static_assert(offsetof(LogLine, m_timestamp) == LLAMALOG_LOGLINE_SIZE - 56, "offset of m_timestamp");                              // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
-	static_assert(offsetof(LogLine, m_file) == LLAMALOG_LOGLINE_SIZE - 48, "offset of m_file");                                        // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
-	static_assert(offsetof(LogLine, m_function) == LLAMALOG_LOGLINE_SIZE - 40, "offset of m_function");                                // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
-	static_assert(offsetof(LogLine, m_message) == LLAMALOG_LOGLINE_SIZE - 32, "offset of m_message");                                  // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
-	static_assert(offsetof(LogLine, m_threadId) == LLAMALOG_LOGLINE_SIZE - 24, "offset of m_threadId");                                // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
-	static_assert(offsetof(LogLine, m_line) == LLAMALOG_LOGLINE_SIZE - 20, "offset of m_line");                                        // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
-	static_assert(offsetof(LogLine, m_used) == LLAMALOG_LOGLINE_SIZE - 16, "offset of m_used");                                        // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
-	static_assert(offsetof(LogLine, m_size) == LLAMALOG_LOGLINE_SIZE - 12, "offset of m_size");                                        // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
-	static_assert(offsetof(LogLine, m_heapBuffer) == LLAMALOG_LOGLINE_SIZE - 8, "offset of m_heapBuffer");                             // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
+	static_assert(offsetof(LogLine, m_priority) == LLAMALOG_LOGLINE_SIZE - 63, "offset of m_priority");                                      // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
+	static_assert(offsetof(LogLine, m_hasNonTriviallyCopyable) == LLAMALOG_LOGLINE_SIZE - 62, "offset of m_hasNonTriviallyCopyable");        // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
+	static_assert(offsetof(LogLine, m_hasNonTriviallyRelocatable) == LLAMALOG_LOGLINE_SIZE - 61, "offset of m_hasNonTriviallyRelocatable");  // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
+	static_assert(offsetof(LogLine, m_sequence) == LLAMALOG_LOGLINE_SIZE - 60, "offset of m_sequence");                                      // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
+	static_assert(offsetof(LogLine, m_timestamp) == LLAMALOG_LOGLINE_SIZE - 56, "offset of m_timestamp");                                    // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
+	static_assert(offsetof(LogLine, m_file) == LLAMALOG_LOGLINE_SIZE - 48, "offset of m_file");                                              // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
+	static_assert(offsetof(LogLine, m_function) == LLAMALOG_LOGLINE_SIZE - 40, "offset of m_function");                                      // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
+	static_assert(offsetof(LogLine, m_message) == LLAMALOG_LOGLINE_SIZE - 32, "offset of m_message");                                        // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
+	static_assert(offsetof(LogLine, m_threadId) == LLAMALOG_LOGLINE_SIZE - 24, "offset of m_threadId");                                      // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
+	static_assert(offsetof(LogLine, m_line) == LLAMALOG_LOGLINE_SIZE - 20, "offset of m_line");                                              // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
+	static_assert(offsetof(LogLine, m_used) == LLAMALOG_LOGLINE_SIZE - 16, "offset of m_used");                                              // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
+	static_assert(offsetof(LogLine, m_size) == LLAMALOG_LOGLINE_SIZE - 12, "offset of m_size");                                              // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
+	static_assert(offsetof(LogLine, m_heapBuffer) == LLAMALOG_LOGLINE_SIZE - 8, "offset of m_heapBuffer");                                   // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
 
 	static_assert(sizeof(ExceptionInformation) == 48);                                                                  // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
 	static_assert(offsetof(ExceptionInformation, hasNonTriviallyCopyable) == 46, "offset of hasNonTriviallyCopyable");  // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
@@ -164,17 +174,19 @@ LogLine::LogLine(const Priority priority, _In_z_ const char* __restrict file, st
 	static_assert(sizeof(HeapBasedException) == 56);                                                                    // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
 	static_assert(offsetof(HeapBasedException, pHeapBuffer) == 48, "offset of pHeapBuffer");                            // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
 #elif UINTPTR_MAX == UINT32_MAX
-	static_assert(offsetof(LogLine, m_priority) == LLAMALOG_LOGLINE_SIZE - 42, "offset of m_priority");                                // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
-	static_assert(offsetof(LogLine, m_hasNonTriviallyCopyable) == LLAMALOG_LOGLINE_SIZE - 41, "offset of m_hasNonTriviallyCopyable");  // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
-	static_assert(offsetof(LogLine, m_timestamp) == LLAMALOG_LOGLINE_SIZE - 40, "offset of m_timestamp");                              // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
-	static_assert(offsetof(LogLine, m_file) == LLAMALOG_LOGLINE_SIZE - 32, "offset of m_file");                                        // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
-	static_assert(offsetof(LogLine, m_function) == LLAMALOG_LOGLINE_SIZE - 28, "offset of m_function");                                // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
-	static_assert(offsetof(LogLine, m_message) == LLAMALOG_LOGLINE_SIZE - 24, "offset of m_message");                                  // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
-	static_assert(offsetof(LogLine, m_threadId) == LLAMALOG_LOGLINE_SIZE - 20, "offset of m_threadId");                                // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
-	static_assert(offsetof(LogLine, m_line) == LLAMALOG_LOGLINE_SIZE - 16, "offset of m_line");                                        // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
-	static_assert(offsetof(LogLine, m_used) == LLAMALOG_LOGLINE_SIZE - 12, "offset of m_used");                                        // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
-	static_assert(offsetof(LogLine, m_size) == LLAMALOG_LOGLINE_SIZE - 8, "offset of m_size");                                         // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
-	static_assert(offsetof(LogLine, m_heapBuffer) == LLAMALOG_LOGLINE_SIZE - 4, "offset of m_heapBuffer");                             // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
+	static_assert(offsetof(LogLine, m_priority) == LLAMALOG_LOGLINE_SIZE - 47, "offset of m_priority");                                      // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
+	static_assert(offsetof(LogLine, m_hasNonTriviallyCopyable) == LLAMALOG_LOGLINE_SIZE - 46, "offset of m_hasNonTriviallyCopyable");        // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
+	static_assert(offsetof(LogLine, m_hasNonTriviallyRelocatable) == LLAMALOG_LOGLINE_SIZE - 45, "offset of m_hasNonTriviallyRelocatable");  // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
+	static_assert(offsetof(LogLine, m_sequence) == LLAMALOG_LOGLINE_SIZE - 44, "offset of m_sequence");                                      // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
+	static_assert(offsetof(LogLine, m_timestamp) == LLAMALOG_LOGLINE_SIZE - 40, "offset of m_timestamp");                                    // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
+	static_assert(offsetof(LogLine, m_file) == LLAMALOG_LOGLINE_SIZE - 32, "offset of m_file");                                              // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
+	static_assert(offsetof(LogLine, m_function) == LLAMALOG_LOGLINE_SIZE - 28, "offset of m_function");                                      // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
+	static_assert(offsetof(LogLine, m_message) == LLAMALOG_LOGLINE_SIZE - 24, "offset of m_message");                                        // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
+	static_assert(offsetof(LogLine, m_threadId) == LLAMALOG_LOGLINE_SIZE - 20, "offset of m_threadId");                                      // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
+	static_assert(offsetof(LogLine, m_line) == LLAMALOG_LOGLINE_SIZE - 16, "offset of m_line");                                              // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
+	static_assert(offsetof(LogLine, m_used) == LLAMALOG_LOGLINE_SIZE - 12, "offset of m_used");                                              // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
+	static_assert(offsetof(LogLine, m_size) == LLAMALOG_LOGLINE_SIZE - 8, "offset of m_size");                                               // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
+	static_assert(offsetof(LogLine, m_heapBuffer) == LLAMALOG_LOGLINE_SIZE - 4, "offset of m_heapBuffer");                                   // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
 
 	static_assert(sizeof(ExceptionInformation) == 36);                                                                  // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
 	static_assert(offsetof(ExceptionInformation, hasNonTriviallyCopyable) == 34, "offset of hasNonTriviallyCopyable");  // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Assert exact layout.
@@ -204,6 +216,8 @@ LogLine::LogLine(const Priority priority, _In_z_ const char* __restrict file, st
 LogLine::LogLine(const LogLine& logLine)
 	: m_priority(logLine.m_priority)
 	, m_hasNonTriviallyCopyable(logLine.m_hasNonTriviallyCopyable)
+	, m_hasNonTriviallyRelocatable(logLine.m_hasNonTriviallyRelocatable)
+	, m_sequence(logLine.m_sequence)
 	, m_timestamp(logLine.m_timestamp)
 	, m_file(logLine.m_file)
 	, m_function(logLine.m_function)
@@ -213,7 +227,8 @@ LogLine::LogLine(const LogLine& logLine)
 	, m_used(logLine.m_used)
 	, m_size(logLine.m_size) {
 	if (logLine.m_heapBuffer) {
-		m_heapBuffer = std::make_unique<std::byte[]>(m_used);
+		m_size = m_used;
+		m_heapBuffer.reset(AllocateHeapBuffer(m_size));
 		if (m_hasNonTriviallyCopyable) {
 			CopyObjects(logLine.m_heapBuffer.get(), m_heapBuffer.get(), m_used);
 		} else {
@@ -233,6 +248,8 @@ LogLine::LogLine(const LogLine& logLine)
 LogLine::LogLine(LogLine&& logLine) noexcept
 	: m_priority(logLine.m_priority)
 	, m_hasNonTriviallyCopyable(logLine.m_hasNonTriviallyCopyable)
+	, m_hasNonTriviallyRelocatable(logLine.m_hasNonTriviallyRelocatable)
+	, m_sequence(logLine.m_sequence)
 	, m_timestamp(logLine.m_timestamp)
 	, m_file(logLine.m_file)
 	, m_function(logLine.m_function)
@@ -243,7 +260,7 @@ LogLine::LogLine(LogLine&& logLine) noexcept
 	, m_size(logLine.m_size)
 	, m_heapBuffer(std::move(logLine.m_heapBuffer)) {
 	if (!m_heapBuffer) {
-		if (m_hasNonTriviallyCopyable) {
+		if (m_hasNonTriviallyRelocatable) {
 			MoveObjects(logLine.m_stackBuffer, m_stackBuffer, m_used);
 		} else {
 			std::memcpy(m_stackBuffer, logLine.m_stackBuffer, m_used);
@@ -266,6 +283,8 @@ LogLine& LogLine::operator=(const LogLine& logLine) {
 
 	m_priority = logLine.m_priority;
 	m_hasNonTriviallyCopyable = logLine.m_hasNonTriviallyCopyable;
+	m_hasNonTriviallyRelocatable = logLine.m_hasNonTriviallyRelocatable;
+	m_sequence = logLine.m_sequence;
 	m_timestamp = logLine.m_timestamp;
 	m_file = logLine.m_file;
 	m_function = logLine.m_function;
@@ -275,7 +294,8 @@ LogLine& LogLine::operator=(const LogLine& logLine) {
 	m_used = logLine.m_used;
 	m_size = logLine.m_size;
 	if (logLine.m_heapBuffer) {
-		m_heapBuffer = std::make_unique<std::byte[]>(m_used);
+		m_size = m_used;
+		m_heapBuffer.reset(AllocateHeapBuffer(m_size));
 		if (m_hasNonTriviallyCopyable) {
 			CopyObjects(logLine.m_heapBuffer.get(), m_heapBuffer.get(), m_used);
 		} else {
@@ -294,6 +314,8 @@ LogLine& LogLine::operator=(const LogLine& logLine) {
 LogLine& LogLine::operator=(LogLine&& logLine) noexcept {
 	m_priority = logLine.m_priority;
 	m_hasNonTriviallyCopyable = logLine.m_hasNonTriviallyCopyable;
+	m_hasNonTriviallyRelocatable = logLine.m_hasNonTriviallyRelocatable;
+	m_sequence = logLine.m_sequence;
 	m_timestamp = logLine.m_timestamp;
 	m_file = logLine.m_file;
 	m_function = logLine.m_function;
@@ -304,7 +326,7 @@ LogLine& LogLine::operator=(LogLine&& logLine) noexcept {
 	m_size = logLine.m_size;
 	m_heapBuffer = std::move(logLine.m_heapBuffer);
 	if (!m_heapBuffer) {
-		if (m_hasNonTriviallyCopyable) {
+		if (m_hasNonTriviallyRelocatable) {
 			MoveObjects(logLine.m_stackBuffer, m_stackBuffer, m_used);
 		} else {
 			std::memcpy(m_stackBuffer, logLine.m_stackBuffer, m_used);
@@ -514,12 +536,32 @@ LogLine& LogLine::operator<<(const std::string& arg) {
 	return *this;
 }
 
+LogLine& LogLine::operator<<(std::string&& arg) {
+	if (arg.length() * sizeof(char) < internal::kMinMovedStringBytes) {
+		WriteString(arg.c_str(), arg.length());
+	} else {
+		// steal the heap allocation of the string instead of copying its contents
+		AddCustomArgument(MovedString<char>{std::move(arg)});
+	}
+	return *this;
+}
+
 // Based on `NanoLogLine::operator<<(const char*)` from NanoLog.
 LogLine& LogLine::operator<<(const std::wstring& arg) {
 	WriteString(arg.c_str(), arg.length());
 	return *this;
 }
 
+LogLine& LogLine::operator<<(std::wstring&& arg) {
+	if (arg.length() * sizeof(wchar_t) < internal::kMinMovedStringBytes) {
+		WriteString(arg.c_str(), arg.length());
+	} else {
+		// steal the heap allocation of the string instead of copying its contents
+		AddCustomArgument(MovedString<wchar_t>{std::move(arg)});
+	}
+	return *this;
+}
+
 // Based on `NanoLogLine::operator<<(const char*)` from NanoLog.
 LogLine& LogLine::operator<<(const std::string_view& arg) {
 	WriteString(arg.data(), arg.length());
@@ -532,15 +574,63 @@ LogLine& LogLine::operator<<(const std::wstring_view& arg) {
 	return *this;
 }
 
+LogLine& LogLine::operator<<(const literal& arg) {
+	const TypeId typeId = GetTypeId<literal>(m_escape);
+	constexpr auto kArgSize = kTypeSize<literal>;
+
+	std::byte* __restrict buffer = GetWritePosition(kArgSize);
+	const LogLine::Align padding = GetPadding<literal>(&buffer[sizeof(typeId)]);
+	if (padding) {
+		// check if the buffer has enough space for the type AND the padding
+		buffer = GetWritePosition(kArgSize + padding);
+		// clear padding to get stable values from GetHash
+		std::memset(&buffer[sizeof(typeId)], 0, padding);
+	}
+
+	std::memcpy(buffer, &typeId, sizeof(typeId));
+	std::memcpy(&buffer[sizeof(typeId)] + padding, &arg, sizeof(arg));
+
+	m_used += kArgSize + padding;
+	return *this;
+}
+
+LogLine& LogLine::operator<<(const hexdump& arg) {
+	const TypeId typeId = GetTypeId<hexdump>(m_escape);
+	constexpr auto kArgSize = kTypeSize<hexdump>;
+	const LogLine::Length length = static_cast<LogLine::Length>(std::min<std::size_t>(arg.length, std::numeric_limits<LogLine::Length>::max()));
+	if (length < arg.length) {
+		LLAMALOG_INTERNAL_WARN("Binary data of length {} trimmed to {}", arg.length, length);
+	}
+	const LogLine::Size size = kArgSize + length;
+
+	std::byte* __restrict const buffer = GetWritePosition(size);
+	// no padding required
+
+	std::memcpy(buffer, &typeId, sizeof(typeId));
+	std::memcpy(&buffer[sizeof(typeId)], &length, sizeof(length));
+	std::memcpy(&buffer[kArgSize], arg.value, length);
+
+	m_used += size;
+	return *this;
+}
+
 LogLine& LogLine::operator<<(const std::exception& arg) {
-	const BaseException* const pBaseException = GetCurrentExceptionAsBaseException();
-	const std::error_code* const pErrorCode = GetCurrentExceptionCode();
+	// cross cast from the exception to the mixin added by llamalog::Throw
+	const BaseException* const pBaseException = dynamic_cast<const BaseException*>(&arg);
+	const std::error_code* const pErrorCode = GetExceptionCode(arg);
 
 	// do not evaluate arg.what() when a BaseException exists
-	WriteException(pBaseException && pBaseException->m_logLine.GetPattern() ? nullptr : arg.what(), pBaseException, pErrorCode);
+	WriteException(pBaseException && pBaseException->GetLogLine().GetPattern() ? nullptr : arg.what(), pBaseException, pErrorCode);
 	return *this;
 }
 
+void LogLine::Reserve(const std::size_t additionalBytes) {
+	if (additionalBytes > m_size - m_used) {
+		// a single allocation for all arguments, the value returned by GetWritePosition is not required
+		static_cast<void>(GetWritePosition(static_cast<LogLine::Size>(std::min<std::size_t>(additionalBytes, std::numeric_limits<LogLine::Size>::max() - m_used))));
+	}
+}
+
 /// @brief The single specialization of `CopyArgumentsTo`.
 /// @param args The `std::vector` to receive the message arguments.
 template <>
@@ -559,6 +649,34 @@ std::string LogLine::GetLogMessage() const {
 	return fmt::to_string(buf);
 }
 
+std::uint64_t LogLine::GetHash() const noexcept {
+	// FNV-1a processing 8 bytes at once
+	constexpr std::uint64_t kOffsetBasis = 14695981039346656037ull;
+	constexpr std::uint64_t kPrime = 1099511628211ull;
+
+	const std::byte* __restrict const buffer = GetBuffer();
+	std::uint64_t hash = (kOffsetBasis ^ reinterpret_cast<std::uintptr_t>(m_message)) * kPrime;
+	LogLine::Size pos = 0;
+	for (; pos + sizeof(std::uint64_t) <= m_used; pos += sizeof(std::uint64_t)) {
+		std::uint64_t value;  // NOLINT(cppcoreguidelines-init-variables): Initialized by memcpy.
+		std::memcpy(&value, &buffer[pos], sizeof(value));
+		hash = (hash ^ value) * kPrime;
+	}
+	for (; pos < m_used; ++pos) {
+		hash = (hash ^ static_cast<std::uint8_t>(buffer[pos])) * kPrime;
+	}
+	return hash;
+}
+
+void LogLine::CopyEncodedArgumentsTo(std::vector<std::byte>& arguments) const {
+	const std::byte* const buffer = GetBuffer();
+	arguments.assign(buffer, buffer + m_used);
+}
+
+bool LogLine::HasEncodedArguments(const std::vector<std::byte>& arguments) const noexcept {
+	return arguments.size() == m_used && std::memcmp(GetBuffer(), arguments.data(), m_used) == 0;
+}
+
 // Derived from `NanoLogLine::buffer` from NanoLog.
 _Ret_notnull_ __declspec(restrict) std::byte* LogLine::GetBuffer() noexcept {
 	return !m_heapBuffer ? m_stackBuffer : m_heapBuffer.get();
@@ -580,31 +698,30 @@ _Ret_notnull_ __declspec(restrict) std::byte* LogLine::GetWritePosition(const Lo
 		return !m_heapBuffer ? &m_stackBuffer[m_used] : &(m_heapBuffer.get())[m_used];
 	}
 
-	m_size = GetNextChunk(static_cast<std::uint32_t>(requiredSize));
+	// grow geometrically to reduce the number of re-allocations for large payloads
+	LogLine::Size size = static_cast<LogLine::Size>(std::min<std::size_t>(std::max<std::size_t>(requiredSize, static_cast<std::size_t>(m_size) * 2u), std::numeric_limits<LogLine::Size>::max()));
+	std::unique_ptr<std::byte[], internal::HeapBufferDeleter> newHeapBuffer(AllocateHeapBuffer(size));
+	m_size = size;
 	if (!m_heapBuffer) {
-		m_heapBuffer = std::make_unique<std::byte[]>(m_size);
-
 		// assert that both buffers are equally aligned so that any offsets and padding values can be simply copied
-		assert(reinterpret_cast<std::uintptr_t>(m_stackBuffer) % __STDCPP_DEFAULT_NEW_ALIGNMENT__ == reinterpret_cast<std::uintptr_t>(m_heapBuffer.get()) % __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+		assert(reinterpret_cast<std::uintptr_t>(m_stackBuffer) % __STDCPP_DEFAULT_NEW_ALIGNMENT__ == reinterpret_cast<std::uintptr_t>(newHeapBuffer.get()) % __STDCPP_DEFAULT_NEW_ALIGNMENT__);
 
-		if (m_hasNonTriviallyCopyable) {
-			MoveObjects(m_stackBuffer, m_heapBuffer.get(), m_used);
+		if (m_hasNonTriviallyRelocatable) {
+			MoveObjects(m_stackBuffer, newHeapBuffer.get(), m_used);
 		} else {
-			std::memcpy(m_heapBuffer.get(), m_stackBuffer, m_used);
+			std::memcpy(newHeapBuffer.get(), m_stackBuffer, m_used);
 		}
 	} else {
-		std::unique_ptr<std::byte[]> newHeapBuffer(std::make_unique<std::byte[]>(m_size));
-
 		// assert that both buffers are equally aligned so that any offsets and padding values can be simply copied
 		assert(reinterpret_cast<std::uintptr_t>(m_heapBuffer.get()) % __STDCPP_DEFAULT_NEW_ALIGNMENT__ == reinterpret_cast<std::uintptr_t>(newHeapBuffer.get()) % __STDCPP_DEFAULT_NEW_ALIGNMENT__);
 
-		if (m_hasNonTriviallyCopyable) {
+		if (m_hasNonTriviallyRelocatable) {
 			MoveObjects(m_heapBuffer.get(), newHeapBuffer.get(), m_used);
 		} else {
 			std::memcpy(newHeapBuffer.get(), m_heapBuffer.get(), m_used);
 		}
-		m_heapBuffer = std::move(newHeapBuffer);
 	}
+	m_heapBuffer = std::move(newHeapBuffer);
 	return &(m_heapBuffer.get())[m_used];
 }
 
@@ -632,6 +749,8 @@ void LogLine::WritePointer(const T* const arg) {
 		if (padding) {
 			// check if the buffer has enough space for the type AND the padding
 			buffer = GetWritePosition(kArgSize + padding);
+			// clear padding to get stable values from GetHash
+			std::memset(&buffer[sizeof(typeId)], 0, padding);
 		}
 
 		std::memcpy(buffer, &typeId, sizeof(typeId));
@@ -689,6 +808,8 @@ void LogLine::WriteString(_In_reads_(len) const wchar_t* __restrict const arg, c
 	if (padding) {
 		// check if the buffer has enough space for the type AND the padding
 		buffer = GetWritePosition(size + padding);
+		// clear padding to get stable values from GetHash
+		std::memset(&buffer[kArgSize], 0, padding);
 	}
 	assert(m_size - m_used >= size + padding);
 
@@ -699,6 +820,54 @@ void LogLine::WriteString(_In_reads_(len) const wchar_t* __restrict const arg, c
 	m_used += size + padding;
 }
 
+template <typename T>
+void LogLine::WriteRange(_In_reads_(count) const T* __restrict const arg, const std::size_t count) {
+	static_assert(internal::kIsRangeElement<T>, "type of range element");
+	static_assert(alignof(T) == sizeof(T), "alignment of range element MUST be the same as its size");
+
+	const TypeId typeId = GetTypeId<InlineRange>(m_escape);
+	constexpr TypeId kElementTypeId = buffer::kTypeId<T>;
+	constexpr auto kArgSize = kTypeSize<InlineRange>;
+	const LogLine::Length length = static_cast<LogLine::Length>(std::min<std::size_t>(count, std::numeric_limits<LogLine::Length>::max()));
+	if (length < count) {
+		LLAMALOG_INTERNAL_WARN("Range of length {} trimmed to {}", count, length);
+	}
+	const LogLine::Size size = kArgSize + length * static_cast<LogLine::Size>(sizeof(T));
+
+	std::byte* __restrict buffer = GetWritePosition(size);
+	const LogLine::Align padding = GetPadding<T>(&buffer[kArgSize]);
+	if (padding) {
+		// check if the buffer has enough space for the type AND the padding
+		buffer = GetWritePosition(size + padding);
+		// clear padding to get stable values from GetHash
+		std::memset(&buffer[kArgSize], 0, padding);
+	}
+	assert(m_size - m_used >= size + padding);
+
+	std::memcpy(buffer, &typeId, sizeof(typeId));
+	std::memcpy(&buffer[sizeof(typeId)], &kElementTypeId, sizeof(kElementTypeId));
+	std::memcpy(&buffer[sizeof(typeId) + sizeof(kElementTypeId)], &length, sizeof(length));
+	std::memcpy(&buffer[kArgSize + padding], arg, length * sizeof(T));
+
+	m_used += size + padding;
+}
+
+/// @cond hide
+template void LogLine::WriteRange<signed char>(_In_reads_(count) const signed char* __restrict, std::size_t count);
+template void LogLine::WriteRange<unsigned char>(_In_reads_(count) const unsigned char* __restrict, std::size_t count);
+template void LogLine::WriteRange<signed short>(_In_reads_(count) const signed short* __restrict, std::size_t count);
+template void LogLine::WriteRange<unsigned short>(_In_reads_(count) const unsigned short* __restrict, std::size_t count);
+template void LogLine::WriteRange<signed int>(_In_reads_(count) const signed int* __restrict, std::size_t count);
+template void LogLine::WriteRange<unsigned int>(_In_reads_(count) const unsigned int* __restrict, std::size_t count);
+template void LogLine::WriteRange<signed long>(_In_reads_(count) const signed long* __restrict, std::size_t count);
+template void LogLine::WriteRange<unsigned long>(_In_reads_(count) const unsigned long* __restrict, std::size_t count);
+template void LogLine::WriteRange<signed long long>(_In_reads_(count) const signed long long* __restrict, std::size_t count);
+template void LogLine::WriteRange<unsigned long long>(_In_reads_(count) const unsigned long long* __restrict, std::size_t count);
+template void LogLine::WriteRange<float>(_In_reads_(count) const float* __restrict, std::size_t count);
+template void LogLine::WriteRange<double>(_In_reads_(count) const double* __restrict, std::size_t count);
+template void LogLine::WriteRange<long double>(_In_reads_(count) const long double* __restrict, std::size_t count);
+/// @endcond
+
 void LogLine::WriteException(_In_opt_z_ const char* message, _In_opt_ const BaseException* pBaseException, _In_opt_ const std::error_code* const pCode) {
 	const std::size_t messageLen = message ? std::strlen(message) : 0;
 	// silently trim message to size
@@ -735,7 +904,7 @@ void LogLine::WriteException(_In_opt_z_ const char* message, _In_opt_ const Base
 		return;
 	}
 
-	const LogLine& logLine = pBaseException->m_logLine;
+	const LogLine& logLine = pBaseException->GetLogLine();
 	assert(!logLine.m_message ^ !message);  // either pattern or message must be present but not both
 	if (!logLine.m_heapBuffer) {
 		const TypeId typeId = pCode ? GetTypeId<StackBasedSystemError>(m_escape) : GetTypeId<StackBasedException>(m_escape);
@@ -810,7 +979,8 @@ void LogLine::WriteException(_In_opt_z_ const char* message, _In_opt_ const Base
 			std::memcpy(&buffer[messageOffset], message, messageLength);
 		}
 
-		std::unique_ptr<std::byte[]> heapBuffer = std::make_unique<std::byte[]>(logLine.m_used);
+		LogLine::Size heapBufferSize = logLine.m_used;
+		std::unique_ptr<std::byte[], internal::HeapBufferDeleter> heapBuffer(AllocateHeapBuffer(heapBufferSize));
 		std::byte* const pBuffer = heapBuffer.get();
 		std::memcpy(&buffer[offset + offsetof(HeapBasedException, pHeapBuffer)], &pBuffer, sizeof(pBuffer));
 		if (logLine.m_hasNonTriviallyCopyable) {
@@ -834,6 +1004,8 @@ void LogLine::WriteException(_In_opt_z_ const char* message, _In_opt_ const Base
 		}
 	}
 	m_hasNonTriviallyCopyable = true;
+	// the arguments of a nested log line are not tracked individually
+	m_hasNonTriviallyRelocatable = true;
 }
 
 void LogLine::WriteTriviallyCopyable(_In_reads_bytes_(objectSize) const std::byte* __restrict const ptr, const LogLine::Size objectSize, const LogLine::Align align, _In_ void (*const createFormatArg)()) {
@@ -848,6 +1020,8 @@ void LogLine::WriteTriviallyCopyable(_In_reads_bytes_(objectSize) const std::byt
 	if (padding != 0) {
 		// check if the buffer has enough space for the type AND the padding
 		buffer = GetWritePosition(size + padding);
+		// clear padding to get stable values from GetHash
+		std::memset(&buffer[kArgSize], 0, padding);
 	}
 	assert(m_size - m_used >= size + padding);
 
@@ -872,6 +1046,8 @@ __declspec(restrict) std::byte* LogLine::WriteNonTriviallyCopyable(const LogLine
 	if (padding != 0) {
 		// check if the buffer has enough space for the type AND the padding
 		buffer = GetWritePosition(size + padding);
+		// clear padding to get stable values from GetHash
+		std::memset(&buffer[kArgSize], 0, padding);
 	}
 	assert(m_size - m_used >= size + padding);
 
@@ -882,6 +1058,9 @@ __declspec(restrict) std::byte* LogLine::WriteNonTriviallyCopyable(const LogLine
 	std::byte* result = &buffer[kArgSize + padding];
 
 	m_hasNonTriviallyCopyable = true;
+	if (!static_cast<const internal::FunctionTable*>(functionTable)->relocatable) {
+		m_hasNonTriviallyRelocatable = true;
+	}
 	m_used += size + padding;
 
 	return result;
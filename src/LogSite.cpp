@@ -0,0 +1,300 @@
+/*
+Copyright 2020 Michael Beckh
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/// @file
+
+#include "llamalog/LogSite.h"
+
+#include "llamalog/finally.h"
+
+#include <windows.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace llamalog {
+
+namespace {
+
+/// @brief A rule set by `#SetLogSitesEnabled` or `#SetLogSitesSampling`.
+struct Rule {
+	/// @brief The action of a rule.
+	enum class Action : std::uint8_t {
+		kEnable,   ///< @brief Enable all matching sites.
+		kDisable,  ///< @brief Disable all matching sites.
+		kSample    ///< @brief Set the `Sampling` of all matching sites.
+	};
+
+	std::string filePattern;      ///< @brief The pattern for the file name.
+	std::string functionPattern;  ///< @brief The pattern for the function name.
+	Action action;                ///< @brief The action for matching sites.
+	Sampling sampling;            ///< @brief The `Sampling` if @p action is `Action::kSample`.
+};
+
+/// @brief Number of ticks of `std::chrono::steady_clock` per second.
+constexpr std::int64_t kTicksPerSecond = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::seconds(1)).count();
+
+/// @brief Lock protecting the list of sites and the rules.
+SRWLOCK g_lock = SRWLOCK_INIT;
+
+/// @brief The most recently registered site.
+_Guarded_by_(g_lock) LogSite* g_pFirstSite = nullptr;
+
+/// @brief All rules in the order in which they have been set.
+_Guarded_by_(g_lock) std::vector<Rule> g_rules;
+
+/// @brief Get a pseudo random number.
+/// @return A value in the range [1, 2^32 - 1].
+[[nodiscard]] std::uint32_t GetRandom() noexcept {
+	static thread_local std::uint32_t state = 0;
+	if (!state) {
+		// any non-zero seed is valid
+		state = (GetCurrentThreadId() * 2654435761u) | 1u;
+	}
+	// xorshift32
+	state ^= state << 13u;
+	state ^= state >> 17u;
+	state ^= state << 5u;
+	return state;
+}
+
+/// @brief Check if a value matches a pattern using the wildcards `*` and `?`.
+/// @param pattern The pattern. An empty pattern matches every value.
+/// @param value The value to check.
+/// @return `true` if @p value matches @p pattern.
+[[nodiscard]] bool Matches(const std::string_view& pattern, const std::string_view& value) noexcept {
+	if (pattern.empty()) {
+		return true;
+	}
+
+	// iterative matching with backtracking to the last star
+	std::size_t p = 0;
+	std::size_t v = 0;
+	std::size_t star = std::string_view::npos;
+	std::size_t mark = 0;
+	while (v < value.length()) {
+		if (p < pattern.length() && (pattern[p] == '?' || pattern[p] == value[v])) {
+			++p;
+			++v;
+		} else if (p < pattern.length() && pattern[p] == '*') {
+			star = p++;
+			mark = v;
+		} else if (star != std::string_view::npos) {
+			p = star + 1;
+			v = ++mark;
+		} else {
+			return false;
+		}
+	}
+	while (p < pattern.length() && pattern[p] == '*') {
+		++p;
+	}
+	return p == pattern.length();
+}
+
+/// @brief Check if a site matches the patterns of a rule.
+/// @param filePattern The pattern for the file name.
+/// @param functionPattern The pattern for the function name.
+/// @param site The site to check.
+/// @return `true` if @p site matches both patterns.
+[[nodiscard]] bool Matches(const std::string_view& filePattern, const std::string_view& functionPattern, const LogSite& site) noexcept {
+	return Matches(filePattern, site.GetFile()) && Matches(functionPattern, site.GetFunction());
+}
+
+}  // namespace
+
+void LogSite::SetEnabled(const bool enabled) noexcept {
+	AcquireSRWLockExclusive(&g_lock);
+	if (m_state.load(std::memory_order_relaxed) == State::kUnregistered) {
+		m_pNext = g_pFirstSite;
+		g_pFirstSite = this;
+	}
+	m_state.store(enabled ? GetEnabledState() : State::kDisabled, std::memory_order_relaxed);
+	ReleaseSRWLockExclusive(&g_lock);
+}
+
+void LogSite::SetSampling(const Sampling sampling) noexcept {
+	AcquireSRWLockExclusive(&g_lock);
+	StoreSampling(sampling);
+	const State state = m_state.load(std::memory_order_relaxed);
+	if (state == State::kUnregistered) {
+		m_pNext = g_pFirstSite;
+		g_pFirstSite = this;
+		m_state.store(GetEnabledState(), std::memory_order_relaxed);
+	} else if (state != State::kDisabled) {
+		m_state.store(GetEnabledState(), std::memory_order_relaxed);
+	} else {
+		// leave disabled
+	}
+	ReleaseSRWLockExclusive(&g_lock);
+}
+
+std::uint32_t LogSite::TakeSuppressed(Priority& priority) noexcept {
+	const std::uint32_t suppressed = m_suppressed.exchange(0, std::memory_order_relaxed);
+	priority = m_suppressedPriority.load(std::memory_order_relaxed);
+	return suppressed;
+}
+
+bool LogSite::Check(const Priority priority, const void* const pOwner) noexcept {
+	State state = m_state.load(std::memory_order_relaxed);
+	if (state == State::kUnregistered) {
+		state = Register();
+	}
+	if (state == State::kEnabled || priority >= Priority::kError) {
+		return true;
+	}
+	if (state == State::kSampled) {
+		if (Sample()) {
+			return true;
+		}
+		m_suppressedPriority.store(priority, std::memory_order_relaxed);
+		m_pOwner.store(pOwner, std::memory_order_relaxed);
+		m_suppressed.fetch_add(1, std::memory_order_relaxed);
+	}
+	return false;
+}
+
+LogSite::State LogSite::Register() noexcept {
+	AcquireSRWLockExclusive(&g_lock);
+	// check again because another thread might have registered the site in the meantime
+	State state = m_state.load(std::memory_order_relaxed);
+	if (state == State::kUnregistered) {
+		bool enabled = true;
+		for (const Rule& rule : g_rules) {
+			if (Matches(rule.filePattern, rule.functionPattern, *this)) {
+				if (rule.action == Rule::Action::kSample) {
+					StoreSampling(rule.sampling);
+				} else {
+					enabled = rule.action == Rule::Action::kEnable;
+				}
+			}
+		}
+		m_pNext = g_pFirstSite;
+		g_pFirstSite = this;
+		state = enabled ? GetEnabledState() : State::kDisabled;
+		m_state.store(state, std::memory_order_relaxed);
+	}
+	ReleaseSRWLockExclusive(&g_lock);
+	return state;
+}
+
+void LogSite::StoreSampling(const Sampling sampling) noexcept {
+	m_samplingMode.store(sampling.mode, std::memory_order_relaxed);
+	m_samplingValue.store(sampling.value, std::memory_order_relaxed);
+	m_samplingState.store(0, std::memory_order_relaxed);
+}
+
+bool LogSite::Sample() noexcept {
+	const std::uint32_t value = m_samplingValue.load(std::memory_order_relaxed);
+	switch (m_samplingMode.load(std::memory_order_relaxed)) {
+	case Sampling::Mode::kNone:
+		return true;
+	case Sampling::Mode::kPerSecond: {
+		if (!value) {
+			return false;
+		}
+		// generic cell rate algorithm, i.e. a token bucket holding up to value tokens which is refilled continuously
+		const std::int64_t interval = kTicksPerSecond / value;
+		const std::int64_t burst = kTicksPerSecond - interval;
+		const std::int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+		std::int64_t arrival = m_samplingState.load(std::memory_order_relaxed);
+		std::int64_t next;  // NOLINT(cppcoreguidelines-init-variables): Guaranteed to be initialized before first read.
+		do {
+			const std::int64_t base = std::max(arrival, now);
+			if (base - now > burst) {
+				return false;
+			}
+			next = base + interval;
+		} while (!m_samplingState.compare_exchange_weak(arrival, next, std::memory_order_relaxed));
+		return true;
+	}
+	case Sampling::Mode::kEveryNth:
+		return value && m_samplingState.fetch_add(1, std::memory_order_relaxed) % value == 0;
+	case Sampling::Mode::kProbability:
+		return GetRandom() <= value;
+	}
+	return true;
+}
+
+std::vector<LogSite*> GetLogSites() {
+	std::vector<LogSite*> result;
+
+	AcquireSRWLockShared(&g_lock);
+	auto finally = llamalog::finally([]() noexcept {
+		ReleaseSRWLockShared(&g_lock);
+	});
+	for (LogSite* pSite = g_pFirstSite; pSite; pSite = pSite->m_pNext) {
+		result.push_back(pSite);
+	}
+	return result;
+}
+
+std::size_t SetLogSitesEnabled(const std::string_view filePattern, const std::string_view functionPattern, const bool enabled) {
+	Rule rule{std::string(filePattern), std::string(functionPattern), enabled ? Rule::Action::kEnable : Rule::Action::kDisable, Sampling::None()};
+	std::size_t count = 0;
+
+	AcquireSRWLockExclusive(&g_lock);
+	auto finally = llamalog::finally([]() noexcept {
+		ReleaseSRWLockExclusive(&g_lock);
+	});
+	g_rules.push_back(std::move(rule));
+	for (LogSite* pSite = g_pFirstSite; pSite; pSite = pSite->m_pNext) {
+		if (Matches(filePattern, functionPattern, *pSite)) {
+			pSite->m_state.store(enabled ? pSite->GetEnabledState() : LogSite::State::kDisabled, std::memory_order_relaxed);
+			++count;
+		}
+	}
+	return count;
+}
+
+std::size_t SetLogSitesSampling(const std::string_view filePattern, const std::string_view functionPattern, const Sampling sampling) {
+	Rule rule{std::string(filePattern), std::string(functionPattern), Rule::Action::kSample, sampling};
+	std::size_t count = 0;
+
+	AcquireSRWLockExclusive(&g_lock);
+	auto finally = llamalog::finally([]() noexcept {
+		ReleaseSRWLockExclusive(&g_lock);
+	});
+	g_rules.push_back(std::move(rule));
+	for (LogSite* pSite = g_pFirstSite; pSite; pSite = pSite->m_pNext) {
+		if (Matches(filePattern, functionPattern, *pSite)) {
+			pSite->StoreSampling(sampling);
+			if (pSite->m_state.load(std::memory_order_relaxed) != LogSite::State::kDisabled) {
+				pSite->m_state.store(pSite->GetEnabledState(), std::memory_order_relaxed);
+			}
+			++count;
+		}
+	}
+	return count;
+}
+
+void ResetLogSites() {
+	AcquireSRWLockExclusive(&g_lock);
+	g_rules.clear();
+	for (LogSite* pSite = g_pFirstSite; pSite; pSite = pSite->m_pNext) {
+		pSite->StoreSampling(pSite->m_defaultSampling);
+		pSite->m_state.store(pSite->GetEnabledState(), std::memory_order_relaxed);
+	}
+	ReleaseSRWLockExclusive(&g_lock);
+}
+
+}  // namespace llamalog
@@ -47,22 +47,29 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SO
 
 #include "llamalog/LogLine.h"
 #include "llamalog/Logger.h"
+#include "llamalog/finally.h"
 #include "llamalog/winapi_log.h"
 
 #include <fmt/format.h>
 
 #include <windows.h>
+#include <winioctl.h>
 
 #include <algorithm>
 #include <atomic>
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
+#include <deque>
+#include <exception>
 #include <filesystem>
+#include <functional>
 #include <limits>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -87,6 +94,18 @@ void LogWriter::SetPriority(const Priority priority) noexcept {
 	m_priority.store(priority, std::memory_order_release);
 }
 
+void LogWriter::Commit(const bool /* durable */) {
+	// empty
+}
+
+std::uint32_t LogWriter::GetCommitInterval() const noexcept {
+	return INFINITE;
+}
+
+void LogWriter::Close() {
+	// empty
+}
+
 // Derived from `to_string(LogLevel)` from NanoLog.
 __declspec(noalias) _Ret_z_ char const* LogWriter::FormatPriority(const Priority priority) noexcept {
 	switch (priority) {
@@ -138,6 +157,9 @@ void LogWriter::FormatTimestampTo(Out& out, const FILETIME& timestamp) {
 	fmt::format_to(out, kTimestampPattern, st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond, st.wMilliseconds);
 }
 
+// Explicit instantiation definition for writing to the output of a `fmt::formatter`
+template void LogWriter::FormatTimestampTo(fmt::format_context::iterator& out, const FILETIME& timestamp);
+
 namespace {
 
 /// @brief Helper function for appending a null-terminated string to a `fmt::basic_memory_buffer`.
@@ -236,11 +258,266 @@ constexpr FrequencyInfo kFrequencyInfos[] = {
 };
 static_assert(sizeof(kFrequencyInfos) / sizeof(kFrequencyInfos[0]) == static_cast<std::uint8_t>(RollingFileWriter::Frequency::kCount));
 
-/// @brief Maximum size of output buffer for the kFrequenceInfos patterns.
-constexpr std::size_t kFrequencyOutputBufferSize = 16;
+/// @brief Maximum size of output buffer for the kFrequenceInfos patterns including the file index.
+constexpr std::size_t kFrequencyOutputBufferSize = 20;
+
+/// @brief Pattern for the index of additional files within the same period.
+constexpr const char kFileIndexPattern[] = "_{:03}";
+
+/// @brief Glob pattern matching `kFileIndexPattern`.
+constexpr const char kFileIndexGlob[] = "_???";
+
+/// @brief The largest index for additional files. Log lines are appended to this file even if it is full.
+constexpr std::uint32_t kMaxFileIndex = 999;
+
+/// @brief The maximum time before a roll over for opening the next file in advance (1 minute).
+constexpr std::uint64_t kMaxPrepareInterval = 10ui64 * 1000 * 1000 * 60;
+
+/// @brief The allocation granularity of Windows. The offsets of memory mapped views MUST be a multiple of this value.
+constexpr std::uint32_t kMappingGranularity = 64 * 1024;
+
+/// @brief The size of the chunks read when searching for the end of the data in a memory mapped log file.
+constexpr std::uint32_t kTrimBufferSize = 4096;
+
+/// @brief Get the path of a log file.
+/// @param directory The directory of the log files.
+/// @param fileName The file name for the log files.
+/// @param pattern The pattern from `kFrequencyInfos`.
+/// @param time The time within the period of the file.
+/// @param index The index of the file within the period.
+/// @return The path of the log file.
+std::filesystem::path GetFilePath(const std::string& directory, const std::string& fileName, _In_z_ const char* const pattern, const SYSTEMTIME& time, const std::uint32_t index) {
+	const std::filesystem::path name(fileName);
+	std::filesystem::path path(directory);
+	path /= name.filename().stem();
+	path += '.';
+
+	fmt::basic_memory_buffer<char, kFrequencyOutputBufferSize> buffer;
+	fmt::format_to(buffer, pattern, time.wYear, time.wMonth, time.wDay, time.wHour, time.wMinute, time.wSecond);
+	if (index) {
+		fmt::format_to(buffer, kFileIndexPattern, index);
+	}
+	path += std::string_view(buffer.data(), buffer.size());
+	path += name.extension();
+	return path;
+}
+
+/// @brief Reserve disk space for a file.
+/// @param hFile The handle of the file.
+/// @param size The number of bytes which must fit in the file.
+/// @param chunkSize The allocation is rounded up to a multiple of this value.
+/// @return The reserved space. On errors, the maximum value is returned to prevent any further attempts.
+std::uint64_t Allocate(const HANDLE hFile, const std::uint64_t size, const std::uint32_t chunkSize) {
+	FILE_ALLOCATION_INFO info;
+	info.AllocationSize.QuadPart = static_cast<LONGLONG>((size / chunkSize + 1) * chunkSize);
+	if (!SetFileInformationByHandle(hFile, FileAllocationInfo, &info, sizeof(info))) {
+		LLAMALOG_INTERNAL_WARN("Error reserving space for log: {}", LastError());
+		return std::numeric_limits<std::uint64_t>::max();
+	}
+	return static_cast<std::uint64_t>(info.AllocationSize.QuadPart);
+}
+
+/// @brief Remove the zero bytes at the end of a memory mapped log file which remain from a view after a crash.
+/// @param hFile The handle of the file which MUST have been opened for reading and writing.
+/// @param size The size of the file.
+/// @return The size of the file without the trailing zero bytes.
+std::uint64_t TrimFile(const HANDLE hFile, const std::uint64_t size) {
+	char buffer[kTrimBufferSize];
+	std::uint64_t end = size;
+	while (end) {
+		const std::uint64_t offset = end - std::min<std::uint64_t>(end, sizeof(buffer));
+		const DWORD count = static_cast<DWORD>(end - offset);
+		OVERLAPPED overlapped = {};
+		overlapped.Offset = static_cast<DWORD>(offset);
+		overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32u);
+		DWORD read;  // NOLINT(cppcoreguidelines-init-variables): Initialized by ReadFile.
+		if (!ReadFile(hFile, buffer, count, &read, &overlapped) || read != count) {
+			LLAMALOG_INTERNAL_WARN("Error reading log: {}", LastError());
+			// append to the file as it is
+			return size;
+		}
+		while (read && !buffer[read - 1]) {
+			--read;
+		}
+		end = offset + read;
+		if (read) {
+			break;
+		}
+	}
+	if (end == size) {
+		return size;
+	}
+
+	FILE_END_OF_FILE_INFO info;
+	info.EndOfFile.QuadPart = static_cast<LONGLONG>(end);
+	if (!SetFileInformationByHandle(hFile, FileEndOfFileInfo, &info, sizeof(info))) {
+		LLAMALOG_INTERNAL_WARN("Error truncating log: {}", LastError());
+		// the zero bytes are overwritten by the next view anyway
+	}
+	return end;
+}
+
+/// @brief Compress a file using NTFS compression.
+/// @details NTFS uses LZNT1 which typically reduces the size of log files by a factor of 2 to 4.
+/// @param path The path of the file.
+void CompressFile(const std::wstring& path) {
+	// allow deletion of the file while compression is running
+	const HANDLE hFile = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE) {  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast): INVALID_HANDLE_VALUE is part of the Windows API.
+		// no warning if the file has already been deleted
+		if (const DWORD lastError = GetLastError(); lastError != ERROR_FILE_NOT_FOUND) {
+			LLAMALOG_INTERNAL_WARN("Error compressing log '{}': {}", path, error_code{lastError});
+		}
+		return;
+	}
+	USHORT format = COMPRESSION_FORMAT_DEFAULT;
+	DWORD bytesReturned;  // NOLINT(cppcoreguidelines-init-variables): Out parameter which is not used.
+	if (!DeviceIoControl(hFile, FSCTL_SET_COMPRESSION, &format, sizeof(format), nullptr, 0, &bytesReturned, nullptr)) {
+		LLAMALOG_INTERNAL_WARN("Error compressing log '{}': {}", path, LastError());
+		// leave the file uncompressed
+	}
+	if (!CloseHandle(hFile)) {
+		LLAMALOG_INTERNAL_WARN("Error compressing log '{}': {}", path, LastError());
+	}
+}
 
 }  // namespace
 
+/// @details The thread runs in background mode which lowers its CPU, I/O and memory priority. Tasks are run in the
+/// order in which they have been posted. All tasks are completed before the destructor returns.
+class RollingFileWriter::Worker final {
+public:
+	/// @brief Start the thread.
+	/// @details The thread sends its messages to the logger which owns the calling thread.
+	Worker()
+		: m_pLogger(internal::GetThreadLogger())
+		, m_thread(&Worker::Run, this) {
+		// empty
+	}
+	Worker(const Worker&) = delete;  ///< @nocopyconstructor
+	Worker(Worker&&) = delete;       ///< @nomoveconstructor
+
+	/// @brief Wait for all pending tasks and stop the thread.
+	~Worker() noexcept {
+		AcquireSRWLockExclusive(&m_lock);
+		m_shutdown = true;
+		ReleaseSRWLockExclusive(&m_lock);
+		WakeConditionVariable(&m_wakeUp);
+		try {
+			m_thread.join();
+		} catch (const std::exception& e) {
+			LLAMALOG_PANIC(e.what());
+		} catch (...) {
+			LLAMALOG_PANIC("Error stopping background thread");
+		}
+	}
+
+public:
+	Worker& operator=(const Worker&) = delete;  ///< @noassignmentoperator
+	Worker& operator=(Worker&&) = delete;       ///< @nomoveoperator
+
+public:
+	/// @brief Add a task to the queue.
+	/// @param task The task.
+	void Post(std::function<void()>&& task) {
+		{
+			AcquireSRWLockExclusive(&m_lock);
+			auto finally = llamalog::finally([this]() noexcept {
+				ReleaseSRWLockExclusive(&m_lock);
+			});
+			m_tasks.push_back(std::move(task));
+		}
+		WakeConditionVariable(&m_wakeUp);
+	}
+
+private:
+	/// @brief The main loop of the thread.
+	void Run() noexcept {
+		internal::SetThreadLogger(m_pLogger);
+		if (!SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN)) {
+			try {
+				LLAMALOG_INTERNAL_WARN("Error configuring thread: {}", LastError());
+			} catch (...) {
+				// continue at normal priority
+			}
+		}
+
+		while (true) {
+			std::function<void()> task;
+			AcquireSRWLockExclusive(&m_lock);
+			while (m_tasks.empty() && !m_shutdown) {
+				SleepConditionVariableSRW(&m_wakeUp, &m_lock, INFINITE, 0);
+			}
+			if (m_tasks.empty()) {
+				ReleaseSRWLockExclusive(&m_lock);
+				break;
+			}
+			task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+			ReleaseSRWLockExclusive(&m_lock);
+
+			try {
+				task();
+			} catch (const std::exception& e) {
+				try {
+					LLAMALOG_INTERNAL_ERROR("Error in background task: {}", e);
+				} catch (...) {
+					LLAMALOG_PANIC(e.what());
+				}
+			} catch (...) {
+				try {
+					LLAMALOG_INTERNAL_ERROR("Error in background task");
+				} catch (...) {
+					LLAMALOG_PANIC("Error in background task");
+				}
+			}
+		}
+	}
+
+private:
+	SRWLOCK m_lock = SRWLOCK_INIT;                                   ///< @brief Lock protecting the queue. @hideinitializer
+	CONDITION_VARIABLE m_wakeUp = CONDITION_VARIABLE_INIT;           ///< @brief Signalled for new tasks and shutdown. @hideinitializer
+	_Guarded_by_(m_lock) std::deque<std::function<void()>> m_tasks;  ///< @brief The pending tasks.
+	_Guarded_by_(m_lock) bool m_shutdown = false;                    ///< @brief `true` if the thread should stop. @hideinitializer
+	internal::Logger* const m_pLogger;                               ///< @brief The logger which receives the messages of the thread.
+	std::thread m_thread;                                            ///< @brief The thread.
+};
+
+
+struct RollingFileWriter::PendingWrite final {
+	/// @brief Create the event for waiting on the write.
+	PendingWrite() noexcept {
+		overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+		if (!overlapped.hEvent) {
+			try {
+				LLAMALOG_INTERNAL_WARN("Error creating event: {}", LastError());
+			} catch (...) {
+				// writes using this buffer wait for completion immediately
+			}
+		}
+	}
+	PendingWrite(const PendingWrite&) = delete;  ///< @nocopyconstructor
+	PendingWrite(PendingWrite&&) = delete;       ///< @nomoveconstructor
+
+	/// @brief Close the event. @note The write MUST have completed.
+	~PendingWrite() noexcept {
+		if (overlapped.hEvent && !CloseHandle(overlapped.hEvent)) {
+			try {
+				LLAMALOG_INTERNAL_WARN("Error closing event: {}", LastError());
+			} catch (...) {
+				LLAMALOG_PANIC("Error closing event");
+			}
+		}
+	}
+
+	PendingWrite& operator=(const PendingWrite&) = delete;  ///< @noassignmentoperator
+	PendingWrite& operator=(PendingWrite&&) = delete;       ///< @nomoveoperator
+
+	OVERLAPPED overlapped = {};                                 ///< @brief The data for the overlapped I/O. @hideinitializer
+	fmt::basic_memory_buffer<char, kDefaultBufferSize> buffer;  ///< @brief The formatted log line.
+	bool pending = false;                                       ///< @brief `true` while a write is in progress. @hideinitializer
+};
+
 RollingFileWriter::RollingFileWriter(const Priority priority, std::string directory, std::string fileName, const Frequency frequency, const std::uint32_t maxFiles) noexcept
 	: LogWriter(priority)
 	, m_directory(std::move(directory))
@@ -251,6 +528,16 @@ RollingFileWriter::RollingFileWriter(const Priority priority, std::string direct
 }
 
 RollingFileWriter::~RollingFileWriter() noexcept {
+	try {
+		WaitForPendingWrites();
+		CloseMapping();
+		if (m_unsynced && (m_syncPriority != Priority::kNone || m_syncInterval)) {
+			Sync();
+		}
+	} catch (...) {
+		LLAMALOG_PANIC("Error writing log");
+	}
+
 	if (m_hFile != INVALID_HANDLE_VALUE) {  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast): INVALID_HANDLE_VALUE is part of the Windows API.
 		if (!CloseHandle(m_hFile)) {
 			try {
@@ -260,6 +547,49 @@ RollingFileWriter::~RollingFileWriter() noexcept {
 			}
 		}
 	}
+
+	// usually already done in Close, but the writer might never have been added to a logger
+	// wait for all pending tasks before discarding a file which might just be opened in advance
+	m_pWorker.reset();
+	try {
+		m_nextFile.Discard();
+	} catch (...) {
+		LLAMALOG_PANIC("Error closing log");
+	}
+}
+
+void RollingFileWriter::SetMaxFileSize(const std::uint64_t maxFileSize) noexcept {
+	m_maxFileSize = maxFileSize;
+}
+
+void RollingFileWriter::SetCompression(const bool compress) noexcept {
+	m_compress = compress;
+}
+
+void RollingFileWriter::SetPrepareNextFile(const bool prepare) noexcept {
+	m_prepareNextFile = prepare;
+}
+
+void RollingFileWriter::SetPreallocationSize(const std::uint32_t chunkSize) noexcept {
+	m_preallocationSize = chunkSize;
+}
+
+void RollingFileWriter::SetAsyncWriteBuffers(const std::uint32_t buffers) noexcept {
+	m_asyncWriteBuffers = buffers;
+}
+
+void RollingFileWriter::SetMappingSize(const std::uint32_t viewSize) noexcept {
+	// limit to the largest multiple of the granularity which fits in 32 bits
+	const std::uint32_t size = std::min(viewSize, std::numeric_limits<std::uint32_t>::max() - kMappingGranularity + 1);
+	m_mappingSize = (size + kMappingGranularity - 1) / kMappingGranularity * kMappingGranularity;
+}
+
+void RollingFileWriter::SetSyncPriority(const Priority priority) noexcept {
+	m_syncPriority = priority;
+}
+
+void RollingFileWriter::SetSyncInterval(const std::uint32_t milliseconds) noexcept {
+	m_syncInterval = milliseconds;
 }
 
 // @copyright Derived from `NanoLogLine::stringify(std::ostream&)` from NanoLog.
@@ -268,10 +598,17 @@ void RollingFileWriter::Log(const LogLine& logLine) {
 
 	// also try to roll when the file is invalid
 	if (CompareFileTime(&m_nextRollAt, &timestamp) != 1 || m_hFile == INVALID_HANDLE_VALUE) {  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast): INVALID_HANDLE_VALUE is part of the Windows API.
-		RollFile(logLine);
+		RollFile(logLine, false);
+	} else if (m_prepareNextFile && CompareFileTime(&m_prepareAt, &timestamp) != 1) {
+		PrepareNextFile();
+	} else {
+		// no action required
 	}
 
-	fmt::basic_memory_buffer<char, kDefaultBufferSize> buffer;
+	// format directly into the buffer of the asynchronous write
+	PendingWrite* const pWrite = m_asyncWriteBuffers && !m_mappingSize ? &GetNextWrite() : nullptr;
+	fmt::basic_memory_buffer<char, kDefaultBufferSize> localBuffer;
+	fmt::basic_memory_buffer<char, kDefaultBufferSize>& buffer = pWrite ? pWrite->buffer : localBuffer;
 	FormatTimestampTo(buffer, timestamp);
 	buffer.push_back(' ');
 	Append(buffer, FormatPriority(logLine.GetPriority()));
@@ -288,9 +625,34 @@ void RollingFileWriter::Log(const LogLine& logLine) {
 					fmt::basic_format_args<fmt::format_context>(args.data(), static_cast<fmt::format_args::size_type>(args.size())));
 	buffer.push_back('\n');
 
+	const std::size_t length = buffer.size();
+	// always write at least one line per file, the last index takes all remaining lines
+	if (m_maxFileSize && m_fileSize && m_fileSize + length > m_maxFileSize && m_fileIndex < kMaxFileIndex) {
+		RollFile(logLine, true);
+	}
+	if (!m_unsynced) {
+		m_unsynced = true;
+		m_syncAt = GetTickCount64() + m_syncInterval;
+	}
+	if (m_syncPriority != Priority::kNone && logLine.GetPriority() >= m_syncPriority) {
+		m_syncRequired = true;
+	}
+	if (m_mappingSize) {
+		WriteMapped(buffer.data(), length);
+		return;
+	}
+	m_fileSize += length;
+	if (m_preallocationSize && m_fileSize > m_allocated && m_hFile != INVALID_HANDLE_VALUE) {  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast): INVALID_HANDLE_VALUE is part of the Windows API.
+		m_allocated = Allocate(m_hFile, m_fileSize, m_preallocationSize);
+	}
+
+	if (pWrite) {
+		WriteAsync(*pWrite);
+		return;
+	}
+
 	DWORD written;  // NOLINT(cppcoreguidelines-init-variables): Initialized before first use.
 	const char* const __restrict data = buffer.data();
-	const std::size_t length = buffer.size();
 	for (std::size_t position = 0; position < length; position += written) {
 		// it will work, however please contact me if you REALLY do log messages whose size does not fit in a DWORD... ;-)
 		const DWORD count = static_cast<DWORD>(std::min<std::size_t>(std::numeric_limits<DWORD>::max(), length - position));
@@ -309,7 +671,27 @@ void RollingFileWriter::Log(const LogLine& logLine) {
 	}
 }
 
-void RollingFileWriter::RollFile(const LogLine& logLine) {
+void RollingFileWriter::Commit(const bool durable) {
+	if (!m_unsynced) {
+		return;
+	}
+	// after an error, only retry when requested or periodically instead of trying again for every line
+	if (durable || (m_syncRequired && !m_syncError) || (m_syncInterval && GetTickCount64() >= m_syncAt)) {
+		Sync();
+	}
+}
+
+std::uint32_t RollingFileWriter::GetCommitInterval() const noexcept {
+	return m_syncInterval ? m_syncInterval : INFINITE;
+}
+
+void RollingFileWriter::Close() {
+	// stop the thread while the logger still writes any warnings of pending tasks
+	m_pWorker.reset();
+	m_nextFile.Discard();
+}
+
+void RollingFileWriter::RollFile(const LogLine& logLine, const bool nextIndex) {
 	const FILETIME timestamp = logLine.GetTimestamp();
 
 	ULARGE_INTEGER nextRollAt = {.LowPart = timestamp.dwLowDateTime, .HighPart = timestamp.dwHighDateTime};
@@ -321,6 +703,10 @@ void RollingFileWriter::RollFile(const LogLine& logLine) {
 	m_nextRollAt.dwLowDateTime = nextRollAt.LowPart;
 	m_nextRollAt.dwHighDateTime = nextRollAt.HighPart;
 
+	nextRollAt.QuadPart -= std::min(breakpoint / 2, kMaxPrepareInterval);
+	m_prepareAt.dwLowDateTime = nextRollAt.LowPart;
+	m_prepareAt.dwHighDateTime = nextRollAt.HighPart;
+
 	SYSTEMTIME time;
 	if (!FileTimeToSystemTime(&timestamp, &time)) {
 		LLAMALOG_INTERNAL_ERROR("Error rolling log: {}", LastError());
@@ -328,70 +714,458 @@ void RollingFileWriter::RollFile(const LogLine& logLine) {
 		return;
 	}
 
-	std::filesystem::path path(m_directory);
-	std::filesystem::path fileName(m_fileName);
-
-	path /= fileName.filename().stem();
-	path += '.';
-	std::filesystem::path pattern(path);
+	if (m_hFile != INVALID_HANDLE_VALUE) {  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast): INVALID_HANDLE_VALUE is part of the Windows API.
+		WaitForPendingWrites();
+		CloseMapping();
+		if (m_unsynced && (m_syncPriority != Priority::kNone || m_syncInterval)) {
+			// do not leave unflushed data behind when durability has been requested
+			Sync();
+		}
+		if (!CloseHandle(m_hFile)) {
+			LLAMALOG_INTERNAL_WARN("Error closing log: {}", LastError());
+			// if we can't close the file, leave it open
+		}
+		m_hFile = INVALID_HANDLE_VALUE;  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast): INVALID_HANDLE_VALUE is part of the Windows API.
+		// data of the previous file can no longer be synced
+		m_unsynced = false;
+		m_syncRequired = false;
+	}
 
-	fmt::basic_memory_buffer<char, kFrequencyOutputBufferSize> buffer;
-	fmt::format_to(buffer, frequencyInfo.pattern, time.wYear, time.wMonth, time.wDay, time.wHour, time.wMinute, time.wSecond);
-	path += std::string_view(buffer.data(), buffer.size());
-	path += fileName.extension();
+	m_fileIndex = nextIndex ? std::min(m_fileIndex + 1, kMaxFileIndex) : 0;
+	std::filesystem::path path;
+	while (true) {
+		path = GetFilePath(m_directory, m_fileName, frequencyInfo.pattern, time, m_fileIndex);
+		if (!m_prepareNextFile || !TakeNextFile(path.native())) {
+			m_hFile = CreateLogFile(path.c_str());
+			if (m_hFile == INVALID_HANDLE_VALUE) {  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast): INVALID_HANDLE_VALUE is part of the Windows API.
+				LLAMALOG_INTERNAL_ERROR("Error creating log: {}", LastError());
+				// no file created, try again for next message
+				break;
+			}
 
-	buffer.clear();
-	fmt::format_to(buffer, frequencyInfo.pattern, "????", "??", "??", "??", "??", "??", "??");
-	pattern += std::string_view(buffer.data(), buffer.size());
-	pattern += fileName.extension();
+			m_fileSize = 0;
+			if (m_maxFileSize || m_preallocationSize || m_mappingSize) {
+				LARGE_INTEGER fileSize;
+				if (!GetFileSizeEx(m_hFile, &fileSize)) {
+					LLAMALOG_INTERNAL_WARN("Error getting size of log: {}", LastError());
+					fileSize.QuadPart = 0;
+				}
+				m_fileSize = static_cast<std::uint64_t>(fileSize.QuadPart);
+				if (m_mappingSize && m_fileSize) {
+					m_fileSize = TrimFile(m_hFile, m_fileSize);
+				}
+			}
+			// space is reserved on the first write
+			m_allocated = m_fileSize;
+		}
 
-	if (m_hFile != INVALID_HANDLE_VALUE) {  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast): INVALID_HANDLE_VALUE is part of the Windows API.
+		// continue with the next index if the file already exists and is full, e.g. after a restart
+		if (!m_maxFileSize || m_fileSize < m_maxFileSize || m_fileIndex == kMaxFileIndex) {
+			break;
+		}
 		if (!CloseHandle(m_hFile)) {
 			LLAMALOG_INTERNAL_WARN("Error closing log: {}", LastError());
-			// if we can't close the file, leave it open
 		}
+		++m_fileIndex;
 	}
 
-	// Clean any old log files.
-	std::vector<std::wstring> files;
-	WIN32_FIND_DATAW findData;
-	HANDLE hFindResult = FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
-	if (hFindResult == INVALID_HANDLE_VALUE) {  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast): INVALID_HANDLE_VALUE is part of the Windows API.
-		if (const DWORD lastError = GetLastError(); lastError != ERROR_FILE_NOT_FOUND) {
-			LLAMALOG_INTERNAL_WARN("Error deleting log: {}", error_code{lastError});
+	// using CreateFile with FILE_APPEND_DATA does not require a SetFilePointer to the end
+
+	// kMonthly re-opens the same file every day
+	if (m_hFile == INVALID_HANDLE_VALUE || m_path == path.native()) {  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast): INVALID_HANDLE_VALUE is part of the Windows API.
+		return;
+	}
+
+	// leave all file system maintenance to the background thread
+	if (!m_pWorker) {
+		m_pWorker = std::make_unique<Worker>();
+	}
+	m_pWorker->Post([this, name = path.filename().native()]() {
+		DeleteOldFiles(name);
+	});
+	if (m_compress && !m_path.empty()) {
+		m_pWorker->Post([previous = std::move(m_path)]() {
+			CompressFile(previous);
+		});
+	}
+	m_path = path.native();
+}
+
+void RollingFileWriter::PrepareNextFile() {
+	// only try once per period
+	m_prepareAt = m_nextRollAt;
+
+	SYSTEMTIME time;
+	if (!FileTimeToSystemTime(&m_nextRollAt, &time)) {
+		LLAMALOG_INTERNAL_WARN("Error preparing log: {}", LastError());
+		return;
+	}
+
+	const std::filesystem::path path = GetFilePath(m_directory, m_fileName, kFrequencyInfos[static_cast<std::uint8_t>(m_frequency)].pattern, time, 0);
+	if (path.native() == m_path) {
+		// kMonthly re-opens the same file every day
+		return;
+	}
+
+	if (!m_pWorker) {
+		m_pWorker = std::make_unique<Worker>();
+	}
+	m_pWorker->Post([this, next = path.native()]() {
+		OpenNextFile(next);
+	});
+}
+
+void RollingFileWriter::OpenNextFile(const std::wstring& path) {
+	NextFile nextFile;
+	{
+		// keep the lock while opening so that a roll over in the meantime waits for the file instead of opening it twice
+		AcquireSRWLockExclusive(&m_nextFileLock);
+		auto finally = llamalog::finally([this]() noexcept {
+			ReleaseSRWLockExclusive(&m_nextFileLock);
+		});
+		if (m_nextFile.hFile != INVALID_HANDLE_VALUE && m_nextFile.path == path) {  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast): INVALID_HANDLE_VALUE is part of the Windows API.
+			return;
 		}
-	} else {
-		do {
-			files.emplace_back(findData.cFileName);
-		} while (FindNextFileW(hFindResult, &findData));  // NOLINT(readability-implicit-bool-conversion): Compare BOOL in a condition.
-		const DWORD error = GetLastError();
-		if (error != ERROR_NO_MORE_FILES) {
-			LLAMALOG_INTERNAL_WARN("Error deleting log: {}", error_code{error});
-			// do not try to delete anything on find errors
-		} else {
-			std::sort(files.begin(), files.end());
-			const std::uint32_t len = static_cast<std::uint32_t>(files.size());
-			for (std::uint32_t i = 0; i < len - std::min(len, m_maxFiles); ++i) {
-				std::filesystem::path file = std::filesystem::path(m_directory) / files[i];
-				if (!DeleteFileW(file.c_str())) {
-					LLAMALOG_INTERNAL_WARN("Error deleting log '{}': {}", files[i], LastError());
-					// delete failed, but continue
-				}
+
+		nextFile.path = path;
+		nextFile.hFile = CreateLogFile(path.c_str());
+		if (nextFile.hFile == INVALID_HANDLE_VALUE) {  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast): INVALID_HANDLE_VALUE is part of the Windows API.
+			LLAMALOG_INTERNAL_WARN("Error creating log: {}", LastError());
+			// the logger thread opens the file at roll over
+			return;
+		}
+		nextFile.created = GetLastError() != ERROR_ALREADY_EXISTS;
+
+		if (!nextFile.created && (m_maxFileSize || m_preallocationSize || m_mappingSize)) {
+			LARGE_INTEGER fileSize;
+			if (!GetFileSizeEx(nextFile.hFile, &fileSize)) {
+				LLAMALOG_INTERNAL_WARN("Error getting size of log: {}", LastError());
+				fileSize.QuadPart = 0;
+			}
+			nextFile.size = static_cast<std::uint64_t>(fileSize.QuadPart);
+			if (m_mappingSize && nextFile.size) {
+				nextFile.size = TrimFile(nextFile.hFile, nextFile.size);
 			}
 		}
-		if (!FindClose(hFindResult)) {
-			LLAMALOG_INTERNAL_WARN("Error deleting log: {}", LastError());
-			// just leave the handle open
+		// memory mapped files grow with each view
+		nextFile.allocated = m_preallocationSize && !m_mappingSize ? Allocate(nextFile.hFile, nextFile.size, m_preallocationSize) : nextFile.size;
+
+		std::swap(m_nextFile, nextFile);
+	}
+
+	// close any file prepared for a different period
+	nextFile.Discard();
+}
+
+bool RollingFileWriter::TakeNextFile(const std::wstring& path) noexcept {
+	AcquireSRWLockExclusive(&m_nextFileLock);
+	auto finally = llamalog::finally([this]() noexcept {
+		ReleaseSRWLockExclusive(&m_nextFileLock);
+	});
+	if (m_nextFile.hFile == INVALID_HANDLE_VALUE || m_nextFile.path != path) {  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast): INVALID_HANDLE_VALUE is part of the Windows API.
+		return false;
+	}
+	m_hFile = m_nextFile.hFile;
+	m_fileSize = m_nextFile.size;
+	m_allocated = m_nextFile.allocated;
+
+	m_nextFile.hFile = INVALID_HANDLE_VALUE;  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast): INVALID_HANDLE_VALUE is part of the Windows API.
+	m_nextFile.created = false;
+	return true;
+}
+
+HANDLE RollingFileWriter::CreateLogFile(_In_z_ const wchar_t* const path) const noexcept {
+	if (m_mappingSize) {
+		// a file mapping requires read access
+		return CreateFileW(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	}
+	if (!m_preallocationSize) {
+		return CreateFileW(path, FILE_APPEND_DATA, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN | (m_asyncWriteBuffers ? FILE_FLAG_OVERLAPPED : 0), nullptr);
+	}
+
+	// reserving space requires FILE_WRITE_DATA which lets synchronous writes start at the file pointer instead of the end
+	const HANDLE hFile = CreateFileW(path, FILE_WRITE_DATA | FILE_APPEND_DATA, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN | (m_asyncWriteBuffers ? FILE_FLAG_OVERLAPPED : 0), nullptr);
+	if (hFile != INVALID_HANDLE_VALUE && !m_asyncWriteBuffers) {  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast): INVALID_HANDLE_VALUE is part of the Windows API.
+		LARGE_INTEGER distance;
+		distance.QuadPart = 0;
+		if (!SetFilePointerEx(hFile, distance, nullptr, FILE_END)) {
+			const DWORD lastError = GetLastError();
+			CloseHandle(hFile);
+			SetLastError(lastError);
+			return INVALID_HANDLE_VALUE;  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast): INVALID_HANDLE_VALUE is part of the Windows API.
 		}
 	}
+	return hFile;
+}
+
+RollingFileWriter::PendingWrite& RollingFileWriter::GetNextWrite() {
+	if (!m_pPendingWrites) {
+		m_pPendingWrites = std::make_unique<PendingWrite[]>(m_asyncWriteBuffers);
+	}
+	PendingWrite& write = m_pPendingWrites[m_nextWrite];
+	m_nextWrite = (m_nextWrite + 1) % m_asyncWriteBuffers;
 
-	m_hFile = CreateFileW(path.c_str(), FILE_APPEND_DATA, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	WaitForWrite(write);
+	write.buffer.clear();
+	return write;
+}
+
+void RollingFileWriter::WriteAsync(PendingWrite& write) {
 	if (m_hFile == INVALID_HANDLE_VALUE) {  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast): INVALID_HANDLE_VALUE is part of the Windows API.
-		LLAMALOG_INTERNAL_ERROR("Error creating log: {}", LastError());
-		// no file created, try again for next message
+		// no need to log if there is no file
+		return;
 	}
 
-	// using CreateFile with FILE_APPEND_DATA does not require a SetFilePointer to the end
+	const HANDLE hEvent = write.overlapped.hEvent;
+	if (!hEvent) {
+		// without an event, GetOverlappedResult can only tell writes apart if there is no other write in progress
+		WaitForPendingWrites();
+	}
+
+	const char* const __restrict data = write.buffer.data();
+	const std::size_t length = write.buffer.size();
+	for (std::size_t position = 0; position < length;) {
+		const DWORD count = static_cast<DWORD>(std::min<std::size_t>(std::numeric_limits<DWORD>::max(), length - position));
+
+		// writing to the end of the file appends the data in the order of the calls
+		write.overlapped = {};
+		write.overlapped.Offset = 0xFFFFFFFFu;
+		write.overlapped.OffsetHigh = 0xFFFFFFFFu;
+		write.overlapped.hEvent = hEvent;
+		if (!WriteFile(m_hFile, data + position, count, nullptr, &write.overlapped)) {
+			if (const DWORD lastError = GetLastError(); lastError != ERROR_IO_PENDING) {
+				LLAMALOG_INTERNAL_ERROR("Error writing {} bytes to log: {}", count, error_code{lastError});
+				// try the next event
+				return;
+			}
+			write.pending = true;
+		}
+
+		position += count;
+		if (!hEvent || position < length) {
+			// the OVERLAPPED structure is required for the next part
+			WaitForWrite(write);
+		}
+	}
+}
+
+void RollingFileWriter::WaitForWrite(PendingWrite& write) {
+	if (!write.pending) {
+		return;
+	}
+	write.pending = false;
+
+	DWORD written;  // NOLINT(cppcoreguidelines-init-variables): Initialized by GetOverlappedResult.
+	if (!GetOverlappedResult(m_hFile, &write.overlapped, &written, TRUE)) {
+		LLAMALOG_INTERNAL_ERROR("Error writing {} bytes to log: {}", write.buffer.size(), LastError());
+	}
+}
+
+void RollingFileWriter::WaitForPendingWrites() {
+	if (!m_pPendingWrites) {
+		return;
+	}
+	for (std::uint32_t i = 0; i < m_asyncWriteBuffers; ++i) {
+		WaitForWrite(m_pPendingWrites[i]);
+	}
+}
+
+void RollingFileWriter::WriteMapped(_In_reads_(length) const char* __restrict data, std::size_t length) {
+	if (m_hFile == INVALID_HANDLE_VALUE) {  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast): INVALID_HANDLE_VALUE is part of the Windows API.
+		// no need to log if there is no file
+		return;
+	}
+
+	const std::uint64_t start = m_fileSize;
+	while (length) {
+		if (!m_pView || m_fileSize >= m_viewOffset + m_mappingSize) {
+			if (!MapView()) {
+				// drop the partial line, the next event overwrites any data already copied
+				m_fileSize = start;
+				return;
+			}
+		}
+		const std::size_t count = static_cast<std::size_t>(std::min<std::uint64_t>(length, m_viewOffset + m_mappingSize - m_fileSize));
+		std::memcpy(m_pView + (m_fileSize - m_viewOffset), data, count);
+		m_fileSize += count;
+		data += count;
+		length -= count;
+	}
+}
+
+bool RollingFileWriter::MapView() {
+	UnmapView();
+
+	const std::uint64_t offset = m_fileSize - m_fileSize % kMappingGranularity;
+	const std::uint64_t end = offset + m_mappingSize;
+	// the mapping extends the file if required
+	m_hMapping = CreateFileMappingW(m_hFile, nullptr, PAGE_READWRITE, static_cast<DWORD>(end >> 32u), static_cast<DWORD>(end), nullptr);
+	if (!m_hMapping) {
+		LLAMALOG_INTERNAL_ERROR("Error mapping log: {}", LastError());
+		return false;
+	}
+	m_mapped = true;
+
+	m_pView = static_cast<char*>(MapViewOfFile(m_hMapping, FILE_MAP_WRITE, static_cast<DWORD>(offset >> 32u), static_cast<DWORD>(offset), m_mappingSize));
+	if (!m_pView) {
+		LLAMALOG_INTERNAL_ERROR("Error mapping log: {}", LastError());
+		UnmapView();
+		return false;
+	}
+	m_viewOffset = offset;
+	return true;
+}
+
+void RollingFileWriter::UnmapView() {
+	if (m_pView) {
+		// data is written to disk by the system later
+		if (!UnmapViewOfFile(m_pView)) {
+			LLAMALOG_INTERNAL_WARN("Error unmapping log: {}", LastError());
+		}
+		m_pView = nullptr;
+	}
+	if (m_hMapping) {
+		if (!CloseHandle(m_hMapping)) {
+			LLAMALOG_INTERNAL_WARN("Error unmapping log: {}", LastError());
+		}
+		m_hMapping = nullptr;
+	}
+}
+
+void RollingFileWriter::CloseMapping() {
+	UnmapView();
+	if (!m_mapped) {
+		return;
+	}
+	m_mapped = false;
+
+	// remove the unused part of the last view
+	FILE_END_OF_FILE_INFO info;
+	info.EndOfFile.QuadPart = static_cast<LONGLONG>(m_fileSize);
+	if (!SetFileInformationByHandle(m_hFile, FileEndOfFileInfo, &info, sizeof(info))) {
+		LLAMALOG_INTERNAL_WARN("Error truncating log: {}", LastError());
+	}
+}
+
+void RollingFileWriter::Sync() {
+	if (m_hFile == INVALID_HANDLE_VALUE) {  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast): INVALID_HANDLE_VALUE is part of the Windows API.
+		// no file, no data
+		m_unsynced = false;
+		m_syncRequired = false;
+		return;
+	}
+
+	// the data remains unsynced on errors, try again with the next interval
+	WaitForPendingWrites();
+	if (m_pView && !FlushViewOfFile(m_pView, 0)) {
+		LLAMALOG_INTERNAL_ERROR("Error syncing log: {}", LastError());
+		m_syncError = true;
+		m_syncAt = GetTickCount64() + m_syncInterval;
+		return;
+	}
+	// also writes pages of views which have already been unmapped and the file metadata
+	if (!FlushFileBuffers(m_hFile)) {
+		LLAMALOG_INTERNAL_ERROR("Error syncing log: {}", LastError());
+		m_syncError = true;
+		m_syncAt = GetTickCount64() + m_syncInterval;
+		return;
+	}
+	m_unsynced = false;
+	m_syncRequired = false;
+	m_syncError = false;
+}
+
+void RollingFileWriter::NextFile::Discard() {
+	if (hFile == INVALID_HANDLE_VALUE) {  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast): INVALID_HANDLE_VALUE is part of the Windows API.
+		return;
+	}
+	if (!CloseHandle(hFile)) {
+		LLAMALOG_INTERNAL_WARN("Error closing log: {}", LastError());
+	}
+	hFile = INVALID_HANDLE_VALUE;  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast): INVALID_HANDLE_VALUE is part of the Windows API.
+	// remove files which have been created in advance but never been used
+	if (created && !DeleteFileW(path.c_str())) {
+		LLAMALOG_INTERNAL_WARN("Error deleting log '{}': {}", path, LastError());
+	}
+	created = false;
+}
+
+void RollingFileWriter::DeleteOldFiles(const std::wstring& fileName) {
+	if (!m_filesFound) {
+		std::filesystem::path pattern(m_directory);
+		std::filesystem::path name(m_fileName);
+		pattern /= name.filename().stem();
+		pattern += '.';
+
+		fmt::basic_memory_buffer<char, kFrequencyOutputBufferSize> buffer;
+		fmt::format_to(buffer, kFrequencyInfos[static_cast<std::uint8_t>(m_frequency)].pattern, "????", "??", "??", "??", "??", "??", "??");
+		pattern += std::string_view(buffer.data(), buffer.size());
+
+		// additional files for a period only exist when using a size limit
+		std::vector<std::wstring> files;
+		for (std::uint32_t i = 0; i < (m_maxFileSize ? 2 : 1); ++i) {
+			std::filesystem::path glob(pattern);
+			if (i) {
+				glob += kFileIndexGlob;
+			}
+			glob += name.extension();
+
+			WIN32_FIND_DATAW findData;
+			HANDLE hFindResult = FindFirstFileExW(glob.c_str(), FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+			if (hFindResult == INVALID_HANDLE_VALUE) {  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast): INVALID_HANDLE_VALUE is part of the Windows API.
+				if (const DWORD lastError = GetLastError(); lastError != ERROR_FILE_NOT_FOUND) {
+					LLAMALOG_INTERNAL_WARN("Error deleting log: {}", error_code{lastError});
+					// do not try to delete anything on find errors, search again at next roll over
+					return;
+				}
+				continue;
+			}
+			do {
+				files.emplace_back(findData.cFileName);
+			} while (FindNextFileW(hFindResult, &findData));  // NOLINT(readability-implicit-bool-conversion): Compare BOOL in a condition.
+			const DWORD error = GetLastError();
+			if (error != ERROR_NO_MORE_FILES) {
+				LLAMALOG_INTERNAL_WARN("Error deleting log: {}", error_code{error});
+			}
+			if (!FindClose(hFindResult)) {
+				LLAMALOG_INTERNAL_WARN("Error deleting log: {}", LastError());
+				// just leave the handle open
+			}
+			if (error != ERROR_NO_MORE_FILES) {
+				// do not try to delete anything on find errors, search again at next roll over
+				return;
+			}
+		}
+		std::sort(files.begin(), files.end());
+		m_files = std::move(files);
+		m_filesFound = true;
+	}
+
+	// the current file is always the newest
+	if (const auto it = std::lower_bound(m_files.cbegin(), m_files.cend(), fileName); it == m_files.cend() || *it != fileName) {
+		m_files.insert(it, fileName);
+	}
+	if (m_files.size() <= static_cast<std::size_t>(m_maxFiles) + 1) {
+		return;
+	}
+
+	const auto end = m_files.begin() + static_cast<std::ptrdiff_t>(m_files.size() - m_maxFiles - 1);
+	auto out = m_files.begin();
+	for (auto it = m_files.begin(); it != end; ++it) {
+		const std::filesystem::path file = std::filesystem::path(m_directory) / *it;
+		if (!DeleteFileW(file.c_str())) {
+			const DWORD lastError = GetLastError();
+			LLAMALOG_INTERNAL_WARN("Error deleting log '{}': {}", *it, error_code{lastError});
+			if (lastError != ERROR_FILE_NOT_FOUND) {
+				// keep the file to try again at the next roll over
+				if (out != it) {
+					*out = std::move(*it);
+				}
+				++out;
+			}
+		}
+	}
+	m_files.erase(out, end);
 }
 
 }  // namespace llamalog
@@ -46,6 +46,7 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SO
 #include "llamalog/Logger.h"
 
 #include "llamalog/LogLine.h"
+#include "llamalog/LogSite.h"
 #include "llamalog/LogWriter.h"
 #include "llamalog/finally.h"
 #include "llamalog/winapi_log.h"
@@ -53,6 +54,7 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SO
 #include <windows.h>
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <cinttypes>
 #include <cstddef>
@@ -72,7 +74,9 @@ namespace llamalog {
 namespace {
 
 /// @brief A lock free buffer supporting parallel readers and writers.
+/// @tparam kBytes The approximate size of the buffer in bytes.
 /// @copyright Derived from `class Buffer` from NanoLog.
+template <std::size_t kBytes>
 class Buffer final {
 public:
 	/// @brief Initialize the internal structures.
@@ -131,10 +135,10 @@ public:
 
 public:
 	/// @brief The number of elements in the buffer.
-	/// @details The size of `m_buffer` is just under 8 MB (to account for the two atomic fields.
+	/// @details The size of `m_buffer` is just under @p kBytes (to account for the two atomic fields.
 	/// @copyright Same as `Buffer::size` from NanoLog.
 	static constexpr std::uint_fast32_t kBufferSize =
-		(8388608 - sizeof(std::atomic_uint_fast32_t) - sizeof(std::atomic_bool)) / sizeof(LogLine);
+		(kBytes - sizeof(std::atomic_uint_fast32_t) - sizeof(std::atomic_bool)) / sizeof(LogLine);
 
 private:
 	static_assert((sizeof(LogLine) & (sizeof(LogLine) - 1)) == 0, "size of LogLine is not a power of 2");
@@ -180,7 +184,9 @@ private:
 
 
 /// @brief A queue built using multiple `Buffer` objects.
+/// @tparam kBytes The approximate size of each `Buffer` in bytes.
 /// @copyright Same as `class QueueBuffer` from NanoLog.
+template <std::size_t kBytes>
 class QueueBuffer final {
 public:
 	/// @brief Create a new queue.
@@ -204,13 +210,13 @@ public:
 	/// @copyright Same as `QueueBuffer::push` from NanoLog.
 	void Push(LogLine&& logLine) {
 		const std::uint_fast32_t writeIndex = m_writeIndex.fetch_add(1, std::memory_order_relaxed);
-		if (writeIndex < Buffer::kBufferSize) {
+		if (writeIndex < Buffer<kBytes>::kBufferSize) {
 			if (m_currentWriteBuffer.load(std::memory_order_acquire)->Push(writeIndex, std::move(logLine))) {
 				SetupNextWriteBuffer();
 			}
 		} else {
 			// someone else is preparing a new buffer
-			while (m_writeIndex.load(std::memory_order_acquire) >= Buffer::kBufferSize) {
+			while (m_writeIndex.load(std::memory_order_acquire) >= Buffer<kBytes>::kBufferSize) {
 				// empty
 			}
 			Push(std::move(logLine));
@@ -226,7 +232,7 @@ public:
 			m_currentReadBuffer = GetNextReadBuffer();
 		}
 
-		Buffer* const readBuffer = m_currentReadBuffer;
+		Buffer<kBytes>* const readBuffer = m_currentReadBuffer;
 
 		if (!readBuffer) {
 			return false;
@@ -234,7 +240,7 @@ public:
 
 		if (readBuffer->TryPop(m_readIndex, pLogLine)) {
 			++m_readIndex;
-			if (m_readIndex == Buffer::kBufferSize) {
+			if (m_readIndex == Buffer<kBytes>::kBufferSize) {
 				m_readIndex = 0;
 				m_currentReadBuffer = nullptr;
 
@@ -256,10 +262,10 @@ public:
 	template <typename W>
 	void Flush(const bool flushToEmpty, W&& wait) {
 		while (true) {
-			const Buffer* const writeBuffer = m_currentWriteBuffer.load(std::memory_order_acquire);
+			const Buffer<kBytes>* const writeBuffer = m_currentWriteBuffer.load(std::memory_order_acquire);
 			const std::uint_fast32_t writeIndex = m_writeIndex.load(std::memory_order_acquire);
 			// check if still the same
-			if (m_currentWriteBuffer.load(std::memory_order_acquire) != writeBuffer || writeIndex >= Buffer::kBufferSize) {
+			if (m_currentWriteBuffer.load(std::memory_order_acquire) != writeBuffer || writeIndex >= Buffer<kBytes>::kBufferSize) {
 				// read again without waiting
 				continue;
 			}
@@ -267,10 +273,10 @@ public:
 			// The following loop is run once when flushing to empty, i.e. the write position is updated after each turn
 			do {
 				// if m_currentReadBuffer == nullptr, the processing loop has not yet started
-				const Buffer* const readBuffer = m_currentReadBuffer;
+				const Buffer<kBytes>* const readBuffer = m_currentReadBuffer;
 				const std::uint_fast32_t readIndex = m_readIndex;
 				// check if still the same
-				if (m_currentReadBuffer != readBuffer || readIndex >= Buffer::kBufferSize) {
+				if (m_currentReadBuffer != readBuffer || readIndex >= Buffer<kBytes>::kBufferSize) {
 					// read again without waiting
 					continue;
 				}
@@ -285,7 +291,7 @@ public:
 							// the last buffer and fully read, we're actually done
 							return;
 						}
-						if (std::none_of(m_buffers.cbegin(), std::prev(m_buffers.cend()), [writeBuffer](const std::unique_ptr<Buffer>& ptr) noexcept {
+						if (std::none_of(m_buffers.cbegin(), std::prev(m_buffers.cend()), [writeBuffer](const std::unique_ptr<Buffer<kBytes>>& ptr) noexcept {
 								return ptr.get() == writeBuffer;
 							})) {
 							// write buffer is no longer queued
@@ -304,7 +310,7 @@ private:
 	/// @brief Create a new `Buffer` for writing.
 	/// @copyright Same as `QueueBuffer::setup_next_write_buffer` from NanoLog.
 	void SetupNextWriteBuffer() {
-		std::unique_ptr<Buffer> nextWriteBuffer = std::make_unique<Buffer>();
+		std::unique_ptr<Buffer<kBytes>> nextWriteBuffer = std::make_unique<Buffer<kBytes>>();
 		m_currentWriteBuffer.store(nextWriteBuffer.get(), std::memory_order_release);
 
 		SpinLock spinLock(m_flag);
@@ -315,7 +321,7 @@ private:
 	/// @brief Get next `Buffer` for reading.
 	/// @return The next `Buffer` or `nullptr` if none is currently available.
 	/// @copyright Same as `QueueBuffer::get_next_read_buffer` from NanoLog.
-	[[nodiscard]] Buffer* GetNextReadBuffer() noexcept {
+	[[nodiscard]] Buffer<kBytes>* GetNextReadBuffer() noexcept {
 		SpinLock spinLock(m_flag);
 		return m_buffers.empty() ? nullptr : m_buffers.front().get();  // might throw, will crash, nothing we could do anyway
 	}
@@ -325,30 +331,44 @@ private:
 	std::uint_fast32_t m_readIndex = 0;  ///< @brief The next index for reading. @hideinitializer
 
 	/// @copyright Same as `QueueBuffer::m_current_read_buffer` from NanoLog.
-	Buffer* m_currentReadBuffer = nullptr;  ///< @brief The buffer used for reading entries. @hideinitializer
+	Buffer<kBytes>* m_currentReadBuffer = nullptr;  ///< @brief The buffer used for reading entries. @hideinitializer
 
 	/// @copyright Same as `QueueBuffer::m_write_index` from NanoLog.
 	std::atomic_uint_fast32_t m_writeIndex = 0;  ///< @brief The next free index in the buffer. @hideinitializer
 
 	/// @copyright Same as `QueueBuffer::m_current_write_buffer` from NanoLog.
-	std::atomic<Buffer*> m_currentWriteBuffer;  ///< @brief The buffer used for writing new entries.
+	std::atomic<Buffer<kBytes>*> m_currentWriteBuffer;  ///< @brief The buffer used for writing new entries.
 
 	/// @copyright Same as `QueueBuffer::m_flag` from NanoLog.
 	std::atomic_flag m_flag = ATOMIC_FLAG_INIT;  ///< @brief Flag protecting the `m_buffers` structure. @hideinitializer
 
 	/// @copyright Same as `QueueBuffer::m_buffers` from NanoLog.
-	_Guarded_by_(m_flag) std::deque<std::unique_ptr<Buffer>> m_buffers;  ///< @brief The queue of buffers.
+	_Guarded_by_(m_flag) std::deque<std::unique_ptr<Buffer<kBytes>>> m_buffers;  ///< @brief The queue of buffers.
 };
 
 
+}  // namespace
+
+namespace internal {
+
+namespace {
+
+/// @brief The logger which owns the current thread, i.e. either the logger thread, a thread writing synchronously or a
+/// background thread of one of the writers.
+thread_local Logger* g_pThreadLogger = nullptr;
+
+}  // namespace
+
 /// @brief The main logger class.
 /// @copyright Derived from `NanoLogger` from NanoLog.
 class Logger final {
 public:
 	/// @brief Create a new logger connected to a writer.
+	/// @param isDefault `true` for the default logger which also reports messages suppressed at sites without a target.
 	/// @copyright Derived from `NanoLogger::NanoLogger` from NanoLog.
-	explicit Logger()
-		: m_thread(&Logger::Pop, this) {
+	explicit Logger(const bool isDefault)
+		: m_isDefault(isDefault)
+		, m_thread(&Logger::Pop, this) {
 		// empty
 	}
 
@@ -386,6 +406,11 @@ public:
 			LLAMALOG_INTERNAL_WARN("Error configuring thread: {}", LastError());
 		}
 
+		// wake up in time for writers which need periodic commits
+		for (const std::unique_ptr<LogWriter>& logWriter : m_logWriters) {
+			m_waitInterval = std::min<DWORD>(m_waitInterval, logWriter->GetCommitInterval());
+		}
+
 		m_state.store(State::kReady, std::memory_order_release);
 		WakeAllConditionVariable(&m_wakeConsumer);
 	}
@@ -396,110 +421,345 @@ public:
 		m_logWriters.push_back(std::move(logWriter));
 	}
 
+	/// @brief Enable or disable suppression of repeated messages.
+	/// @param enabled `true` to collapse consecutive identical messages.
+	void SetRepeatSuppression(const bool enabled) noexcept {
+		m_suppressRepeated.store(enabled, std::memory_order_relaxed);
+	}
+
+	/// @brief Enable or disable writing of `Priority::kFatal` events on the calling thread.
+	/// @param enabled `true` to write fatal events synchronously.
+	void SetSynchronousFatal(const bool enabled) noexcept {
+		if (enabled && !m_lockWrites.load(std::memory_order_acquire) && g_pThreadLogger != this) {
+			// wait until the logger thread is idle because it only takes m_writeLock afterwards
+			// the lock is never dropped again because another thread might already be waiting for it
+			AcquireSRWLockExclusive(&m_lock);
+			m_lockWrites.store(true, std::memory_order_release);
+			ReleaseSRWLockExclusive(&m_lock);
+		}
+		m_synchronousFatal.store(enabled, std::memory_order_relaxed);
+	}
+
 	/// @brief Adds a new `LogLine`.
+	/// @details Events with `Priority::kError` or above are added to a separate queue which is processed first.
 	/// @param logLine The `LogLine`.
-	/// @copyright Same as `NanoLogger::add` from NanoLog.
+	/// @copyright Derived from `NanoLogger::add` from NanoLog.
 	void AddLine(LogLine&& logLine) {
-		m_buffer.Push(std::move(logLine));
+		logLine.SetSequence(m_sequence.fetch_add(1, std::memory_order_relaxed));
+		const Priority priority = logLine.GetPriority();
+		if (priority < Priority::kError) {
+			m_buffer.Push(std::move(logLine));
+		} else if (priority >= Priority::kFatal && m_synchronousFatal.load(std::memory_order_relaxed) && m_lockWrites.load(std::memory_order_acquire) && m_state.load(std::memory_order_acquire) == State::kReady && g_pThreadLogger != this) {
+			// g_pThreadLogger is set for the logger thread and any thread already holding m_writeLock
+			WriteSynchronous(std::move(logLine));
+			return;
+		} else {
+			m_priorityBuffer.Push(std::move(logLine));
+		}
 		WakeConditionVariable(&m_wakeConsumer);
 	}
 
 	/// @brief Waits until all currently available entries have been written.
-	void Flush() {
+	/// @param durable `true` to also wait until all writers have made their output durable.
+	void Flush(const bool durable) {
 		AcquireSRWLockShared(&m_lock);
 		while (m_state.load(std::memory_order_acquire) == State::kInit) {
 			SleepConditionVariableSRW(&m_wakeConsumer, &m_lock, kConditionInterval, CONDITION_VARIABLE_LOCKMODE_SHARED);
 		}
-		m_buffer.Flush(false, [this]() noexcept {
+		// threads writing synchronously read from the priority buffer while holding m_writeLock only
+		AcquireSRWLockShared(&m_writeLock);
+		const auto wait = [this]() noexcept {
+			ReleaseSRWLockShared(&m_writeLock);
 			ReleaseSRWLockShared(&m_lock);
 			// do not use SleepConditionVariableSRW so that regular `AddLine` does not have to do a WakeAllConditionVariable
 			Sleep(kFlushInterval);
 			AcquireSRWLockShared(&m_lock);
-		});
+			AcquireSRWLockShared(&m_writeLock);
+		};
+		m_priorityBuffer.Flush(false, wait);
+		m_buffer.Flush(false, wait);
+		ReleaseSRWLockShared(&m_writeLock);
 		ReleaseSRWLockShared(&m_lock);
+
+		if (durable) {
+			// a single commit covers all events written so far, also the ones of other threads
+			// the logger thread does not hold m_writeLock unless synchronous writing is enabled
+			AcquireSRWLockExclusive(&m_lock);
+			AcquireSRWLockExclusive(&m_writeLock);
+			Logger* const pThreadLogger = std::exchange(g_pThreadLogger, this);
+			Commit(true);
+			g_pThreadLogger = pThreadLogger;
+			ReleaseSRWLockExclusive(&m_writeLock);
+			ReleaseSRWLockExclusive(&m_lock);
+		}
 	}
 
 private:
+	/// @brief The identity of the last message from a queue sent to the writers.
+	struct LastLine {
+		std::uint64_t hash;                ///< @brief The result of `LogLine::GetHash`.
+		const char* file;                  ///< @brief The file name.
+		const char* function;              ///< @brief The function name.
+		const char* pattern;               ///< @brief The message pattern.
+		std::uint32_t line;                ///< @brief The line number.
+		Priority priority;                 ///< @brief The `#Priority`.
+		std::vector<std::byte> arguments;  ///< @brief The encoded arguments for comparison if the hash is the same.
+		std::uint32_t repeated;            ///< @brief The number of repetitions.
+		ULONGLONG repeatedSince;           ///< @brief The time of the first repetition.
+	};
+
 	/// @brief Main method of the writing thread.
 	/// @copyright Same as `NanoLogger::pop` from NanoLog.
 	void Pop() noexcept {
+		g_pThreadLogger = this;
 		AcquireSRWLockExclusive(&m_lock);
 		while (m_state.load(std::memory_order_acquire) == State::kInit) {
 			SleepConditionVariableSRW(&m_wakeConsumer, &m_lock, kConditionInterval, 0);
 		}
 
+		ULONGLONG nextReport = GetTickCount64() + kReportInterval;
+		std::uint32_t uncommitted = 0;
+		while (m_state.load() == State::kReady) {
+			// the value only changes while the logger thread waits for events
+			const bool lockWrites = m_lockWrites.load(std::memory_order_relaxed);
+			if (lockWrites) {
+				AcquireSRWLockExclusive(&m_writeLock);
+			}
+			const ULONGLONG now = GetTickCount64();
+			if (now >= nextReport) {
+				ReportSuppressed();
+				nextReport = now + kReportInterval;
+			}
+			for (LastLine& lastLine : m_lastLines) {
+				if (lastLine.repeated && now - lastLine.repeatedSince >= kConditionInterval) {
+					ReportRepeated(lastLine);
+				}
+			}
+			const bool processed = ProcessNext(false);
+			// group commit: let writers complete deferred output when the queue is empty or after a batch of events
+			if (!processed || ++uncommitted == kCommitBatchSize) {
+				Commit(false);
+				uncommitted = 0;
+			}
+			if (lockWrites) {
+				ReleaseSRWLockExclusive(&m_writeLock);
+			}
+			if (!processed) {
+				SleepConditionVariableSRW(&m_wakeConsumer, &m_lock, m_waitInterval, 0);
+			}
+		}
+
+		// pop and log all remaining entries
+		AcquireSRWLockExclusive(&m_writeLock);
+		ReportSuppressed();
+		while (ProcessNext(false)) {
+			// empty
+		}
+		// stop background activity of the writers and log any events added in the meantime
+		Close();
+		while (ProcessNext(false)) {
+			// empty
+		}
+		for (LastLine& lastLine : m_lastLines) {
+			ReportRepeated(lastLine);
+		}
+		Commit(false);
+		ReleaseSRWLockExclusive(&m_writeLock);
+
+		ReleaseSRWLockExclusive(&m_lock);
+	}
+
+	/// @brief Send the next available `LogLine` to the writers.
+	/// @details Events from the queue for errors are always processed first.
+	/// @note The caller MUST hold `m_writeLock` unless it is the logger thread and `m_lockWrites` is `false`.
+	/// @param priorityOnly `true` to process events from the queue for errors only.
+	/// @return `true` if an event has been processed, `false` if the queue is empty.
+	bool ProcessNext(const bool priorityOnly) noexcept {
 		// the place where the log line is copied to
 		std::byte buffer[sizeof(LogLine)];
 		LogLine* const pLogLine = reinterpret_cast<LogLine*>(buffer);
 
-		while (m_state.load() == State::kReady) {
-			if (m_buffer.TryPop(pLogLine)) {
-				// release any resources of the log line as quickly as possible
-				auto finally = llamalog::finally([pLogLine]() noexcept {
-					pLogLine->~LogLine();
-				});
-
-				const Priority priority = pLogLine->GetPriority();
-				for (const std::unique_ptr<LogWriter>& logWriter : m_logWriters) {
-					if (logWriter->IsLogged(priority)) {
-						internal::AdjustPriority(priority, 1u);
-						try {
-							logWriter->Log(*pLogLine);
-						} catch (const std::exception& e) {
-							try {
-								internal::AdjustPriority(priority, 2u);
-								LLAMALOG_INTERNAL_ERROR("Error writing log: {}", e);
-							} catch (...) {
-								LLAMALOG_PANIC(e.what());
-							}
-						} catch (...) {
-							try {
-								internal::AdjustPriority(priority, 2u);
-								LLAMALOG_INTERNAL_ERROR("Error writing log");
-							} catch (...) {
-								LLAMALOG_PANIC("Error writing log");
-							}
-						}
-					}
-				}
-			} else {
-				SleepConditionVariableSRW(&m_wakeConsumer, &m_lock, kConditionInterval, 0);
+		if (!m_priorityBuffer.TryPop(pLogLine) && (priorityOnly || !m_buffer.TryPop(pLogLine))) {
+			return false;
+		}
+
+		// release any resources of the log line as quickly as possible
+		auto finally = llamalog::finally([pLogLine]() noexcept {
+			pLogLine->~LogLine();
+		});
+		Process(*pLogLine);
+		return true;
+	}
+
+	/// @brief Write a `LogLine` on the calling thread after all queued errors have been written.
+	/// @param logLine The `LogLine`.
+	void WriteSynchronous(LogLine&& logLine) noexcept {
+		logLine.GenerateTimestamp();
+
+		AcquireSRWLockExclusive(&m_writeLock);
+		Logger* const pThreadLogger = std::exchange(g_pThreadLogger, this);
+		while (ProcessNext(true)) {
+			// empty
+		}
+		Process(logLine);
+		Commit(false);
+		g_pThreadLogger = pThreadLogger;
+		ReleaseSRWLockExclusive(&m_writeLock);
+	}
+
+	/// @brief Send a `LogLine` to all writers unless it repeats the previous one from the same queue.
+	/// @details Repetitions are tracked per queue because events for errors overtake regular events. Else an error might
+	/// break up a run of identical events which have been added before and after it.
+	/// @param logLine The `LogLine`.
+	void Process(const LogLine& logLine) noexcept {
+		LastLine& lastLine = m_lastLines[logLine.GetPriority() < Priority::kError ? 0 : 1];
+		if (!m_suppressRepeated.load(std::memory_order_relaxed)) {
+			ReportRepeated(lastLine);
+			lastLine.hash = 0;
+			Write(logLine);
+			return;
+		}
+
+		const std::uint64_t hash = logLine.GetHash();
+		// compare the arguments because different messages might produce the same hash
+		if (hash == lastLine.hash && logLine.GetPattern() == lastLine.pattern && logLine.GetPriority() == lastLine.priority && logLine.GetLine() == lastLine.line && logLine.GetFile() == lastLine.file && logLine.GetFunction() == lastLine.function && logLine.HasEncodedArguments(lastLine.arguments)) {
+			if (!lastLine.repeated++) {
+				lastLine.repeatedSince = GetTickCount64();
 			}
+			return;
 		}
 
-		// pop and log all remaining entries
-		while (m_buffer.TryPop(pLogLine)) {
-			// release any resources of the log line as quickly as possible
-			auto finally = llamalog::finally([pLogLine]() noexcept {
-				pLogLine->~LogLine();
-			});
-
-			const Priority priority = pLogLine->GetPriority();
-			for (const std::unique_ptr<LogWriter>& logWriter : m_logWriters) {
-				if (logWriter->IsLogged(priority)) {
-					internal::AdjustPriority(priority, 1u);
+		ReportRepeated(lastLine);
+		lastLine.hash = hash;
+		lastLine.file = logLine.GetFile();
+		lastLine.function = logLine.GetFunction();
+		lastLine.pattern = logLine.GetPattern();
+		lastLine.line = logLine.GetLine();
+		lastLine.priority = logLine.GetPriority();
+		try {
+			logLine.CopyEncodedArgumentsTo(lastLine.arguments);
+		} catch (...) {
+			// never match if the arguments are not available
+			lastLine.pattern = nullptr;
+		}
+		Write(logLine);
+	}
+
+	/// @brief Send a `LogLine` to all writers.
+	/// @param logLine The `LogLine`.
+	void Write(const LogLine& logLine) noexcept {
+		const Priority priority = logLine.GetPriority();
+		for (const std::unique_ptr<LogWriter>& logWriter : m_logWriters) {
+			if (logWriter->IsLogged(priority)) {
+				internal::AdjustPriority(priority, 1u);
+				try {
+					logWriter->Log(logLine);
+				} catch (const std::exception& e) {
 					try {
-						logWriter->Log(*pLogLine);
-					} catch (const std::exception& e) {
-						try {
-							internal::AdjustPriority(priority, 2u);
-							LLAMALOG_INTERNAL_ERROR("Error writing log: {}", e);
-						} catch (...) {
-							LLAMALOG_PANIC(e.what());
-						}
+						internal::AdjustPriority(priority, 2u);
+						LLAMALOG_INTERNAL_ERROR("Error writing log: {}", e);
 					} catch (...) {
-						try {
-							internal::AdjustPriority(priority, 2u);
-							LLAMALOG_INTERNAL_ERROR("Error writing log");
-						} catch (...) {
-							LLAMALOG_PANIC("Error writing log");
-						}
+						LLAMALOG_PANIC(e.what());
+					}
+				} catch (...) {
+					try {
+						internal::AdjustPriority(priority, 2u);
+						LLAMALOG_INTERNAL_ERROR("Error writing log");
+					} catch (...) {
+						LLAMALOG_PANIC("Error writing log");
 					}
 				}
 			}
 		}
+	}
 
-		ReleaseSRWLockExclusive(&m_lock);
+	/// @brief Let all writers complete any deferred output.
+	/// @note The caller MUST hold `m_writeLock` unless it is the logger thread and `m_lockWrites` is `false`.
+	/// @param durable `true` if all output MUST be durable when the function returns.
+	void Commit(const bool durable) noexcept {
+		for (const std::unique_ptr<LogWriter>& logWriter : m_logWriters) {
+			try {
+				logWriter->Commit(durable);
+			} catch (const std::exception& e) {
+				try {
+					LLAMALOG_INTERNAL_ERROR("Error writing log: {}", e);
+				} catch (...) {
+					LLAMALOG_PANIC(e.what());
+				}
+			} catch (...) {
+				try {
+					LLAMALOG_INTERNAL_ERROR("Error writing log");
+				} catch (...) {
+					LLAMALOG_PANIC("Error writing log");
+				}
+			}
+		}
+	}
+
+	/// @brief Let all writers stop their background activity.
+	/// @note The caller MUST hold `m_writeLock`.
+	void Close() noexcept {
+		for (const std::unique_ptr<LogWriter>& logWriter : m_logWriters) {
+			try {
+				logWriter->Close();
+			} catch (const std::exception& e) {
+				try {
+					LLAMALOG_INTERNAL_ERROR("Error closing log: {}", e);
+				} catch (...) {
+					LLAMALOG_PANIC(e.what());
+				}
+			} catch (...) {
+				try {
+					LLAMALOG_INTERNAL_ERROR("Error closing log");
+				} catch (...) {
+					LLAMALOG_PANIC("Error closing log");
+				}
+			}
+		}
+	}
+
+	/// @brief Write the number of repetitions of the last message from a queue if there are any.
+	/// @param lastLine The last message from the queue.
+	void ReportRepeated(LastLine& lastLine) noexcept {
+		if (!lastLine.repeated) {
+			return;
+		}
+		try {
+			LogLine logLine(lastLine.priority, lastLine.file, lastLine.line, lastLine.function, lastLine.repeated == 1 ? "last message repeated once" : "last message repeated {} times");
+			if (lastLine.repeated > 1) {
+				logLine << lastLine.repeated;
+			}
+			logLine.GenerateTimestamp();
+			Write(logLine);
+		} catch (const std::exception& e) {
+			LLAMALOG_PANIC(e.what());
+		} catch (...) {
+			LLAMALOG_PANIC("Error reporting repeated messages");
+		}
+		lastLine.repeated = 0;
+	}
+
+	/// @brief Log the number of messages suppressed by `Sampling` for all sites which send messages to this logger.
+	/// @details The messages use the location and the `#Priority` of the suppressed messages.
+	void ReportSuppressed() noexcept {
+		// the public `Logger` uses the address of the implementation as the owner
+		const void* const pOwner = m_isDefault ? nullptr : this;
+		try {
+			for (LogSite* const pSite : GetLogSites()) {
+				if (pSite->GetOwner() != pOwner) {
+					continue;
+				}
+				Priority priority;  // NOLINT(cppcoreguidelines-init-variables): Initialized by TakeSuppressed.
+				if (const std::uint32_t suppressed = pSite->TakeSuppressed(priority); suppressed) {
+					LogLine logLine(priority, pSite->GetFile(), pSite->GetLine(), pSite->GetFunction(), "{} messages suppressed");
+					AddLine(std::move(logLine << suppressed));
+				}
+			}
+		} catch (const std::exception& e) {
+			LLAMALOG_PANIC(e.what());
+		} catch (...) {
+			LLAMALOG_PANIC("Error reporting suppressed messages");
+		}
 	}
 
 private:
@@ -513,6 +773,12 @@ private:
 
 	static constexpr DWORD kConditionInterval = 5000u;  ///< @brief Milliseconds to wait on condition before wake-up.
 	static constexpr DWORD kFlushInterval = 200u;       ///< @brief Milliseconds to wait when lock is held in flush.
+	static constexpr DWORD kReportInterval = 60000u;    ///< @brief Milliseconds between reports of suppressed messages.
+
+	static constexpr std::uint32_t kCommitBatchSize = 1024u;  ///< @brief Maximum number of events between two commits of the writers.
+
+	static constexpr std::size_t kBufferSize = 8388608u;         ///< @brief The size of each regular buffer in bytes.
+	static constexpr std::size_t kPriorityBufferSize = 262144u;  ///< @brief The size of each buffer for errors in bytes.
 
 	/**
 
@@ -520,26 +786,50 @@ private:
 	/// @copyright Same as `NanoLogger::m_state` from NanoLog.
 	std::atomic<State> m_state = State::kInit;  ///< @brief The current state of the logger.
 
+	const bool m_isDefault;  ///< @brief `true` for the default logger.
+
 	/// @copyright Same as `NanoLogger::m_buffer_base` from NanoLog but on stack instead of heap.
-	QueueBuffer m_buffer;  ///< @brief The buffer.
+	QueueBuffer<kBufferSize> m_buffer;                  ///< @brief The buffer.
+	QueueBuffer<kPriorityBufferSize> m_priorityBuffer;  ///< @brief The buffer for events with `Priority::kError` or above.
+	std::atomic_uint32_t m_sequence = 0;                ///< @brief The next sequence number. @hideinitializer
 
 	/// @brief A condition to trigger the worker thread. @hideinitializer
 	/// @note This MUST be declared before `m_thread` because the latter waits on this condition.
 	CONDITION_VARIABLE m_wakeConsumer = CONDITION_VARIABLE_INIT;
 
-	SRWLOCK m_lock = SRWLOCK_INIT;  ///< @brief A lock held while events are being processed.
+	SRWLOCK m_lock = SRWLOCK_INIT;       ///< @brief A lock held while events are being processed.
+	SRWLOCK m_writeLock = SRWLOCK_INIT;  ///< @brief A lock held while events are sent to the writers if `m_lockWrites` is `true`.
 
 	/// @copyright Same as `NanoLogger::m_thread` from NanoLog.
 	std::thread m_thread;  ///< @brief The thread writing the events.
 
 	/// @copyright Similar to `NanoLogger::m_file_writer` from NanoLog.
 	std::vector<std::unique_ptr<LogWriter>> m_logWriters;  ///< @brief A list of all log writers.
+
+	std::atomic_bool m_suppressRepeated = false;  ///< @brief `true` if repeated messages are collapsed. @hideinitializer
+	std::atomic_bool m_synchronousFatal = false;  ///< @brief `true` if fatal events are written by the calling thread. @hideinitializer
+	std::atomic_bool m_lockWrites = false;        ///< @brief `true` if the logger thread holds `m_writeLock` while writing. @hideinitializer
+	std::array<LastLine, 2> m_lastLines = {};     ///< @brief The last message from the regular queue and from the queue for errors. @hideinitializer
+	DWORD m_waitInterval = kConditionInterval;    ///< @brief Milliseconds to wait for events before committing again. @hideinitializer
 };
 
+}  // namespace internal
+
+namespace {
+
 /// @brief The default logger.
-std::unique_ptr<Logger> g_pLogger;
+std::unique_ptr<internal::Logger> g_pLogger;
 /// @brief An atomic reference to the default logger.
-std::atomic<Logger*> g_pAtomicLogger;
+std::atomic<internal::Logger*> g_pAtomicLogger;
+
+/// @brief Get the logger for messages without an explicit target.
+/// @details Messages logged from the logger thread, e.g. internal errors of a `LogWriter`, are sent to the logger which
+/// owns the thread.
+/// @return The logger of the current thread or the default logger.
+[[nodiscard]] internal::Logger* GetLogger() noexcept {
+	internal::Logger* const pLogger = internal::g_pThreadLogger;
+	return pLogger ? pLogger : g_pAtomicLogger.load(std::memory_order_acquire);
+}
 
 }  // namespace
 
@@ -547,10 +837,26 @@ namespace internal {
 
 // Derived from `Initialize` from NanoLog.
 void Initialize() {
-	g_pLogger = std::make_unique<Logger>();
+	g_pLogger = std::make_unique<Logger>(true);
 	g_pAtomicLogger.store(g_pLogger.get(), std::memory_order_release);
 }
 
+Logger* GetThreadLogger() noexcept {
+	return g_pThreadLogger;
+}
+
+void SetThreadLogger(Logger* const pLogger) noexcept {
+	g_pThreadLogger = pLogger;
+}
+
+void LoggerDeleter::operator()(Logger* const pLogger) const noexcept {
+	delete pLogger;  // NOLINT(cppcoreguidelines-owning-memory): Deleter for std::unique_ptr.
+}
+
+std::unique_ptr<Logger, LoggerDeleter> CreateLogger() {
+	return std::unique_ptr<Logger, LoggerDeleter>(new Logger(false));
+}
+
 void Start() {
 	std::atomic_thread_fence(std::memory_order_release);
 	g_pAtomicLogger.load(std::memory_order_acquire)->Start();
@@ -614,16 +920,52 @@ void AddWriter(std::unique_ptr<LogWriter>&& writer) {
 
 // Derived from `Log::operator==` from NanoLog.
 void Log(LogLine& logLine) {
-	g_pAtomicLogger.load(std::memory_order_acquire)->AddLine(std::move(logLine));
+	GetLogger()->AddLine(std::move(logLine));
 }
 
 // Derived from `Log::operator==` from NanoLog.
 void Log(LogLine&& logLine) {
-	g_pAtomicLogger.load(std::memory_order_acquire)->AddLine(std::move(logLine));
+	GetLogger()->AddLine(std::move(logLine));
+}
+
+void SetRepeatSuppression(const bool enabled) noexcept {
+	g_pAtomicLogger.load(std::memory_order_acquire)->SetRepeatSuppression(enabled);
+}
+
+void SetSynchronousFatal(const bool enabled) noexcept {
+	g_pAtomicLogger.load(std::memory_order_acquire)->SetSynchronousFatal(enabled);
+}
+
+void Flush(const bool durable) {
+	g_pAtomicLogger.load(std::memory_order_acquire)->Flush(durable);
+}
+
+void Logger::AddWriter(std::unique_ptr<LogWriter>&& writer) {
+	m_pLogger->AddWriter(std::move(writer));
+}
+
+void Logger::Start() {
+	m_pLogger->Start();
+}
+
+void Logger::Log(LogLine& logLine) {
+	m_pLogger->AddLine(std::move(logLine));
+}
+
+void Logger::Log(LogLine&& logLine) {
+	m_pLogger->AddLine(std::move(logLine));
+}
+
+void Logger::SetRepeatSuppression(const bool enabled) noexcept {
+	m_pLogger->SetRepeatSuppression(enabled);
+}
+
+void Logger::SetSynchronousFatal(const bool enabled) noexcept {
+	m_pLogger->SetSynchronousFatal(enabled);
 }
 
-void Flush() {
-	g_pAtomicLogger.load(std::memory_order_acquire)->Flush();
+void Logger::Flush(const bool durable) {
+	m_pLogger->Flush(durable);
 }
 
 void Shutdown() noexcept {
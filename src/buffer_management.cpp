@@ -27,6 +27,9 @@ limitations under the License.
 
 #include <fmt/core.h>
 
+#include <windows.h>
+
+#include <atomic>
 #include <cassert>
 #include <cstddef>
 #include <cstring>
@@ -37,6 +40,8 @@ limitations under the License.
 namespace llamalog {
 
 using marker::InlineChar;
+using marker::InlineHexDump;
+using marker::InlineRange;
 using marker::InlineWideChar;
 using marker::NonTriviallyCopyable;
 using marker::NullValue;
@@ -143,6 +148,59 @@ void DecodeArgument<const wchar_t*>(_Inout_ std::vector<fmt::format_context::for
 	position += kTypeSize<const wchar_t*> + padding + length * static_cast<LogLine::Size>(sizeof(wchar_t));
 }
 
+/// @brief Decode an argument from the buffer. @details The argument is made available for formatting by appending it to
+/// @p args. The value of @p position is advanced after decoding.
+/// This is the specialization used for string literals which are stored by address.
+/// @param args The vector of format arguments.
+/// @param buffer The argument buffer.
+/// @param position The current read position.
+template <>
+void DecodeArgument<literal>(_Inout_ std::vector<fmt::format_context::format_arg>& args, _In_ const std::byte* __restrict const buffer, _Inout_ LogLine::Size& position) {
+	const LogLine::Size pos = position + sizeof(TypeId);
+	const LogLine::Align padding = GetPadding<literal>(&buffer[pos]);
+
+	const std::byte* __restrict const pData = &buffer[pos + padding];
+	if (IsEscaped(static_cast<TypeId>(buffer[position]))) {
+		args.push_back(fmt::detail::make_arg<fmt::format_context>(*reinterpret_cast<const internal::EscapedArgument<literal>*>(pData)));
+	} else {
+		args.push_back(fmt::detail::make_arg<fmt::format_context>(*reinterpret_cast<const literal*>(pData)));
+	}
+	position += kTypeSize<literal> + padding;
+}
+
+/// @brief Decode an argument from the buffer. @details The argument is made available for formatting by appending it to
+/// @p args. The value of @p position is advanced after decoding.
+/// This is the specialization used for ranges of values stored inline.
+/// @param args The vector of format arguments.
+/// @param buffer The argument buffer.
+/// @param position The current read position.
+template <>
+void DecodeArgument<InlineRange>(_Inout_ std::vector<fmt::format_context::format_arg>& args, _In_ const std::byte* __restrict const buffer, _Inout_ LogLine::Size& position) {
+	const TypeId elementTypeId = GetValue<TypeId>(&buffer[position + sizeof(TypeId)]);
+	const LogLine::Length length = GetValue<LogLine::Length>(&buffer[position + sizeof(TypeId) + sizeof(elementTypeId)]);
+	const LogLine::Align elementSize = GetRangeElementSize(elementTypeId);
+	const LogLine::Align padding = GetPadding(&buffer[position + kTypeSize<InlineRange>], elementSize);
+
+	// numbers never require escaping
+	args.push_back(fmt::detail::make_arg<fmt::format_context>(*reinterpret_cast<const InlineRange*>(&buffer[position + sizeof(TypeId)])));
+	position += kTypeSize<InlineRange> + padding + length * elementSize;
+}
+
+/// @brief Decode an argument from the buffer. @details The argument is made available for formatting by appending it to
+/// @p args. The value of @p position is advanced after decoding.
+/// This is the specialization used for binary data stored inline.
+/// @param args The vector of format arguments.
+/// @param buffer The argument buffer.
+/// @param position The current read position.
+template <>
+void DecodeArgument<hexdump>(_Inout_ std::vector<fmt::format_context::format_arg>& args, _In_ const std::byte* __restrict const buffer, _Inout_ LogLine::Size& position) {
+	const LogLine::Length length = GetValue<LogLine::Length>(&buffer[position + sizeof(TypeId)]);
+
+	// hex digits never require escaping
+	args.push_back(fmt::detail::make_arg<fmt::format_context>(*reinterpret_cast<const InlineHexDump*>(&buffer[position + sizeof(TypeId)])));
+	position += kTypeSize<hexdump> + length;
+}
+
 /// @brief Decode an argument from the buffer. @details The argument is made available for formatting by appending it to
 /// @p args. The value of @p position is advanced after decoding. This function handles `ptr` pointers stored inline.
 /// @tparam T The type of the argument.
@@ -399,6 +457,27 @@ __declspec(noalias) void SkipInlineString<wchar_t>(_In_ const std::byte* __restr
 	position += kTypeSize<const wchar_t*> + padding + length * static_cast<LogLine::Size>(sizeof(wchar_t));
 }
 
+/// @brief Skip a log argument of type `InlineRange`.
+/// @param buffer The argument buffer.
+/// @param position The current read position. The value is set to the start of the next argument.
+__declspec(noalias) void SkipInlineRange(_In_ const std::byte* __restrict const buffer, _Inout_ LogLine::Size& position) noexcept {
+	const TypeId elementTypeId = GetValue<TypeId>(&buffer[position + sizeof(TypeId)]);
+	const LogLine::Length length = GetValue<LogLine::Length>(&buffer[position + sizeof(TypeId) + sizeof(elementTypeId)]);
+	const LogLine::Align elementSize = GetRangeElementSize(elementTypeId);
+	const LogLine::Align padding = GetPadding(&buffer[position + kTypeSize<InlineRange>], elementSize);
+
+	position += kTypeSize<InlineRange> + padding + length * elementSize;
+}
+
+/// @brief Skip a log argument of type `hexdump`.
+/// @param buffer The argument buffer.
+/// @param position The current read position. The value is set to the start of the next argument.
+__declspec(noalias) void SkipHexDump(_In_ const std::byte* __restrict const buffer, _Inout_ LogLine::Size& position) noexcept {
+	const LogLine::Length length = GetValue<LogLine::Length>(&buffer[position + sizeof(TypeId)]);
+
+	position += kTypeSize<hexdump> + length;
+}
+
 /// @brief Skip a log argument of type `PlainException`.
 /// @param buffer The argument buffer.
 /// @param position The current read position. The value is set to the start of the next argument.
@@ -498,7 +577,8 @@ void CopyHeapBasedException(_In_ const std::byte* __restrict const src, _Out_ st
 
 	std::memcpy(pDstException, pSrcException, sizeof(HeapBasedException) + pSrcException->exceptionInformation.length * sizeof(char));
 
-	std::unique_ptr<std::byte[]> heapBuffer = std::make_unique<std::byte[]>(pSrcException->exceptionInformation.used);
+	LogLine::Size heapBufferSize = pSrcException->exceptionInformation.used;
+	std::unique_ptr<std::byte[], internal::HeapBufferDeleter> heapBuffer(AllocateHeapBuffer(heapBufferSize));
 	pDstException->pHeapBuffer = heapBuffer.get();
 
 	if (pSrcException->exceptionInformation.hasNonTriviallyCopyable) {
@@ -645,11 +725,16 @@ void MoveNonTriviallyCopyable(_Inout_ std::byte* __restrict const src, _Out_ std
 	// copy management data
 	std::memcpy(&dst[position], &src[position], kArgSize);
 
-	// create the argument in the new position
 	const LogLine::Size offset = position + kArgSize + padding;
-	pFunctionTable->move(&src[offset], &dst[offset]);
-	// and destruct the copied-from version
-	pFunctionTable->destruct(&src[offset]);
+	if (pFunctionTable->relocatable) {
+		// the bytes may simply be copied without calling the destructor of the original
+		std::memcpy(&dst[offset], &src[offset], size);
+	} else {
+		// create the argument in the new position
+		pFunctionTable->move(&src[offset], &dst[offset]);
+		// and destruct the copied-from version
+		pFunctionTable->destruct(&src[offset]);
+	}
 
 	position = offset + size;
 }
@@ -701,7 +786,7 @@ void DestructHeapBasedException(_In_ const std::byte* __restrict const buffer, _
 		CallDestructors(pException->pHeapBuffer, pException->exceptionInformation.used);
 	}
 
-	delete[] pException->pHeapBuffer;
+	FreeHeapBuffer(pException->pHeapBuffer);
 
 	position = offset + sizeof(HeapBasedException) + pException->exceptionInformation.length * sizeof(char);
 }
@@ -779,6 +864,9 @@ void CopyArgumentsFromBufferTo(_In_reads_bytes_(used) const std::byte* __restric
 			DECODE_(const void*);
 			DECODE_(const char*);
 			DECODE_(const wchar_t*);
+			DECODE_(literal);
+			DECODE_(InlineRange);
+			DECODE_(hexdump);
 			DECODE_(StackBasedException);
 			DECODE_(StackBasedSystemError);
 			DECODE_(HeapBasedException);
@@ -846,6 +934,15 @@ void CopyObjects(_In_reads_bytes_(used) const std::byte* __restrict const src, _
 		case kTypeId<const wchar_t*>:
 			SkipInlineString<wchar_t>(src, position);
 			break;
+		case kTypeId<literal>:
+			SkipPointer<literal>(src, position);
+			break;
+		case kTypeId<InlineRange>:
+			SkipInlineRange(src, position);
+			break;
+		case kTypeId<hexdump>:
+			SkipHexDump(src, position);
+			break;
 		case kTypeId<StackBasedException>:
 			// first copy any trivially copyable objects up to here
 			std::memcpy(&dst[start], &src[start], position - start);
@@ -948,6 +1045,15 @@ void MoveObjects(_In_reads_bytes_(used) std::byte* __restrict const src, _Out_wr
 		case kTypeId<const wchar_t*>:
 			SkipInlineString<wchar_t>(src, position);
 			break;
+		case kTypeId<literal>:
+			SkipPointer<literal>(src, position);
+			break;
+		case kTypeId<InlineRange>:
+			SkipInlineRange(src, position);
+			break;
+		case kTypeId<hexdump>:
+			SkipHexDump(src, position);
+			break;
 		case kTypeId<StackBasedException>:
 			// first copy any trivially copyable objects up to here
 			std::memcpy(&dst[start], &src[start], position - start);
@@ -1046,6 +1152,15 @@ void CallDestructors(_Inout_updates_bytes_(used) std::byte* __restrict buffer, L
 		case kTypeId<const wchar_t*>:
 			SkipInlineString<wchar_t>(buffer, position);
 			break;
+		case kTypeId<literal>:
+			SkipPointer<literal>(buffer, position);
+			break;
+		case kTypeId<InlineRange>:
+			SkipInlineRange(buffer, position);
+			break;
+		case kTypeId<hexdump>:
+			SkipHexDump(buffer, position);
+			break;
 		case kTypeId<StackBasedException>:
 			DestructStackBasedException(buffer, position);
 			break;
@@ -1081,5 +1196,161 @@ void CallDestructors(_Inout_updates_bytes_(used) std::byte* __restrict buffer, L
 	}
 }
 
+//
+// Heap Buffers
+//
+
+namespace {
+
+/// @brief The type of the function allocating heap buffers.
+using Allocate = void* (*)(std::size_t);
+
+/// @brief The type of the function releasing heap buffers.
+using Deallocate = void (*)(void*, std::size_t) noexcept;
+
+/// @brief Information stored in front of each heap buffer.
+struct HeapBufferHeader final {
+	Deallocate deallocate;  ///< @brief The function to release the memory.
+	LogLine::Size size;     ///< @brief The usable size of the buffer in bytes.
+};
+
+/// @brief The number of bytes reserved for the `HeapBufferHeader`. @details The value keeps the alignment of the buffer.
+constexpr std::size_t kHeapBufferHeaderSize = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+static_assert(sizeof(HeapBufferHeader) <= kHeapBufferHeaderSize, "size of HeapBufferHeader");
+static_assert(MEMORY_ALLOCATION_ALIGNMENT <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "alignment of SLIST_ENTRY");
+static_assert(sizeof(SLIST_ENTRY) <= kGrowBytes, "size of SLIST_ENTRY");
+
+/// @brief The number of pools, i.e. one for each power of 2 from `#kGrowBytes` to `#kMaxPooledBytes`.
+constexpr std::uint_fast8_t kPoolCount = 8;
+static_assert(kGrowBytes << (kPoolCount - 1u) == kMaxPooledBytes, "number of pools");
+
+/// @brief The maximum number of buffers kept in each pool.
+constexpr USHORT kMaxPoolDepth = 8;
+
+/// @brief The default function for allocating heap buffers.
+/// @param size The size in bytes.
+/// @return The allocated memory.
+[[nodiscard]] void* DefaultAllocate(const std::size_t size) {
+	return ::operator new(size);
+}
+
+/// @brief The default function for releasing heap buffers.
+/// @param ptr The memory.
+void DefaultDeallocate(void* const ptr, std::size_t /* size */) noexcept {
+	::operator delete(ptr);
+}
+
+/// @brief The functions set by `#SetHeapBufferAllocator`.
+struct Allocator final {
+	Allocate allocate;      ///< @brief The function for allocating heap buffers.
+	Deallocate deallocate;  ///< @brief The function for releasing heap buffers.
+};
+
+/// @brief Lock for changing `#g_allocator`.
+SRWLOCK g_allocatorLock = SRWLOCK_INIT;
+
+/// @brief The functions for new heap buffers. @details The functions are read together to never mix old and new ones.
+_Guarded_by_(g_allocatorLock) Allocator g_allocator = {&DefaultAllocate, &DefaultDeallocate};
+
+/// @brief A copy of `Allocator::deallocate` of `#g_allocator` for checking pooled buffers without a lock.
+std::atomic<Deallocate> g_deallocate = &DefaultDeallocate;
+
+/// @brief Lock free lists of released buffers, one for each size. @details Zero-initialization yields empty lists.
+SLIST_HEADER g_pools[kPoolCount];
+
+/// @brief Get the pool for a buffer size.
+/// @param size The size which MUST be a power of 2 in the range `#kGrowBytes` to `#kMaxPooledBytes`.
+/// @return The pool.
+[[nodiscard]] SLIST_HEADER& GetPool(const LogLine::Size size) noexcept {
+	std::uint_fast8_t index = 0;
+	while ((kGrowBytes << index) < size) {
+		++index;
+	}
+	return g_pools[index];
+}
+
+/// @brief Get the header of a heap buffer.
+/// @param ptr The buffer.
+/// @return The header.
+[[nodiscard]] HeapBufferHeader& GetHeader(_In_ std::byte* const ptr) noexcept {
+	return *reinterpret_cast<HeapBufferHeader*>(ptr - kHeapBufferHeaderSize);
+}
+
+/// @brief Release the memory of a heap buffer.
+/// @param ptr The buffer.
+void Release(_In_ std::byte* const ptr) noexcept {
+	const HeapBufferHeader& header = GetHeader(ptr);
+	header.deallocate(ptr - kHeapBufferHeaderSize, kHeapBufferHeaderSize + header.size);
+}
+
+/// @brief Release all buffers in the pools.
+void ReleasePools() noexcept {
+	for (SLIST_HEADER& pool : g_pools) {
+		for (PSLIST_ENTRY pEntry = InterlockedFlushSList(&pool); pEntry;) {
+			const PSLIST_ENTRY pNext = pEntry->Next;
+			Release(reinterpret_cast<std::byte*>(pEntry));
+			pEntry = pNext;
+		}
+	}
+}
+
+}  // namespace
+
+_Ret_notnull_ __declspec(restrict) std::byte* AllocateHeapBuffer(_Inout_ LogLine::Size& size) {
+	size = GetHeapBufferSize(size);
+	if (size <= kMaxPooledBytes) {
+		SLIST_HEADER& pool = GetPool(size);
+		// the entry is stored at the start of the usable space
+		while (const PSLIST_ENTRY pEntry = InterlockedPopEntrySList(&pool)) {
+			std::byte* const ptr = reinterpret_cast<std::byte*>(pEntry);
+			// a buffer of the previous allocator might have been added while SetHeapBufferAllocator was running
+			if (GetHeader(ptr).deallocate == g_deallocate.load(std::memory_order_relaxed)) {
+				return ptr;
+			}
+			Release(ptr);
+		}
+	}
+
+	AcquireSRWLockShared(&g_allocatorLock);
+	const Allocator allocator = g_allocator;
+	ReleaseSRWLockShared(&g_allocatorLock);
+
+	std::byte* const ptr = static_cast<std::byte*>(allocator.allocate(kHeapBufferHeaderSize + size));
+	assert(reinterpret_cast<std::uintptr_t>(ptr) % __STDCPP_DEFAULT_NEW_ALIGNMENT__ == 0);
+	new (ptr) HeapBufferHeader{allocator.deallocate, size};
+	return ptr + kHeapBufferHeaderSize;
+}
+
+void FreeHeapBuffer(_In_opt_ std::byte* const ptr) noexcept {
+	if (!ptr) {
+		return;
+	}
+	const HeapBufferHeader& header = GetHeader(ptr);
+	if (header.size <= kMaxPooledBytes && header.deallocate == g_deallocate.load(std::memory_order_relaxed)) {
+		SLIST_HEADER& pool = GetPool(header.size);
+		// the check is not exact when multiple threads release buffers at the same time, but this does not matter
+		if (QueryDepthSList(&pool) < kMaxPoolDepth) {
+			InterlockedPushEntrySList(&pool, reinterpret_cast<PSLIST_ENTRY>(ptr));
+			return;
+		}
+	}
+	Release(ptr);
+}
+
 }  // namespace buffer
+
+void internal::HeapBufferDeleter::operator()(_In_opt_ std::byte* const ptr) const noexcept {
+	buffer::FreeHeapBuffer(ptr);
+}
+
+void SetHeapBufferAllocator(_In_opt_ void* (*const allocate)(std::size_t), _In_opt_ void (*const deallocate)(void*, std::size_t) noexcept) noexcept {
+	AcquireSRWLockExclusive(&buffer::g_allocatorLock);
+	buffer::g_allocator = {allocate ? allocate : &buffer::DefaultAllocate, deallocate ? deallocate : &buffer::DefaultDeallocate};
+	buffer::g_deallocate.store(buffer::g_allocator.deallocate, std::memory_order_relaxed);
+	ReleaseSRWLockExclusive(&buffer::g_allocatorLock);
+
+	// buffers which are released by other threads in the meantime are dropped when they are taken from the pool
+	buffer::ReleasePools();
+}
+
 }  // namespace llamalog
@@ -57,6 +57,9 @@ using Types = std::tuple<
 	const void*,     // MUST NOT cast this back to any object because the object might no longer exist when the message is logged
 	const char*,     // string is stored WITHOUT a terminating null character
 	const wchar_t*,  // string is stored WITHOUT a terminating null character
+	literal,         // only the address of the string is stored
+	marker::InlineRange,
+	hexdump,  // bytes are stored inline
 	exception::StackBasedException,
 	exception::StackBasedSystemError,
 	exception::HeapBasedException,
@@ -143,6 +146,9 @@ constexpr std::uint8_t kTypeSizes[] = {
 	sizeof(TypeId) + sizeof(void*),
 	sizeof(TypeId) + sizeof(LogLine::Length) /* + std::byte[padding] + char[std::strlen(str)] */,
 	sizeof(TypeId) + sizeof(LogLine::Length) /* + std::byte[padding] + wchar_t[std::wcslen(str)] */,
+	sizeof(TypeId) /* + std::byte[padding] */ + sizeof(literal),
+	sizeof(TypeId) + sizeof(TypeId) + sizeof(LogLine::Length) /* + std::byte[padding] + T[length] */,
+	sizeof(TypeId) + sizeof(LogLine::Length) /* + std::byte[length] */,
 	sizeof(TypeId) /* + std::byte[padding] */ + offsetof(exception::ExceptionInformation /* exception::StackBasedException */, padding) /* + char[exception::ExceptionInformation::length] + std::byte[padding] + std::byte[exception::ExceptionInformation::m_used] */,
 	sizeof(TypeId) /* + std::byte[padding] */ + offsetof(exception::ExceptionInformation /* exception::StackBasedException */, padding) /* + char[exception::ExceptionInformation::length] + std::byte[padding] + std::byte[exception::ExceptionInformation::m_used] */ + sizeof(exception::StackBasedSystemError),
 	sizeof(TypeId) /* + std::byte[padding] */ + sizeof(exception::HeapBasedException) /* + char[exception::ExceptionInformation::length] */,
@@ -163,10 +169,22 @@ static_assert(std::tuple_size_v<Types> == sizeof(kTypeSizes) / sizeof(kTypeSizes
 template <typename T>
 inline constexpr std::uint8_t kTypeSize = kTypeSizes[kTypeId<T>];
 
+/// @brief Get the size of the elements of an `InlineRange`.
+/// @details Only arithmetic types are supported as elements, i.e. the size is also the alignment requirement.
+/// @param elementTypeId The `#TypeId` of the elements.
+/// @return The size of a single element in bytes.
+constexpr __declspec(noalias) LogLine::Align GetRangeElementSize(const TypeId elementTypeId) noexcept {
+	return static_cast<LogLine::Align>(kTypeSizes[elementTypeId] - sizeof(TypeId));
+}
+
 
 /// @brief The number of bytes to add to the argument buffer after it became too small.
+/// @details This is also the minimum size of a heap buffer.
 constexpr LogLine::Size kGrowBytes = 512u;
 
+/// @brief The maximum size of heap buffers which are kept in a pool for re-use.
+constexpr LogLine::Size kMaxPooledBytes = 65536u;
+
 /// @brief Get the next allocation chunk, i.e. the next block which is a multiple of `#kGrowBytes`.
 /// @param value The required size.
 /// @return The value rounded up to multiples of `#kGrowBytes`.
@@ -177,6 +195,30 @@ constexpr __declspec(noalias) LogLine::Size GetNextChunk(const LogLine::Size val
 	return value + ((kGrowBytes - (value & kMask)) & kMask);
 }
 
+/// @brief Get the size of a heap buffer, i.e. the next power of 2 for values up to `#kMaxPooledBytes` and the next
+/// multiple of `#kGrowBytes` for larger values.
+/// @param value The required size.
+/// @return The size of the heap buffer.
+constexpr __declspec(noalias) LogLine::Size GetHeapBufferSize(const LogLine::Size value) noexcept {
+	if (value > kMaxPooledBytes) {
+		return GetNextChunk(value);
+	}
+	LogLine::Size size = kGrowBytes;
+	while (size < value) {
+		size <<= 1u;
+	}
+	return size;
+}
+
+/// @brief Get a heap buffer from the pool or allocate a new one.
+/// @param size The required size in bytes. Receives the usable size of the buffer.
+/// @return The buffer.
+[[nodiscard]] _Ret_notnull_ __declspec(restrict) std::byte* AllocateHeapBuffer(_Inout_ LogLine::Size& size);
+
+/// @brief Return a buffer allocated by `#AllocateHeapBuffer` to the pool or release it.
+/// @param ptr The buffer.
+void FreeHeapBuffer(_In_opt_ std::byte* ptr) noexcept;
+
 /// @brief Get the required padding for a type starting at the next possible offset.
 /// @tparam T The type.
 /// @param ptr The target address.
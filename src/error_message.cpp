@@ -0,0 +1,146 @@
+/*
+Copyright 2020 Michael Beckh
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/// @file
+
+#include "error_message.h"
+
+#include "utf8.h"
+
+#include "llamalog/Logger.h"
+#include "llamalog/finally.h"
+#include "llamalog/winapi_log.h"
+
+#include <windows.h>
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <utility>
+
+namespace llamalog::internal {
+
+namespace {
+
+/// @brief The maximum number of messages in the cache.
+constexpr std::size_t kMaxCachedMessages = 256;
+
+/// @brief The key of the cache. @details Windows system error codes use `nullptr` as category.
+using Key = std::pair<const std::error_category*, int>;
+
+/// @brief Lock protecting the cache.
+SRWLOCK g_lock = SRWLOCK_INIT;
+
+/// @brief The cached messages. Entries are never removed which keeps all views returned to callers valid.
+_Guarded_by_(g_lock) std::map<Key, std::string> g_messages;
+
+/// @brief The last message of the current thread which was not added to the cache.
+thread_local std::string g_uncachedMessage;
+
+/// @brief Get a message from the cache.
+/// @param key The key.
+/// @return The message or `nullptr` if the key is not in the cache.
+[[nodiscard]] _Ret_maybenull_ const std::string* Find(const Key& key) noexcept {
+	AcquireSRWLockShared(&g_lock);
+	const auto it = g_messages.find(key);
+	const std::string* const result = it == g_messages.cend() ? nullptr : &it->second;
+	ReleaseSRWLockShared(&g_lock);
+	return result;
+}
+
+/// @brief Add a message to the cache or keep it for the current thread if the cache is full.
+/// @param key The key.
+/// @param message The message.
+/// @return The message.
+[[nodiscard]] std::string_view Add(const Key& key, std::string&& message) {
+	{
+		AcquireSRWLockExclusive(&g_lock);
+		auto finally = llamalog::finally([]() noexcept {
+			ReleaseSRWLockExclusive(&g_lock);
+		});
+		// another thread might have added the same message in the meantime
+		if (const auto it = g_messages.find(key); it != g_messages.cend()) {
+			return it->second;
+		}
+		if (g_messages.size() < kMaxCachedMessages) {
+			return g_messages.emplace(key, std::move(message)).first->second;
+		}
+	}
+	g_uncachedMessage = std::move(message);
+	return g_uncachedMessage;
+}
+
+/// @brief Create an error message from a Windows system error code.
+/// @param code The error code.
+/// @param message Receives the UTF-8 message without trailing line breaks.
+/// @return `true` if the message has been created.
+[[nodiscard]] bool CreateSystemErrorMessage(const std::uint32_t code, std::string& message) {
+	wchar_t* pBuffer = nullptr;
+	auto finally = llamalog::finally([&pBuffer]() noexcept {
+		LocalFree(pBuffer);
+	});
+	DWORD length = FormatMessageW(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS | FORMAT_MESSAGE_MAX_WIDTH_MASK, nullptr, code, 0, reinterpret_cast<wchar_t*>(&pBuffer), 0, nullptr);
+	if (!length) {
+		const DWORD lastError = GetLastError();
+		LLAMALOG_INTERNAL_ERROR("FormatMessageW for code {}: {}", code, error_code{lastError});
+		return false;
+	}
+
+	if (length >= 2) {
+		if (pBuffer[length - 2] == L'\r' || pBuffer[length - 2] == L'\n') {
+			length -= 2;
+		} else if (pBuffer[length - 1] == L' ' || pBuffer[length - 1] == L'\n' || pBuffer[length - 1] == L'\r') {
+			length -= 1;
+		} else {
+			// leave message as it is
+		}
+	}
+
+	message.resize(length * kMaxUtf8BytesPerWideChar);
+	message.resize(ConvertToUtf8(pBuffer, length, message.data()));
+	return true;
+}
+
+}  // namespace
+
+std::string_view GetSystemErrorMessage(const std::uint32_t code) {
+	const Key key(nullptr, static_cast<int>(code));
+	if (const std::string* const pMessage = Find(key); pMessage) {
+		return *pMessage;
+	}
+
+	std::string message;
+	if (!CreateSystemErrorMessage(code, message)) {
+		// do not cache errors
+		return "<ERROR>";
+	}
+	return Add(key, std::move(message));
+}
+
+std::string_view GetErrorMessage(const std::error_category& category, const int code) {
+	if (category != std::system_category() && category != std::generic_category()) {
+		g_uncachedMessage = category.message(code);
+		return g_uncachedMessage;
+	}
+
+	const Key key(&category, code);
+	if (const std::string* const pMessage = Find(key); pMessage) {
+		return *pMessage;
+	}
+	return Add(key, category.message(code));
+}
+
+}  // namespace llamalog::internal
@@ -0,0 +1,44 @@
+/*
+Copyright 2020 Michael Beckh
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/// @file
+/// @brief Cached lookup of the messages for error codes.
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <system_error>
+
+namespace llamalog::internal {
+
+/// @brief Get the UTF-8 message for a Windows system error code or `HRESULT`.
+/// @details Messages are kept in a bounded cache which is shared by all threads. Trailing line breaks are removed.
+/// @param code The error code.
+/// @return The message. The view is valid until the next call of `#GetSystemErrorMessage` or `#GetErrorMessage` on the
+/// same thread.
+[[nodiscard]] std::string_view GetSystemErrorMessage(std::uint32_t code);
+
+/// @brief Get the message for an error code of a `std::error_category`.
+/// @details Messages of `std::system_category()` and `std::generic_category()` are kept in the same cache as the
+/// messages for Windows system error codes. All other categories are queried every time because their messages
+/// MAY change at runtime.
+/// @param category The category of the error code.
+/// @param code The error code.
+/// @return The message. The view is valid until the next call of `#GetSystemErrorMessage` or `#GetErrorMessage` on the
+/// same thread.
+[[nodiscard]] std::string_view GetErrorMessage(const std::error_category& category, int code);
+
+}  // namespace llamalog::internal
@@ -18,53 +18,177 @@ limitations under the License.
 
 #include "llamalog/exception.h"
 
+#include "buffer_management.h"
+#include "error_message.h"
+
 #include "llamalog/LogLine.h"
 #include "llamalog/Logger.h"
+#include "llamalog/finally.h"
 
 #include <fmt/format.h>
 
+#include <atomic>
 #include <cstring>
 #include <exception>
 #include <memory>
 #include <new>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace llamalog {
 
-BaseException::BaseException(_In_z_ const char* __restrict const file, const std::uint32_t line, _In_z_ const char* __restrict const function, _In_opt_z_ const char* __restrict const message) noexcept
-	: m_logLine(Priority::kNone /* not used */, file, line, function, message) {
-	m_logLine.GenerateTimestamp();
+namespace {
+
+/// @brief Default size for the buffer used for formatting exception messages.
+constexpr std::size_t kDefaultBufferSize = 256;
+
+/// @brief Buffers for formatting exception messages which are re-used for all exceptions of a thread.
+struct WhatBuffers final {
+	std::vector<fmt::format_context::format_arg> args;           ///< @brief The arguments of the log message.
+	fmt::basic_memory_buffer<char, kDefaultBufferSize> message;  ///< @brief The formatted message.
+	bool used = false;                                            ///< @brief `true` while the buffers are in use. @hideinitializer
+};
+
+/// @brief The buffers of the current thread.
+thread_local WhatBuffers g_whatBuffers;
+
+/// @brief Format the message of an exception.
+/// @tparam N The inline size of the buffer for the formatted message.
+/// @param logLine The `LogLine` carrying the message pattern and arguments.
+/// @param pCode An optional error code used to add an error message to the result.
+/// @param args A buffer for the arguments.
+/// @param buf A buffer for the formatted message.
+/// @return The null-terminated message which has been allocated using `new[]`.
+template <std::size_t N>
+[[nodiscard]] _Ret_z_ char* FormatWhat(const LogLine& logLine, _In_opt_ const std::error_code* const pCode, std::vector<fmt::format_context::format_arg>& args, fmt::basic_memory_buffer<char, N>& buf) {
+	logLine.CopyArgumentsTo(args);
+	fmt::vformat_to(buf, fmt::to_string_view(logLine.GetPattern()),
+					fmt::basic_format_args<fmt::format_context>(args.data(), static_cast<fmt::format_args::size_type>(args.size())));
+
+	if (pCode) {
+		if (buf.size()) {
+			buf.push_back(':');
+			buf.push_back(' ');
+		}
+		const std::string_view message = internal::GetErrorMessage(pCode->category(), pCode->value());
+		buf.append(message.data(), message.data() + message.size());
+	}
+
+	const std::size_t len = buf.size();
+	char* const ptr = new char[len + 1];
+	std::memcpy(ptr, buf.data(), len * sizeof(char));
+	ptr[len] = '\0';
+	return ptr;
+}
+
+}  // namespace
+
+/// @brief The logging context of a `BaseException` which is shared by all copies.
+struct BaseException::Context final {
+	/// @brief Creates a new instance.
+	/// @param file The source code file where the exception happened.
+	/// @param line The source code line where the exception happened.
+	/// @param function The function where the exception happened.
+	/// @param message An additional logging message which MAY use {fmt} pattern syntax.
+	Context(_In_z_ const char* __restrict const file, const std::uint32_t line, _In_z_ const char* __restrict const function, _In_opt_z_ const char* __restrict const message) noexcept
+		: logLine(Priority::kNone /* not used */, file, line, function, message) {
+		logLine.GenerateTimestamp();
+	}
+	Context(const Context&) = delete;  ///< @nocopyconstructor
+	Context(Context&&) = delete;       ///< @nomoveconstructor
+	~Context() noexcept {
+		delete[] what.load(std::memory_order_relaxed);
+	}
+
+public:
+	Context& operator=(const Context&) = delete;  ///< @noassignmentoperator
+	Context& operator=(Context&&) = delete;       ///< @nomoveoperator
+
+public:
+	LogLine logLine;                      ///< @brief Additional information for logging.
+	std::atomic<char*> what = nullptr;    ///< @brief The formatted error message which is created on first use. @hideinitializer
+	std::atomic_uint32_t references = 1;  ///< @brief The number of `BaseException` objects using this context. @hideinitializer
+};
+
+BaseException::BaseException(_In_z_ const char* __restrict const file, const std::uint32_t line, _In_z_ const char* __restrict const function, _In_opt_z_ const char* __restrict const message) {
+	// use the pooled heap buffers to keep the cost of throwing low
+	LogLine::Size size = sizeof(Context);
+	m_pContext = new (buffer::AllocateHeapBuffer(size)) Context(file, line, function, message);
+}
+
+BaseException::BaseException(const BaseException& baseException) noexcept
+	: m_pContext(baseException.m_pContext) {
+	m_pContext->references.fetch_add(1, std::memory_order_relaxed);
+}
+
+BaseException::BaseException(BaseException&& baseException) noexcept
+	: BaseException(baseException) {
+	// empty
+}
+
+BaseException::~BaseException() noexcept {
+	Release();
+}
+
+BaseException& BaseException::operator=(const BaseException& baseException) noexcept {
+	if (m_pContext != baseException.m_pContext) {
+		baseException.m_pContext->references.fetch_add(1, std::memory_order_relaxed);
+		Release();
+		m_pContext = baseException.m_pContext;
+	}
+	return *this;
+}
+
+BaseException& BaseException::operator=(BaseException&& baseException) noexcept {
+	// the source keeps the context because it MAY be used again, e.g. by what()
+	return *this = baseException;
+}
+
+LogLine& BaseException::GetLogLine() noexcept {
+	return m_pContext->logLine;
+}
+
+const LogLine& BaseException::GetLogLine() const noexcept {
+	return m_pContext->logLine;
+}
+
+void BaseException::Release() noexcept {
+	if (m_pContext->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		m_pContext->~Context();
+		buffer::FreeHeapBuffer(reinterpret_cast<std::byte*>(m_pContext));
+	}
 }
 
 _Ret_z_ const char* BaseException::What(_In_opt_ const std::error_code* const pCode) const noexcept {
-	if (m_what) {
-		return m_what.get();
+	if (const char* const what = m_pContext->what.load(std::memory_order_acquire); what) {
+		return what;
 	}
 	try {
-		std::vector<fmt::format_context::format_arg> args;
-		m_logLine.CopyArgumentsTo(args);
-
-		constexpr std::size_t kDefaultBufferSize = 256;
-		fmt::basic_memory_buffer<char, kDefaultBufferSize> buf;
-		fmt::vformat_to(buf, fmt::to_string_view(m_logLine.GetPattern()),
-						fmt::basic_format_args<fmt::format_context>(args.data(), static_cast<fmt::format_args::size_type>(args.size())));
-
-		if (pCode) {
-			if (buf.size()) {
-				buf.push_back(':');
-				buf.push_back(' ');
-			}
-			const std::string message = pCode->message();
-			buf.append(message.data(), message.data() + message.size());
+		char* ptr;  // NOLINT(cppcoreguidelines-init-variables): Guaranteed to be initialized before first read.
+		if (g_whatBuffers.used) {
+			// formatting an argument has called what() on another exception
+			std::vector<fmt::format_context::format_arg> args;
+			fmt::basic_memory_buffer<char, kDefaultBufferSize> buf;
+			ptr = FormatWhat(m_pContext->logLine, pCode, args, buf);
+		} else {
+			g_whatBuffers.used = true;
+			auto finally = llamalog::finally([]() noexcept {
+				g_whatBuffers.args.clear();
+				g_whatBuffers.message.clear();
+				g_whatBuffers.used = false;
+			});
+			ptr = FormatWhat(m_pContext->logLine, pCode, g_whatBuffers.args, g_whatBuffers.message);
 		}
 
-		const std::size_t len = buf.size();
-		m_what = std::shared_ptr<char[]>(new char[len + 1]);
-		char* const ptr = m_what.get();
-		std::memcpy(ptr, buf.data(), len * sizeof(char));
-		ptr[len] = '\0';
-		return ptr;
+		// the result is stored in the shared context because the returned pointer MUST stay valid as long as the exception
+		char* expected = nullptr;
+		if (m_pContext->what.compare_exchange_strong(expected, ptr, std::memory_order_acq_rel, std::memory_order_acquire)) {
+			return ptr;
+		}
+		// another copy on a different thread has been faster
+		delete[] ptr;
+		return expected;
 	} catch (std::exception& e) {
 		LLAMALOG_INTERNAL_ERROR("Error creating exception message: {}", e);
 	} catch (...) {
@@ -87,7 +211,7 @@ _Ret_z_ const char* system_error::what() const noexcept {
 	try {
 		const std::size_t messageLen = m_message ? std::strlen(m_message) : 0;
 
-		const std::string errorMessage = m_code.message();
+		const std::string_view errorMessage = internal::GetErrorMessage(m_code.category(), m_code.value());
 		const std::size_t errorMessageLen = errorMessage.length();
 
 		const std::size_t offset = messageLen + (messageLen ? 2 : 0);
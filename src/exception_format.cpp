@@ -19,27 +19,60 @@ limitations under the License.
 #include "exception_format.h"
 
 #include "buffer_management.h"
+#include "error_message.h"
 #include "exception_types.h"
 
 #include "llamalog/LogLine.h"
 #include "llamalog/LogWriter.h"
+#include "llamalog/finally.h"
 
 #include <fmt/format.h>
 
 #include <windows.h>
 
 #include <algorithm>
+#include <cassert>
 #include <charconv>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <iterator>
+#include <limits>
+#include <map>
+#include <string>
 #include <string_view>
 #include <system_error>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace llamalog::exception {
 
+/// @brief A single step when formatting an exception pattern.
+struct Operation {
+	/// @brief The type of the operation.
+	enum class Type : std::uint8_t {
+		kLiteral,    ///< @brief Copy `length` characters from `position` of the pattern text.
+		kSpecifier,  ///< @brief Replace `specifier` by a value, e.g. `w` for `%w`.
+		kGroup,      ///< @brief Format the next `length` operations and print them only if any value was printed.
+		kArgument    ///< @brief Format an argument using the format specification of `length` characters at `position`.
+	};
+
+	Type type;                       ///< @brief The type of the operation.
+	char specifier = '\0';           ///< @brief The specifier character for `Type::kSpecifier`. @hideinitializer
+	std::uint32_t position = 0;      ///< @brief The start of the literal or format specification in the pattern text. @hideinitializer
+	std::uint32_t length = 0;        ///< @brief The length of the literal or format specification, or the size of a group. @hideinitializer
+	int argId = -1;                  ///< @brief The argument index for `Type::kArgument` or -1 for a named argument. @hideinitializer
+	std::uint32_t namePosition = 0;  ///< @brief The start of the argument name in the pattern text. @hideinitializer
+	std::uint32_t nameLength = 0;    ///< @brief The length of the argument name. @hideinitializer
+};
+
+/// @brief An exception pattern which has been parsed into a list of operations.
+struct CompiledPattern {
+	std::string text;                   ///< @brief Literal characters, argument names and argument format specifications.
+	std::vector<Operation> operations;  ///< @brief The operations in the order of the pattern.
+};
+
 namespace {
 
 /// @brief Default size for message buffers for exceptions.
@@ -128,59 +161,6 @@ template <typename T, typename std::enable_if_t<std::is_same_v<T, PlainSystemErr
 	return ptr;
 }
 
-template <typename T>
-bool Format(const T& arg, std::string::const_iterator start, const std::string::const_iterator& end, fmt::format_context& ctx, fmt::format_context::iterator& out, std::vector<fmt::format_context::format_arg>& args);
-
-
-/// @brief Parse and format an exception using a subformat, i.e. `{:%[...]}`.
-/// @details Output is only written to @p out if at least one pattern was replaced by a value other than the empty string.
-/// @note The output target @p out MAY differ from the output target of @p ctx.
-/// @param arg The exception to format.
-/// @param start The start of the subformat pattern.
-/// @param end The end (exclusive) of the subformat pattern.
-/// @param ctx The current `fmt::format_context`.
-/// @param out The output target.
-/// @param args The current formatting arguments.
-/// @param formatted Set to `true` if any output was produced.
-/// @return The iterator pointing at the last character of the sub pattern, i.e. the `]`. If not `]` exists, the result is @p end.
-template <typename T>
-[[nodiscard]] std::string::const_iterator ProcessSubformat(const T& arg, const std::string::const_iterator& start, const std::string::const_iterator& end, fmt::format_context& ctx, fmt::format_context::iterator& out, std::vector<fmt::format_context::format_arg>& args, bool& formatted) {
-	std::uint_fast16_t open = 1;
-	for (auto it = start; it != end; ++it) {
-		if (*it == '\\') {
-			if (++it == end) {
-				ctx.on_error("invalid escape sequence");
-				break;
-			}
-		} else if (*it == '%') {
-			if (++it == end) {
-				ctx.on_error("invalid exception specifier");
-				break;
-			}
-			if (*it == '[') {
-				++open;
-			}
-		} else if (*it == ']') {
-			if (--open == 0) {
-				fmt::basic_memory_buffer<char, kDefaultBufferSize> buf;
-				fmt::format_context::iterator subOut(buf);
-				if (Format<T>(arg, start, it, ctx, subOut, args)) {
-					std::copy(buf.begin(), buf.end(), out);
-					formatted = true;
-				}
-				return it;
-			}
-			if (open < 0) {
-				ctx.on_error("missing '[' in exception specifier");
-			}
-		} else {
-			// do nothing
-		}
-	}
-	ctx.on_error("missing ']' in exception specifier");
-	return end;
-}
-
 /// @brief Format the exception timestamp.
 /// @tparam T The type of the exception to format.
 /// @param ptr The address of the exception argument in the buffer.
@@ -188,8 +168,7 @@ template <typename T>
 /// @return Always `true`.
 template <typename T, typename std::enable_if_t<is_any_v<T, StackBasedException, StackBasedSystemError, HeapBasedException, HeapBasedSystemError>, int> = 0>
 [[nodiscard]] static bool FormatTimestamp(const std::byte* __restrict const ptr, fmt::format_context::iterator& out) {
-	std::string str = LogWriter::FormatTimestamp(reinterpret_cast<const ExceptionInformation*>(ptr)->timestamp);
-	std::copy(str.cbegin(), str.cend(), out);
+	LogWriter::FormatTimestampTo(out, reinterpret_cast<const ExceptionInformation*>(ptr)->timestamp);
 	return true;
 }
 
@@ -208,7 +187,8 @@ template <typename T, typename std::enable_if_t<is_any_v<T, PlainException, Plai
 /// @return Always `true`.
 template <typename T, typename std::enable_if_t<is_any_v<T, StackBasedException, StackBasedSystemError, HeapBasedException, HeapBasedSystemError>, int> = 0>
 [[nodiscard]] static bool FormatThread(const std::byte* __restrict const ptr, fmt::format_context::iterator& out) {
-	fmt::format_to(out, "{}", reinterpret_cast<const ExceptionInformation*>(ptr)->threadId);
+	const fmt::format_int value(reinterpret_cast<const ExceptionInformation*>(ptr)->threadId);
+	std::copy(value.data(), value.data() + value.size(), out);
 	return true;
 }
 
@@ -247,7 +227,8 @@ template <typename T, typename std::enable_if_t<is_any_v<T, PlainException, Plai
 /// @return Always `true`.
 template <typename T, typename std::enable_if_t<is_any_v<T, StackBasedException, StackBasedSystemError, HeapBasedException, HeapBasedSystemError>, int> = 0>
 [[nodiscard]] static bool FormatLine(const std::byte* __restrict const ptr, fmt::format_context::iterator& out) {
-	fmt::format_to(out, "{}", reinterpret_cast<const ExceptionInformation*>(ptr)->line);
+	const fmt::format_int value(reinterpret_cast<const ExceptionInformation*>(ptr)->line);
+	std::copy(value.data(), value.data() + value.size(), out);
 	return true;
 }
 
@@ -328,8 +309,8 @@ template <typename T, typename std::enable_if_t<is_any_v<T, StackBasedSystemErro
 	const int code = llamalog::buffer::GetValue<int>(&systemError[offsetof(T, code)]);
 	const std::error_category* const pCategory = llamalog::buffer::GetValue<const std::error_category*>(&systemError[offsetof(T, pCategory)]);
 
-	const std::string s = pCategory->message(code);
-	std::copy(s.cbegin(), s.cend(), out);
+	const std::string_view message = internal::GetErrorMessage(*pCategory, code);
+	std::copy(message.cbegin(), message.cend(), out);
 	return true;
 }
 
@@ -343,8 +324,8 @@ template <typename T, typename std::enable_if_t<is_any_v<T, PlainSystemError>, i
 	const int code = llamalog::buffer::GetValue<int>(&ptr[offsetof(T, code)]);
 	const std::error_category* const pCategory = llamalog::buffer::GetValue<const std::error_category*>(&ptr[offsetof(T, pCategory)]);
 
-	const std::string s = pCategory->message(code);
-	std::copy(s.cbegin(), s.cend(), out);
+	const std::string_view message = internal::GetErrorMessage(*pCategory, code);
+	std::copy(message.cbegin(), message.cend(), out);
 	return true;
 }
 
@@ -466,150 +447,261 @@ template <typename T, typename std::enable_if_t<is_any_v<T, PlainSystemError>, i
 }
 
 
-/// @brief Parse and format an exception using a pattern , i.e. `{:%[...]}`.
+/// @brief A visitor for `fmt::visit_format_arg` which formats a sub argument directly using its `fmt::formatter`.
+class ArgumentFormatter {
+public:
+	/// @brief Create a new visitor.
+	/// @param parseContext The parse context for the format specification of the argument.
+	/// @param ctx The format context receiving the output.
+	ArgumentFormatter(fmt::format_parse_context& parseContext, fmt::format_context& ctx) noexcept
+		: m_parseContext(parseContext)
+		, m_ctx(ctx) {
+		// empty
+	}
+
+	/// @brief Format a value of a built-in type.
+	/// @tparam T The type of the value.
+	/// @param value The value.
+	template <typename T>
+	void operator()(const T& value) {
+		fmt::formatter<T> formatter;
+		m_parseContext.advance_to(formatter.parse(m_parseContext));
+		m_ctx.advance_to(formatter.format(value, m_ctx));
+	}
+
+	/// @brief Format a value of a custom type.
+	/// @param handle The handle for the value.
+	void operator()(const fmt::format_context::format_arg::handle& handle) {
+		handle.format(m_parseContext, m_ctx);
+	}
+
+	/// @brief Report a missing argument.
+	void operator()(const fmt::monostate& /* value */) {
+		m_parseContext.on_error("argument not found");
+	}
+
+private:
+	fmt::format_parse_context& m_parseContext;  ///< @brief The parse context for the format specification.
+	fmt::format_context& m_ctx;                 ///< @brief The format context receiving the output.
+};
+
+/// @brief Format an exception using a compiled pattern.
 /// @note The output target @p out MAY differ from the output target of @p ctx.
 /// @param arg The exception to format.
-/// @param start The start of the format pattern.
-/// @param end The end (exclusive) of the format pattern.
+/// @param pattern The compiled pattern.
+/// @param begin The index of the first operation.
+/// @param end The index after the last operation.
 /// @param ctx The current `fmt::format_context`.
 /// @param out The output target.
 /// @param args The current formatting arguments.
-/// @return `true` if any output was produced.
+/// @return `true` if any specifier was replaced by a value.
 template <typename T>
-bool Format(const T& arg, std::string::const_iterator start, const std::string::const_iterator& end, fmt::format_context& ctx, fmt::format_context::iterator& out, std::vector<fmt::format_context::format_arg>& args) {
+bool Format(const T& arg, const CompiledPattern& pattern, const std::size_t begin, const std::size_t end, fmt::format_context& ctx, fmt::format_context::iterator& out, std::vector<fmt::format_context::format_arg>& args) {
+	const std::byte* const ptr = reinterpret_cast<const std::byte*>(&arg);
 	bool formatted = false;
-	for (auto it = start; it != end; ++it) {
-		if (*it == '\\') {
-			// copy content up to here
-			std::copy(start, it, out);
-
-			start = ++it;
-			// leave next character unprocessed
-			if (it == end) {
-				ctx.on_error("invalid escape sequence");
-				break;
-			}
-		} else if (*it == '{') {
-			// copy content up to here
-			std::copy(start, it, out);
-			if (++it == end) {
-				ctx.on_error("missing '}' in exception specifier");
-				start = end;
-				break;
-			}
-
-			auto endOfArgId = it;
-			while (endOfArgId != end && *endOfArgId != '}' && *endOfArgId != ':') {
-				++endOfArgId;
-			}
-			auto startOfPattern = endOfArgId;
-			auto endOfPattern = endOfArgId;
-			if (endOfArgId != end && *endOfArgId == ':') {
-				startOfPattern = endOfArgId + 1;
-				endOfPattern = startOfPattern;
-				while (endOfPattern != end && *endOfPattern != '}') {
-					++endOfPattern;
-				}
-			}
-			if (endOfPattern == end) {
-				ctx.on_error("missing '}' in exception specifier");
-			}
-
-			fmt::format_context::format_arg subArg;
-			if (it == endOfArgId) {
-				ctx.on_error("exception specifier must have argument identifier");
-			} else if (std::all_of(it, endOfArgId, [](const char c) noexcept {
-						   return c >= '0' && c <= '9';
-					   })) {
-				int argId = -1;
-				if (std::from_chars(&*it, &*endOfArgId, argId).ptr != &*endOfArgId) {
-					ctx.on_error("invalid argument id in exception specifier");
-				}
-				subArg = ctx.arg(argId);
-			} else {
-				subArg = ctx.arg(std::string_view(&*it, std::distance(it, endOfArgId)));
-			}
-			const fmt::format_args subArgs(&subArg, 1);
-			fmt::vformat_to(out, fmt::to_string_view("{:" + std::string(startOfPattern, endOfPattern) + "}"), subArgs);
-
-			it = endOfPattern;
-			if (it == end) {
-				break;
-			}
-			start = it + 1;
-		} else if (*it == '%') {
-			// copy content up to here
-			std::copy(start, it, out);
-			if (++it == end) {
-				ctx.on_error("invalid exception specifier");
-				start = end;
-				break;
-			}
-			start = it + 1;
-			switch (*it) {
-			// Subformat
-			case '[':
-				it = ProcessSubformat(arg, start, end, ctx, out, args, formatted);
-				if (it != end) {
-					start = it + 1;
-				} else {
-					start = it;
-				}
-				break;
-			// Timestamp
+	for (std::size_t i = begin; i < end; ++i) {
+		const Operation& operation = pattern.operations[i];
+		switch (operation.type) {
+		case Operation::Type::kLiteral:
+			std::copy(pattern.text.data() + operation.position, pattern.text.data() + operation.position + operation.length, out);
+			break;
+		case Operation::Type::kSpecifier:
+			switch (operation.specifier) {
 			case 'T':
-				formatted |= FormatTimestamp<T>(reinterpret_cast<const std::byte*>(&arg), out);
+				formatted |= FormatTimestamp<T>(ptr, out);
 				break;
-			// Thread
 			case 't':
-				formatted |= FormatThread<T>(reinterpret_cast<const std::byte*>(&arg), out);
+				formatted |= FormatThread<T>(ptr, out);
 				break;
-			// File
 			case 'F':
-				formatted |= FormatFile<T>(reinterpret_cast<const std::byte*>(&arg), out);
+				formatted |= FormatFile<T>(ptr, out);
 				break;
-			// Line
 			case 'L':
-				formatted |= FormatLine<T>(reinterpret_cast<const std::byte*>(&arg), out);
+				formatted |= FormatLine<T>(ptr, out);
 				break;
-			// Function
 			case 'f':
-				formatted |= FormatFunction<T>(reinterpret_cast<const std::byte*>(&arg), out);
+				formatted |= FormatFunction<T>(ptr, out);
 				break;
-			// Log Message
 			case 'l':
-				formatted |= FormatLogMessage<T>(reinterpret_cast<const std::byte*>(&arg), out, args);
+				formatted |= FormatLogMessage<T>(ptr, out, args);
 				break;
-			// System Error Message
 			case 'm':
-				formatted |= FormatErrorMessage<T>(reinterpret_cast<const std::byte*>(&arg), out);
+				formatted |= FormatErrorMessage<T>(ptr, out);
 				break;
-			// what()
 			case 'w':
-				formatted |= FormatWhat<T>(reinterpret_cast<const std::byte*>(&arg), out, args);
+				formatted |= FormatWhat<T>(ptr, out, args);
 				break;
-			// Error Code
 			case 'c':
-				formatted |= FormatErrorCode<T>(reinterpret_cast<const std::byte*>(&arg), out);
+				formatted |= FormatErrorCode<T>(ptr, out);
 				break;
-			// Category Name
 			case 'C':
-				formatted |= FormatCategoryName<T>(reinterpret_cast<const std::byte*>(&arg), out);
+				formatted |= FormatCategoryName<T>(ptr, out);
 				break;
-			// Default is to just print the character (but emit an error)
 			default:
-				ctx.on_error("unknown exception specifier");
-				start = it;
+				assert(false);
+			}
+			break;
+		case Operation::Type::kGroup: {
+			// output is only written if at least one specifier in the group was replaced by a value
+			fmt::basic_memory_buffer<char, kDefaultBufferSize> buf;
+			fmt::format_context::iterator subOut(buf);
+			if (Format<T>(arg, pattern, i + 1, i + 1 + operation.length, ctx, subOut, args)) {
+				std::copy(buf.begin(), buf.end(), out);
+				formatted = true;
+			}
+			i += operation.length;
+			break;
+		}
+		case Operation::Type::kArgument: {
+			const fmt::format_context::format_arg subArg = operation.argId >= 0 ? ctx.arg(operation.argId) : ctx.arg(std::string_view(pattern.text.data() + operation.namePosition, operation.nameLength));
+			fmt::format_parse_context parseContext(fmt::string_view(pattern.text.data() + operation.position, operation.length));
+			fmt::format_context subContext(out, ctx.args(), ctx.locale());
+			fmt::visit_format_arg(ArgumentFormatter(parseContext, subContext), subArg);
+			out = subContext.out();
+			break;
+		}
+		}
+	}
+	return formatted;
+}
+
+/// @brief Compile an exception pattern into a list of operations.
+/// @param ctx The parse context for reporting errors.
+/// @param pattern The pattern, i.e. the `...` in `{:...}`.
+/// @param pos The position to start parsing.
+/// @param nested `true` if parsing a subformat `%[...]` which ends at the matching `]`.
+/// @param result The compiled pattern which receives the operations.
+/// @return The position after the last character which was parsed.
+std::size_t Compile(fmt::format_parse_context& ctx, const std::string_view& pattern, std::size_t pos, const bool nested, CompiledPattern& result) {
+	// index of the literal operation which receives further characters
+	std::size_t literal = std::numeric_limits<std::size_t>::max();
+	const auto appendLiteral = [&result, &literal](const char c) {
+		if (literal == std::numeric_limits<std::size_t>::max()) {
+			literal = result.operations.size();
+			result.operations.push_back({Operation::Type::kLiteral, '\0', static_cast<std::uint32_t>(result.text.size())});
+		}
+		result.text.push_back(c);
+		++result.operations[literal].length;
+	};
+
+	while (pos < pattern.length()) {
+		const char c = pattern[pos++];
+		if (c == '\\') {
+			if (pos == pattern.length()) {
+				ctx.on_error("invalid escape sequence");
 				break;
 			}
+			// leave next character unprocessed
+			appendLiteral(pattern[pos++]);
+		} else if (c == '{') {
+			const std::size_t endOfArgId = std::min(pattern.find_first_of("}:", pos), pattern.length());
+			std::size_t endOfPattern = endOfArgId;
+			if (endOfArgId != pattern.length() && pattern[endOfArgId] == ':') {
+				endOfPattern = std::min(pattern.find('}', endOfArgId + 1), pattern.length());
+			}
+			if (endOfPattern == pattern.length()) {
+				ctx.on_error("missing '}' in exception specifier");
+			}
+			if (pos == endOfArgId) {
+				ctx.on_error("exception specifier must have argument identifier");
+			}
+
+			Operation operation{Operation::Type::kArgument};
+			const std::string_view argId = pattern.substr(pos, endOfArgId - pos);
+			if (std::all_of(argId.cbegin(), argId.cend(), [](const char ch) noexcept {
+					return ch >= '0' && ch <= '9';
+				})) {
+				if (std::from_chars(argId.data(), argId.data() + argId.length(), operation.argId).ptr != argId.data() + argId.length()) {
+					ctx.on_error("invalid argument id in exception specifier");
+				}
+			} else {
+				operation.namePosition = static_cast<std::uint32_t>(result.text.size());
+				operation.nameLength = static_cast<std::uint32_t>(argId.length());
+				result.text.append(argId);
+			}
+
+			// the type of the argument is unknown until formatting, so keep the format specification
+			const std::string_view spec = endOfArgId == endOfPattern ? std::string_view() : pattern.substr(endOfArgId + 1, endOfPattern - endOfArgId - 1);
+			operation.position = static_cast<std::uint32_t>(result.text.size());
+			operation.length = static_cast<std::uint32_t>(spec.length());
+			result.text.append(spec);
+			result.operations.push_back(operation);
+
+			literal = std::numeric_limits<std::size_t>::max();
+			pos = endOfPattern + 1;
+		} else if (c == '%') {
+			if (pos == pattern.length()) {
+				ctx.on_error("invalid exception specifier");
+				break;
+			}
+			const char specifier = pattern[pos++];
+			if (specifier == '[') {
+				const std::size_t group = result.operations.size();
+				result.operations.push_back({Operation::Type::kGroup});
+				pos = Compile(ctx, pattern, pos, true, result);
+				result.operations[group].length = static_cast<std::uint32_t>(result.operations.size() - group - 1);
+			} else if (std::string_view("TtFLflmwcC").find(specifier) != std::string_view::npos) {
+				result.operations.push_back({Operation::Type::kSpecifier, specifier});
+			} else {
+				ctx.on_error("unknown exception specifier");
+			}
+			literal = std::numeric_limits<std::size_t>::max();
+		} else if (c == ']' && nested) {
+			return pos;
 		} else {
-			// do nothing
+			appendLiteral(c);
 		}
 	}
-	std::copy(start, end, out);
-	return formatted;
+	if (nested) {
+		ctx.on_error("missing ']' in exception specifier");
+	}
+	return pos;
 }
 
+/// @brief Lock protecting the cache of compiled patterns.
+SRWLOCK g_patternLock = SRWLOCK_INIT;
+
+/// @brief All compiled patterns by their pattern text. Entries are never removed.
+_Guarded_by_(g_patternLock) std::map<std::string, CompiledPattern, std::less<>> g_patterns;
+
+/// @brief The entry of `g_patterns` which was used last by the current thread.
+/// @details Exceptions are usually formatted on the logger thread using the same few patterns, so most calls skip the
+/// global lookup. The pointer stays valid because entries are never removed.
+thread_local const std::pair<const std::string, CompiledPattern>* g_pLastPattern = nullptr;
+
+/// @brief Get the compiled version of a pattern and compile it on first use.
+/// @param ctx The parse context for reporting errors.
+/// @param pattern The pattern, i.e. the `...` in `{:...}`.
+/// @return The compiled pattern which is valid until the end of the program.
+const CompiledPattern& GetCompiledPattern(fmt::format_parse_context& ctx, const std::string_view& pattern) {
+	if (g_pLastPattern && g_pLastPattern->first == pattern) {
+		return g_pLastPattern->second;
+	}
+
+	AcquireSRWLockShared(&g_patternLock);
+	if (const auto it = g_patterns.find(pattern); it != g_patterns.cend()) {
+		g_pLastPattern = &*it;
+		ReleaseSRWLockShared(&g_patternLock);
+		return g_pLastPattern->second;
+	}
+	ReleaseSRWLockShared(&g_patternLock);
+
+	// compile outside of the lock because errors are reported using exceptions
+	CompiledPattern compiledPattern;
+	Compile(ctx, pattern, 0, false, compiledPattern);
+
+	AcquireSRWLockExclusive(&g_patternLock);
+	auto finally = llamalog::finally([]() noexcept {
+		ReleaseSRWLockExclusive(&g_patternLock);
+	});
+	// another thread might have added the same pattern in the meantime
+	g_pLastPattern = &*g_patterns.try_emplace(std::string(pattern), std::move(compiledPattern)).first;
+	return g_pLastPattern->second;
+}
+
+/// @brief Storage for the arguments of log messages of exceptions which is reused for all calls on the current thread.
+thread_local std::vector<fmt::format_context::format_arg> g_args;
+
 }  // namespace
 
 
@@ -641,21 +733,26 @@ fmt::format_parse_context::iterator ExceptionBaseFormatter::parse(fmt::format_pa
 	}
 	if (start == end) {
 		// apply default format
-		m_format.assign(R"(%w%[ (%C %c)]%[ @\{%T \[%t\] %F:%L %f\}])");
+		m_pPattern = &GetCompiledPattern(ctx, R"(%w%[ (%C %c)]%[ @\{%T \[%t\] %F:%L %f\}])");
 	} else {
-		m_format.assign(start, end);
+		m_pPattern = &GetCompiledPattern(ctx, std::string_view(start, end - start));
 	}
 	return end;
 }
 
 template <typename T>
 fmt::format_context::iterator ExceptionFormatter<T>::format(const T& arg, fmt::format_context& ctx) const {  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
-	std::vector<fmt::format_context::format_arg> args;
+	// reuse the memory of the arguments, a nested call gets an empty vector
+	std::vector<fmt::format_context::format_arg> args = std::move(g_args);
+	args.clear();
+	auto finally = llamalog::finally([&args]() noexcept {
+		g_args = std::move(args);
+	});
 
 	fmt::basic_memory_buffer<char, kDefaultBufferSize> buf;
 	fmt::format_context::iterator out(buf);
-	const std::string& format = GetFormat();
-	Format(arg, format.cbegin(), format.cend(), ctx, out, args);
+	const CompiledPattern& pattern = GetPattern();
+	Format(arg, pattern, 0, pattern.operations.size(), ctx, out, args);
 	return std::copy(buf.begin(), buf.end(), ctx.out());
 }
 
@@ -19,10 +19,10 @@ limitations under the License.
 
 #include <fmt/format.h>
 
-#include <string>
-
 namespace llamalog::exception {
 
+struct CompiledPattern;
+
 struct StackBasedException;
 struct StackBasedSystemError;
 struct HeapBasedException;
@@ -37,12 +37,14 @@ struct ExceptionBaseFormatter {
 	/// @return see `fmt::formatter::parse`.
 	fmt::format_parse_context::iterator parse(fmt::format_parse_context& ctx);  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
 
-	[[nodiscard]] const std::string& GetFormat() const noexcept {
-		return m_format;
+	/// @brief Get the compiled format pattern.
+	/// @return The compiled pattern which is valid until the end of the program.
+	[[nodiscard]] const CompiledPattern& GetPattern() const noexcept {
+		return *m_pPattern;
 	}
 
 private:
-	std::string m_format;  ///< The original format pattern with the argument number (if any) removed.
+	const CompiledPattern* m_pPattern = nullptr;  ///< The compiled format pattern shared by all formatters using the same pattern. @hideinitializer
 };
 
 /// @brief Base class for a `fmt::formatter` to print exception arguments.
@@ -19,17 +19,21 @@ limitations under the License.
 #include "marker_format.h"
 
 #include "buffer_management.h"
+#include "utf8.h"
 
 #include "llamalog/LogLine.h"
-#include "llamalog/Logger.h"
-#include "llamalog/winapi_log.h"
 
 #include <fmt/core.h>
+#include <fmt/format.h>
 
-#include <windows.h>
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
 
 #include <algorithm>
+#include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <string_view>
@@ -47,10 +51,14 @@ fmt::format_parse_context::iterator InlineCharBaseFormatter::parse(const fmt::fo
 		++end;
 	}
 
-	m_format.reserve(end - start + 3);
-	m_format.assign("{:");
-	m_format.append(start, end);
-	m_format.push_back('}');
+	m_plain = start == end;
+	if (!m_plain) {
+		// parse only the specification up to the optional null value
+		fmt::format_parse_context specs(fmt::string_view(start, end - start));
+		if (m_formatter.parse(specs) != specs.end()) {
+			throw fmt::format_error("invalid format specifier");
+		}
+	}
 
 	// read until closing bracket if ? was matched
 	while (end != last && *end != '}') {
@@ -59,6 +67,155 @@ fmt::format_parse_context::iterator InlineCharBaseFormatter::parse(const fmt::fo
 	return end;
 }
 
+fmt::format_context::iterator InlineCharBaseFormatter::Format(const std::string_view& sv, fmt::format_context& ctx) const {
+	if (m_plain) {
+		return std::copy(sv.cbegin(), sv.cend(), ctx.out());
+	}
+	return m_formatter.format(fmt::string_view(sv.data(), sv.length()), ctx);
+}
+
+fmt::format_context::iterator InlineCharBaseFormatter::Format(_In_reads_(length) const wchar_t* __restrict const wstr, const std::size_t length, fmt::format_context& ctx) const {
+	if (m_plain) {
+		// no width or precision: convert directly into the output
+		return CopyAsUtf8(wstr, length, ctx.out());
+	}
+
+	const std::size_t maxSize = length * kMaxUtf8BytesPerWideChar;
+	if (constexpr std::size_t kFixedBufferSize = 768; maxSize <= kFixedBufferSize) {
+		char sz[kFixedBufferSize];
+		const std::size_t size = ConvertToUtf8(wstr, length, sz);
+		return Format(std::string_view(sz, size), ctx);
+	}
+	const std::unique_ptr<char[]> str = std::make_unique<char[]>(maxSize);
+	const std::size_t size = ConvertToUtf8(wstr, length, str.get());
+	return Format(std::string_view(str.get(), size), ctx);
+}
+
+namespace {
+
+/// @brief Encode bytes as hex digits.
+/// @details 16 bytes are encoded at once if SSE2 is available.
+/// @param src The bytes.
+/// @param length The number of bytes.
+/// @param dst Receives 2 * @p length characters.
+/// @param upperCase `true` to use upper case digits.
+void EncodeHex(_In_reads_bytes_(length) const std::byte* __restrict const src, const std::size_t length, _Out_writes_(length * 2) char* __restrict const dst, const bool upperCase) noexcept {
+	std::size_t i = 0;
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	const __m128i mask = _mm_set1_epi8(0x0F);
+	const __m128i nine = _mm_set1_epi8(9);
+	const __m128i zero = _mm_set1_epi8('0');
+	// distance from the character after '9' to the first letter
+	const __m128i letters = _mm_set1_epi8(static_cast<char>((upperCase ? 'A' : 'a') - '0' - 10));
+	for (; i + sizeof(__m128i) <= length; i += sizeof(__m128i)) {
+		const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[i]));
+		const __m128i high = _mm_and_si128(_mm_srli_epi16(value, 4), mask);
+		const __m128i low = _mm_and_si128(value, mask);
+		const __m128i highDigits = _mm_add_epi8(_mm_add_epi8(high, zero), _mm_and_si128(_mm_cmpgt_epi8(high, nine), letters));
+		const __m128i lowDigits = _mm_add_epi8(_mm_add_epi8(low, zero), _mm_and_si128(_mm_cmpgt_epi8(low, nine), letters));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&dst[i * 2]), _mm_unpacklo_epi8(highDigits, lowDigits));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&dst[i * 2 + sizeof(__m128i)]), _mm_unpackhi_epi8(highDigits, lowDigits));
+	}
+#endif
+	const char* const digits = upperCase ? "0123456789ABCDEF" : "0123456789abcdef";
+	for (; i < length; ++i) {
+		const std::uint8_t value = static_cast<std::uint8_t>(src[i]);
+		dst[i * 2] = digits[value >> 4u];
+		dst[i * 2 + 1] = digits[value & 0x0Fu];
+	}
+}
+
+/// @brief Format bytes as lines of 16 bytes each with an optional offset and ASCII column.
+/// @param data The bytes.
+/// @param length The number of bytes.
+/// @param upperCase `true` to use upper case digits.
+/// @param offset `true` to start each line with the offset.
+/// @param ascii `true` to end each line with the printable characters.
+/// @param out The output iterator.
+/// @return The output iterator after the last character.
+fmt::format_context::iterator FormatHexLines(_In_reads_bytes_(length) const std::byte* __restrict const data, const std::size_t length, const bool upperCase, const bool offset, const bool ascii, fmt::format_context::iterator out) {
+	constexpr std::size_t kBytesPerLine = 16;
+	// newline, offset, bytes with separators and ASCII column
+	char line[1 + 10 + kBytesPerLine * 3 + 1 + 2 + kBytesPerLine + 1];
+	char hex[kBytesPerLine * 2];
+
+	for (std::size_t i = 0; i < length; i += kBytesPerLine) {
+		const std::size_t count = std::min(length - i, kBytesPerLine);
+		char* p = line;
+		if (i) {
+			*p++ = '\n';
+		}
+		if (offset) {
+			const std::byte position[] = {static_cast<std::byte>(i >> 24u), static_cast<std::byte>(i >> 16u), static_cast<std::byte>(i >> 8u), static_cast<std::byte>(i)};
+			EncodeHex(position, sizeof(position), p, upperCase);
+			p += sizeof(position) * 2;
+			*p++ = ' ';
+			*p++ = ' ';
+		}
+		EncodeHex(&data[i], count, hex, upperCase);
+		for (std::size_t j = 0; j < kBytesPerLine; ++j) {
+			if (j < count) {
+				*p++ = hex[j * 2];
+				*p++ = hex[j * 2 + 1];
+			} else if (ascii) {
+				// align ASCII column
+				*p++ = ' ';
+				*p++ = ' ';
+			} else {
+				break;
+			}
+			*p++ = ' ';
+			if (j == kBytesPerLine / 2 - 1) {
+				*p++ = ' ';
+			}
+		}
+		if (ascii) {
+			*p++ = ' ';
+			*p++ = '|';
+			for (std::size_t j = 0; j < count; ++j) {
+				const char chr = static_cast<char>(data[i + j]);
+				*p++ = chr >= ' ' && chr <= '~' ? chr : '.';
+			}
+			*p++ = '|';
+		} else {
+			// remove trailing separators
+			while (p[-1] == ' ') {
+				--p;
+			}
+		}
+		out = std::copy(line, p, out);
+	}
+	return out;
+}
+
+/// @brief Format the elements of a range.
+/// @details The format specification is parsed once for the whole range.
+/// @tparam T The type of the elements.
+/// @param data The address of the first element.
+/// @param length The number of elements.
+/// @param spec The format specification for a single element.
+/// @param ctx see `fmt::formatter::format`.
+/// @return see `fmt::formatter::format`.
+template <typename T>
+fmt::format_context::iterator FormatRangeElements(_In_reads_bytes_(length * sizeof(T)) const std::byte* __restrict const data, const llamalog::LogLine::Length length, const std::string_view& spec, fmt::format_context& ctx) {
+	fmt::formatter<T> formatter;
+	fmt::format_parse_context parseContext(fmt::string_view(spec.data(), spec.size()));
+	formatter.parse(parseContext);
+
+	auto out = ctx.out();
+	for (llamalog::LogLine::Length i = 0; i < length; ++i) {
+		if (i) {
+			*out++ = ',';
+			*out++ = ' ';
+			ctx.advance_to(out);
+		}
+		out = formatter.format(llamalog::buffer::GetValue<T>(&data[i * sizeof(T)]), ctx);
+	}
+	return out;
+}
+
+}  // namespace
+
 }  // namespace llamalog::internal
 
 
@@ -81,15 +238,13 @@ fmt::format_parse_context::iterator fmt::formatter<llamalog::marker::NullValue>:
 	while (end != last && *end != '}') {
 		++end;
 	}
-	if (it == end) {
-		m_value.assign("(null)");
-	} else {
-		m_value.assign(it, end);
+	if (it != end) {
+		m_value = std::string_view(it, end - it);
 	}
 	return end;
 }
 
-fmt::format_context::iterator fmt::formatter<llamalog::marker::NullValue>::format(const llamalog::marker::NullValue& /* arg */, fmt::format_context& ctx) {  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
+fmt::format_context::iterator fmt::formatter<llamalog::marker::NullValue>::format(const llamalog::marker::NullValue& /* arg */, fmt::format_context& ctx) const {  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
 	return std::copy(m_value.cbegin(), m_value.cend(), ctx.out());
 }
 
@@ -105,7 +260,7 @@ fmt::format_context::iterator fmt::formatter<llamalog::marker::InlineChar>::form
 	static_assert(alignof(char) == 1, "alignment of char");
 	const char* const str = reinterpret_cast<const char*>(&buffer[sizeof(length)]);
 
-	return fmt::vformat_to(ctx.out(), fmt::to_string_view(GetFormat()), fmt::basic_format_args(fmt::make_format_args(std::string_view(str, length))));
+	return Format(std::string_view(str, length), ctx);
 }
 
 
@@ -116,39 +271,179 @@ fmt::format_context::iterator fmt::formatter<llamalog::marker::InlineWideChar>::
 	const std::byte* __restrict const buffer = reinterpret_cast<const std::byte*>(&arg);
 
 	const llamalog::LogLine::Length length = llamalog::buffer::GetValue<llamalog::LogLine::Length>(buffer);
-	if (!length) {
-		// calling WideCharToMultiByte with input length 0 is an error
-		return ctx.out();
-	}
 	const llamalog::LogLine::Align padding = llamalog::buffer::GetPadding<wchar_t>(&buffer[sizeof(length)]);
 	const wchar_t* const wstr = reinterpret_cast<const wchar_t*>(&buffer[sizeof(length) + padding]);
 
-	DWORD lastError;  // NOLINT(cppcoreguidelines-init-variables): Guaranteed to be initialized before first read.
-	if (constexpr llamalog::LogLine::Length kFixedBufferSize = 256; length <= kFixedBufferSize) {
-		// try with a fixed size buffer
-		char sz[kFixedBufferSize];
-		const int sizeInBytes = WideCharToMultiByte(CP_UTF8, 0, wstr, static_cast<int>(length), sz, sizeof(sz), nullptr, nullptr);
-		if (sizeInBytes) {
-			return fmt::vformat_to(ctx.out(), fmt::to_string_view(GetFormat()), fmt::basic_format_args(fmt::make_format_args(std::string_view(sz, sizeInBytes / sizeof(char)))));
-		}
-		lastError = GetLastError();
-		if (lastError != ERROR_INSUFFICIENT_BUFFER) {
-			goto error;  // NOLINT(cppcoreguidelines-avoid-goto, hicpp-avoid-goto): Yes, I DO want a goto here
+	return Format(wstr, length, ctx);
+}
+
+
+// InlineRange
+
+fmt::format_parse_context::iterator fmt::formatter<llamalog::marker::InlineRange>::parse(const fmt::format_parse_context& ctx) {  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
+	auto start = ctx.begin();
+	const auto last = ctx.end();
+	if (start != last && *start == ':') {
+		++start;
+	}
+	if (start != last && *start == 'n') {
+		m_brackets = false;
+		++start;
+	}
+	if (start != last && *start == ':') {
+		++start;
+	}
+	auto end = start;
+	while (end != last && *end != '}') {
+		++end;
+	}
+
+	m_format = std::string_view(start, end - start);
+	return end;
+}
+
+fmt::format_context::iterator fmt::formatter<llamalog::marker::InlineRange>::format(const llamalog::marker::InlineRange& arg, fmt::format_context& ctx) const {  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
+	using llamalog::buffer::kTypeId;
+
+	// address of buffer is at the address of the element type field
+	const std::byte* __restrict const buffer = reinterpret_cast<const std::byte*>(&arg);
+
+	const llamalog::buffer::TypeId elementTypeId = llamalog::buffer::GetValue<llamalog::buffer::TypeId>(buffer);
+	const llamalog::LogLine::Length length = llamalog::buffer::GetValue<llamalog::LogLine::Length>(&buffer[sizeof(elementTypeId)]);
+	const llamalog::LogLine::Size offset = sizeof(elementTypeId) + sizeof(length);
+	const llamalog::LogLine::Align padding = llamalog::buffer::GetPadding(&buffer[offset], llamalog::buffer::GetRangeElementSize(elementTypeId));
+	const std::byte* __restrict const data = &buffer[offset + padding];
+
+	if (m_brackets) {
+		auto out = ctx.out();
+		*out++ = '[';
+		ctx.advance_to(out);
+	}
+
+	/// @cond hide
+#pragma push_macro("FORMAT_")
+// NOLINTNEXTLINE(cppcoreguidelines-macro-usage): Not possible without macro.
+#define FORMAT_(type_)                                                                               \
+	case kTypeId<type_>:                                                                             \
+		ctx.advance_to(llamalog::internal::FormatRangeElements<type_>(data, length, m_format, ctx)); \
+		break
+	/// @endcond
+
+	switch (elementTypeId) {
+		FORMAT_(signed char);
+		FORMAT_(unsigned char);
+		FORMAT_(signed short);
+		FORMAT_(unsigned short);
+		FORMAT_(signed int);
+		FORMAT_(unsigned int);
+		FORMAT_(signed long);
+		FORMAT_(unsigned long);
+		FORMAT_(signed long long);
+		FORMAT_(unsigned long long);
+		FORMAT_(float);
+		FORMAT_(double);
+		FORMAT_(long double);
+	default:
+		assert(false);
+		__assume(false);
+	}
+#pragma pop_macro("FORMAT_")
+
+	auto out = ctx.out();
+	if (m_brackets) {
+		*out++ = ']';
+	}
+	return out;
+}
+
+
+// InlineHexDump
+
+fmt::format_parse_context::iterator fmt::formatter<llamalog::marker::InlineHexDump>::parse(const fmt::format_parse_context& ctx) {  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
+	auto it = ctx.begin();
+	const auto last = ctx.end();
+	if (it != last && *it == ':') {
+		++it;
+	}
+	for (; it != last && *it != '}'; ++it) {
+		switch (*it) {
+		case 'X':
+			m_upperCase = true;
+			break;
+		case 's':
+			m_separate = true;
+			break;
+		case 'o':
+			m_offset = true;
+			break;
+		case 'a':
+			m_ascii = true;
+			break;
+		case '.':
+			m_maxBytes = 0;
+			while (it + 1 != last && *(it + 1) >= '0' && *(it + 1) <= '9') {
+				++it;
+				m_maxBytes = m_maxBytes * 10 + (*it - '0');  // NOLINT(cppcoreguidelines-avoid-magic-numbers, readability-magic-numbers): Decimal number.
+			}
+			break;
+		default:
+			throw fmt::format_error("invalid format specifier for hexdump");
 		}
 	}
-	{
-		const int sizeInBytes = WideCharToMultiByte(CP_UTF8, 0, wstr, static_cast<int>(length), nullptr, 0, nullptr, nullptr);
-		if (sizeInBytes) {
-			std::unique_ptr<char[]> str = std::make_unique<char[]>(sizeInBytes / sizeof(char));
-			if (WideCharToMultiByte(CP_UTF8, 0, wstr, static_cast<int>(length), str.get(), sizeInBytes, nullptr, nullptr)) {
-				return fmt::vformat_to(ctx.out(), fmt::to_string_view(GetFormat()), fmt::basic_format_args(fmt::make_format_args(std::string_view(str.get(), sizeInBytes / sizeof(char)))));
+	return it;
+}
+
+fmt::format_context::iterator fmt::formatter<llamalog::marker::InlineHexDump>::format(const llamalog::marker::InlineHexDump& arg, fmt::format_context& ctx) const {  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
+	// address of buffer is at the address of the length field
+	const std::byte* __restrict const buffer = reinterpret_cast<const std::byte*>(&arg);
+
+	const llamalog::LogLine::Length length = llamalog::buffer::GetValue<llamalog::LogLine::Length>(buffer);
+	const std::byte* __restrict const data = &buffer[sizeof(length)];
+	const std::size_t count = std::min<std::size_t>(length, m_maxBytes);
+
+	auto out = ctx.out();
+	if (m_offset || m_ascii) {
+		out = llamalog::internal::FormatHexLines(data, count, m_upperCase, m_offset, m_ascii, out);
+	} else {
+		constexpr std::size_t kChunkBytes = 256;
+		char hex[kChunkBytes * 2];
+		for (std::size_t i = 0; i < count; i += kChunkBytes) {
+			const std::size_t chunk = std::min(count - i, kChunkBytes);
+			llamalog::internal::EncodeHex(&data[i], chunk, hex, m_upperCase);
+			if (m_separate) {
+				for (std::size_t j = 0; j < chunk; ++j) {
+					if (i + j) {
+						*out++ = ' ';
+					}
+					*out++ = hex[j * 2];
+					*out++ = hex[j * 2 + 1];
+				}
+			} else {
+				out = std::copy(hex, &hex[chunk * 2], out);
 			}
 		}
-		lastError = GetLastError();
 	}
+	if (count < length) {
+		const std::string_view sv("...");
+		out = std::copy(sv.cbegin(), sv.cend(), out);
+	}
+	return out;
+}
+
+
+// MovedString
+
+fmt::format_context::iterator fmt::formatter<llamalog::marker::MovedString<char>>::format(const llamalog::marker::MovedString<char>& arg, fmt::format_context& ctx) const {  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
+	return Format(arg.value, ctx);
+}
+
+fmt::format_context::iterator fmt::formatter<llamalog::marker::MovedString<wchar_t>>::format(const llamalog::marker::MovedString<wchar_t>& arg, fmt::format_context& ctx) const {  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
+	return Format(arg.value.c_str(), arg.value.length(), ctx);
+}
+
+
+// literal
 
-error:
-	LLAMALOG_INTERNAL_ERROR("WideCharToMultiByte for length {}: {}", length, llamalog::error_code{lastError});
-	const std::string_view sv("<ERROR>");
-	return std::copy(sv.cbegin(), sv.cend(), ctx.out());
+fmt::format_context::iterator fmt::formatter<llamalog::literal>::format(const llamalog::literal& arg, fmt::format_context& ctx) const {  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
+	return Format(std::string_view(arg.value, arg.length), ctx);
 }
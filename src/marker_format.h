@@ -19,14 +19,30 @@ limitations under the License.
 #pragma once
 
 #include <fmt/core.h>
+#include <fmt/format.h>
 
-#include <string>
+#include <sal.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace llamalog {
+
+struct literal;
+
+}  // namespace llamalog
 
 namespace llamalog::marker {
 
 struct NullValue;
 struct InlineChar;
 struct InlineWideChar;
+struct InlineRange;
+struct InlineHexDump;
+
+template <typename T>
+struct MovedString;
 
 }  // namespace llamalog::marker
 
@@ -41,12 +57,24 @@ struct __declspec(novtable) InlineCharBaseFormatter {
 	fmt::format_parse_context::iterator parse(const fmt::format_parse_context& ctx);  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
 
 protected:
-	[[nodiscard]] const std::string& GetFormat() const noexcept {
-		return m_format;
-	}
+	/// @brief Format a string using the parsed format specification.
+	/// @param sv The string.
+	/// @param ctx see `fmt::formatter::format`.
+	/// @return see `fmt::formatter::format`.
+	fmt::format_context::iterator Format(const std::string_view& sv, fmt::format_context& ctx) const;
+
+	/// @brief Convert a wide character string to UTF-8 and format the result using the parsed format specification.
+	/// @param wstr The wide character string.
+	/// @param length The length of @p wstr in characters.
+	/// @param ctx see `fmt::formatter::format`.
+	/// @return see `fmt::formatter::format`.
+	fmt::format_context::iterator Format(_In_reads_(length) const wchar_t* __restrict wstr, std::size_t length, fmt::format_context& ctx) const;
 
 private:
-	std::string m_format;  ///< @brief The original format pattern with the argument number (if any) removed.
+	/// @brief The formatter holding the parsed format specification.
+	/// @note The `format` function of the {fmt} formatters is not `const`.
+	mutable fmt::formatter<fmt::string_view> m_formatter;
+	bool m_plain = true;  ///< @brief `true` if the format pattern has no format specification. @hideinitializer
 };
 
 }  // namespace llamalog::internal
@@ -67,10 +95,10 @@ public:
 	/// @brief Format the `null` value.
 	/// @param ctx see `fmt::formatter::format`.
 	/// @return see `fmt::formatter::format`.
-	fmt::format_context::iterator format(const llamalog::marker::NullValue& /* arg */, fmt::format_context& ctx);  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
+	fmt::format_context::iterator format(const llamalog::marker::NullValue& /* arg */, fmt::format_context& ctx) const;  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
 
 private:
-	std::string m_value;  ///< @brief The format pattern for the null value
+	std::string_view m_value = "(null)";  ///< @brief The output for the null value which points into the format pattern. @hideinitializer
 };
 
 template <>
@@ -93,3 +121,80 @@ struct fmt::formatter<llamalog::marker::InlineWideChar> : public llamalog::inter
 	/// @return see `fmt::formatter::format`.
 	fmt::format_context::iterator format(const llamalog::marker::InlineWideChar& arg, fmt::format_context& ctx) const;  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
 };
+
+/// @brief Specialization of `fmt::formatter` for ranges of values stored inline in the buffer.
+/// @details The format pattern follows the syntax of {fmt} for ranges: `n` removes the brackets and the pattern after a
+/// second colon is applied to each element, e.g. `{:n:02x}`. For convenience, the second colon MAY be omitted.
+template <>
+struct fmt::formatter<llamalog::marker::InlineRange> {
+public:
+	/// @brief Parse the format string.
+	/// @param ctx see `fmt::formatter::parse`.
+	/// @return see `fmt::formatter::parse`.
+	fmt::format_parse_context::iterator parse(const fmt::format_parse_context& ctx);  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
+
+	/// @brief Format the range stored inline in the buffer.
+	/// @param arg A structure providing the address of the range.
+	/// @param ctx see `fmt::formatter::format`.
+	/// @return see `fmt::formatter::format`.
+	fmt::format_context::iterator format(const llamalog::marker::InlineRange& arg, fmt::format_context& ctx) const;  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
+
+private:
+	std::string_view m_format;  ///< @brief The format specification for a single element pointing into the format pattern.
+	bool m_brackets = true;     ///< @brief `false` if the output is not enclosed in brackets. @hideinitializer
+};
+
+/// @brief Specialization of `fmt::formatter` for binary data stored inline in the buffer.
+/// @details The supported format options are described for `llamalog::hexdump`.
+template <>
+struct fmt::formatter<llamalog::marker::InlineHexDump> {
+public:
+	/// @brief Parse the format string.
+	/// @param ctx see `fmt::formatter::parse`.
+	/// @return see `fmt::formatter::parse`.
+	fmt::format_parse_context::iterator parse(const fmt::format_parse_context& ctx);  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
+
+	/// @brief Format the binary data stored inline in the buffer.
+	/// @param arg A structure providing the address of the data.
+	/// @param ctx see `fmt::formatter::format`.
+	/// @return see `fmt::formatter::format`.
+	fmt::format_context::iterator format(const llamalog::marker::InlineHexDump& arg, fmt::format_context& ctx) const;  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
+
+private:
+	std::size_t m_maxBytes = SIZE_MAX;  ///< @brief The maximum number of bytes to print. @hideinitializer
+	bool m_upperCase = false;           ///< @brief `true` to print upper case digits. @hideinitializer
+	bool m_separate = false;            ///< @brief `true` to separate bytes by spaces. @hideinitializer
+	bool m_offset = false;              ///< @brief `true` to print lines with a leading offset. @hideinitializer
+	bool m_ascii = false;               ///< @brief `true` to print lines with a trailing ASCII column. @hideinitializer
+};
+
+/// @brief Specialization of `fmt::formatter` for strings which have been moved to the buffer.
+template <>
+struct fmt::formatter<llamalog::marker::MovedString<char>> : public llamalog::internal::InlineCharBaseFormatter {
+	/// @brief Format the string.
+	/// @param arg The string.
+	/// @param ctx see `fmt::formatter::format`.
+	/// @return see `fmt::formatter::format`.
+	fmt::format_context::iterator format(const llamalog::marker::MovedString<char>& arg, fmt::format_context& ctx) const;  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
+};
+
+/// @brief Specialization of `fmt::formatter` for wide character strings which have been moved to the buffer.
+/// @details The output is converted to UTF-8.
+template <>
+struct fmt::formatter<llamalog::marker::MovedString<wchar_t>> : public llamalog::internal::InlineCharBaseFormatter {
+	/// @brief Format the wide character string.
+	/// @param arg The wide character string.
+	/// @param ctx see `fmt::formatter::format`.
+	/// @return see `fmt::formatter::format`.
+	fmt::format_context::iterator format(const llamalog::marker::MovedString<wchar_t>& arg, fmt::format_context& ctx) const;  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
+};
+
+/// @brief Specialization of `fmt::formatter` for string literals which are stored by address.
+template <>
+struct fmt::formatter<llamalog::literal> : public llamalog::internal::InlineCharBaseFormatter {
+	/// @brief Format the string literal.
+	/// @param arg The address and length of the string.
+	/// @param ctx see `fmt::formatter::format`.
+	/// @return see `fmt::formatter::format`.
+	fmt::format_context::iterator format(const llamalog::literal& arg, fmt::format_context& ctx) const;  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
+};
@@ -19,6 +19,7 @@ limitations under the License.
 #pragma once
 
 #include <cstddef>
+#include <string>
 
 namespace llamalog::marker {
 
@@ -43,6 +44,28 @@ struct InlineWideChar final {
 	// empty
 };
 
+/// @brief Helper class to pass a range of values stored inline in the buffer to the formatter.
+/// @details The struct is only used for (safe) type punning to guide the output to the correct formatter.
+/// Therefore all constructors, destructors and assignment operators deleted.
+struct InlineRange final {
+	// empty
+};
+
+/// @brief Helper class to pass binary data stored inline in the buffer to the formatter.
+/// @details The struct is only used for (safe) type punning to guide the output to the correct formatter.
+/// Therefore all constructors, destructors and assignment operators deleted.
+struct InlineHexDump final {
+	// empty
+};
+
+/// @brief A temporary string which has been moved to the buffer instead of being copied.
+/// @details The string is stored as a custom argument. A separate type is required to select the formatter.
+/// @tparam T The character type, i.e. either `char` or `wchar_t`.
+template <typename T>
+struct MovedString final {
+	std::basic_string<T> value;  ///< @brief The string.
+};
+
 /// @brief Marker type for type-based lookup.
 /// @details All constructors, destructors and assignment operators are intentionally deleted.
 struct TriviallyCopyable final {
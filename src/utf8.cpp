@@ -0,0 +1,158 @@
+/*
+Copyright 2020 Michael Beckh
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/// @file
+
+#include "utf8.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+
+namespace llamalog::internal {
+
+namespace {
+
+/// @brief The replacement character U+FFFD for invalid input.
+constexpr std::uint32_t kReplacementCharacter = 0xFFFDu;
+
+/// @brief The number of code units processed at once by `CopyAsciiBlock`.
+#if defined(__AVX2__)
+constexpr std::size_t kAsciiBlockSize = sizeof(wchar_t) == 2 ? 32 : 16;
+#elif defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+constexpr std::size_t kAsciiBlockSize = 16;
+#else
+constexpr std::size_t kAsciiBlockSize = 0;
+#endif
+
+/// @brief Check if all code units in a block are ASCII characters and copy them to the output if they are.
+/// @param src The wide character string which MUST contain at least `kAsciiBlockSize` code units.
+/// @param dst Receives the characters.
+/// @return The number of code units processed, i.e. 0 if the block contains any non-ASCII character.
+[[nodiscard]] std::size_t CopyAsciiBlock(_In_reads_(kAsciiBlockSize) const wchar_t* __restrict const src, _Out_writes_(kAsciiBlockSize) char* __restrict const dst) noexcept {
+#if defined(__AVX2__)
+	if constexpr (sizeof(wchar_t) == 2) {
+		const __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+		const __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 16));
+		if (!_mm256_testz_si256(_mm256_or_si256(v0, v1), _mm256_set1_epi16(static_cast<std::int16_t>(0xFF80u)))) {
+			return 0;
+		}
+		// packing works per 128 bit lane, so restore the order of the 64 bit blocks afterwards
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_permute4x64_epi64(_mm256_packus_epi16(v0, v1), 0xD8));
+		return 32;
+	}
+#endif
+#if defined(__AVX2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+	const __m128i zero = _mm_setzero_si128();
+	if constexpr (sizeof(wchar_t) == 2) {
+		const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+		const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 8));
+		const __m128i nonAscii = _mm_and_si128(_mm_or_si128(v0, v1), _mm_set1_epi16(static_cast<std::int16_t>(0xFF80u)));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi16(nonAscii, zero)) != 0xFFFF) {
+			return 0;
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(v0, v1));
+		return 16;
+	} else {
+		const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+		const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4));
+		const __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 8));
+		const __m128i v3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 12));
+		const __m128i nonAscii = _mm_and_si128(_mm_or_si128(_mm_or_si128(v0, v1), _mm_or_si128(v2, v3)), _mm_set1_epi32(static_cast<std::int32_t>(0xFFFFFF80u)));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(nonAscii, zero)) != 0xFFFF) {
+			return 0;
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(_mm_packs_epi32(v0, v1), _mm_packs_epi32(v2, v3)));
+		return 16;
+	}
+#else
+	static_cast<void>(src);
+	static_cast<void>(dst);
+	return 0;
+#endif
+}
+
+/// @brief Encode a single code point as UTF-8.
+/// @param codePoint The code point which MUST be valid.
+/// @param dst Receives up to 4 characters.
+/// @return The number of characters written.
+std::size_t EncodeCodePoint(const std::uint32_t codePoint, _Out_writes_to_(4, return) char* __restrict const dst) noexcept {
+	if (codePoint < 0x80u) {
+		dst[0] = static_cast<char>(codePoint);
+		return 1;
+	}
+	if (codePoint < 0x800u) {
+		dst[0] = static_cast<char>(0xC0u | (codePoint >> 6u));
+		dst[1] = static_cast<char>(0x80u | (codePoint & 0x3Fu));
+		return 2;
+	}
+	if (codePoint < 0x10000u) {
+		dst[0] = static_cast<char>(0xE0u | (codePoint >> 12u));
+		dst[1] = static_cast<char>(0x80u | ((codePoint >> 6u) & 0x3Fu));
+		dst[2] = static_cast<char>(0x80u | (codePoint & 0x3Fu));
+		return 3;
+	}
+	dst[0] = static_cast<char>(0xF0u | (codePoint >> 18u));
+	dst[1] = static_cast<char>(0x80u | ((codePoint >> 12u) & 0x3Fu));
+	dst[2] = static_cast<char>(0x80u | ((codePoint >> 6u) & 0x3Fu));
+	dst[3] = static_cast<char>(0x80u | (codePoint & 0x3Fu));
+	return 4;
+}
+
+}  // namespace
+
+std::size_t ConvertToUtf8(_In_reads_(length) const wchar_t* __restrict const src, const std::size_t length, _Out_writes_to_(length * kMaxUtf8BytesPerWideChar, return) char* __restrict const dst) noexcept {
+	std::size_t i = 0;
+	std::size_t pos = 0;
+	while (i < length) {
+		if (kAsciiBlockSize && i + kAsciiBlockSize <= length) {
+			if (const std::size_t count = CopyAsciiBlock(&src[i], &dst[pos]); count) {
+				i += count;
+				pos += count;
+				continue;
+			}
+		}
+
+		// convert the next block one by one, or the remainder if it is too short for a block
+		const std::size_t end = kAsciiBlockSize && i + kAsciiBlockSize <= length ? i + kAsciiBlockSize : length;
+		while (i < end) {
+			std::uint32_t codePoint = static_cast<std::uint32_t>(src[i++]);
+			if constexpr (sizeof(wchar_t) == 2) {
+				if ((codePoint & 0xF800u) == 0xD800u) {
+					// pairs MAY extend beyond the end of the block
+					if (codePoint < 0xDC00u && i < length && (static_cast<std::uint32_t>(src[i]) & 0xFC00u) == 0xDC00u) {
+						codePoint = 0x10000u + ((codePoint - 0xD800u) << 10u) + (static_cast<std::uint32_t>(src[i++]) - 0xDC00u);
+					} else {
+						codePoint = kReplacementCharacter;
+					}
+				}
+			} else {
+				if ((codePoint & 0xFFFFF800u) == 0xD800u || codePoint > 0x10FFFFu) {
+					codePoint = kReplacementCharacter;
+				}
+			}
+			pos += EncodeCodePoint(codePoint, &dst[pos]);
+		}
+	}
+	return pos;
+}
+
+}  // namespace llamalog::internal
@@ -0,0 +1,86 @@
+/*
+Copyright 2020 Michael Beckh
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/// @file
+/// @brief Conversion of wide character strings to UTF-8 without any calls to the operating system.
+#pragma once
+
+#ifdef _MSC_VER
+#include <sal.h>
+#else
+// SAL annotations are only available for the Microsoft toolchain.
+#ifndef _In_reads_
+// NOLINTNEXTLINE(cppcoreguidelines-macro-usage, bugprone-reserved-identifier): MUST use name as in sal.h.
+#define _In_reads_(size_)
+#endif
+#ifndef _Out_writes_
+// NOLINTNEXTLINE(cppcoreguidelines-macro-usage, bugprone-reserved-identifier): MUST use name as in sal.h.
+#define _Out_writes_(size_)
+#endif
+#ifndef _Out_writes_to_
+// NOLINTNEXTLINE(cppcoreguidelines-macro-usage, bugprone-reserved-identifier): MUST use name as in sal.h.
+#define _Out_writes_to_(size_, count_)
+#endif
+#endif
+
+#include <algorithm>
+#include <cstddef>
+
+namespace llamalog::internal {
+
+/// @brief The maximum number of UTF-8 bytes produced for a single `wchar_t`.
+/// @details A surrogate pair produces 4 bytes for 2 code units, a UTF-32 code unit at most 4 bytes.
+constexpr std::size_t kMaxUtf8BytesPerWideChar = sizeof(wchar_t) == 2 ? 3 : 4;
+
+/// @brief Convert a wide character string to UTF-8.
+/// @details The string is treated as UTF-16 if `wchar_t` has 2 bytes and as UTF-32 otherwise. Unpaired surrogates and
+/// invalid code points are replaced by U+FFFD which is the same behavior as `WideCharToMultiByte` without
+/// `WC_ERR_INVALID_CHARS`. Sequences of ASCII characters are converted 16 (or 32 with AVX2) at a time.
+/// @param src The wide character string.
+/// @param length The number of code units in @p src.
+/// @param dst Receives the UTF-8 string which is NOT null terminated. The buffer MUST have room for at least
+/// `length * kMaxUtf8BytesPerWideChar` characters.
+/// @return The number of characters written to @p dst.
+std::size_t ConvertToUtf8(_In_reads_(length) const wchar_t* __restrict src, std::size_t length, _Out_writes_to_(length * kMaxUtf8BytesPerWideChar, return) char* __restrict dst) noexcept;
+
+/// @brief Convert a wide character string to UTF-8 and copy the result to an output iterator.
+/// @details The conversion uses a fixed size buffer on the stack and never allocates memory.
+/// @tparam OutputIt The type of the output iterator.
+/// @param src The wide character string.
+/// @param length The number of code units in @p src.
+/// @param out The output iterator.
+/// @return The output iterator after the last character.
+template <typename OutputIt>
+OutputIt CopyAsUtf8(_In_reads_(length) const wchar_t* __restrict src, std::size_t length, OutputIt out) {
+	constexpr std::size_t kChunkSize = 256;
+	char buffer[kChunkSize * kMaxUtf8BytesPerWideChar];
+	while (length) {
+		std::size_t count = std::min(length, kChunkSize);
+		if constexpr (sizeof(wchar_t) == 2) {
+			// never split a surrogate pair
+			if (count < length && (static_cast<unsigned int>(src[count - 1]) & 0xFC00u) == 0xD800u) {
+				--count;
+			}
+		}
+		const std::size_t size = ConvertToUtf8(src, count, buffer);
+		out = std::copy(buffer, buffer + size, out);
+		src += count;
+		length -= count;
+	}
+	return out;
+}
+
+}  // namespace llamalog::internal
@@ -18,20 +18,18 @@ limitations under the License.
 
 #include "llamalog/winapi_format.h"
 
-#include "llamalog/Logger.h"
-#include "llamalog/finally.h"
+#include "error_message.h"
+
 #include "llamalog/winapi_log.h"
 
 #include <fmt/core.h>
+#include <fmt/format.h>
 
 #include <windows.h>
 
 #include <algorithm>
-#include <cassert>
 #include <cstddef>
 #include <cstdint>
-#include <limits>
-#include <memory>
 #include <string_view>
 
 
@@ -43,90 +41,76 @@ namespace llamalog {
 
 namespace {
 
-/// @brief Remove trailing line feeds from an error message, encode as UTF-8 and print.
-/// @remarks This function is a helper for `#FormatSystemErrorCodeTo()`.
-/// @param message The error message.
-/// @param length The length of the error message NOT including a terminating null character.
-/// @param ctx The output target.
-/// @result The output iterator.
-fmt::format_context::iterator PostProcessErrorMessage(_In_reads_(length) wchar_t* __restrict const message, std::size_t length, fmt::format_context& ctx) {
-	if (length >= 2) {
-		if (message[length - 2] == L'\r' || message[length - 2] == L'\n') {
-			message[length -= 2] = L'\0';
-		} else if (message[length - 1] == L' ' || message[length - 1] == L'\n' || message[length - 1] == L'\r') {
-			message[length -= 1] = L'\0';
-		} else {
-			// leave message as it is
-		}
-	}
-
-	if (!length) {
-		// calling WideCharToMultiByte with input length 0 is an error
-		return ctx.out();
-	}
+constexpr char kSuppressErrorCode = '%';  ///< @brief Special character used in the format string to suppress printing the error code.
 
-	DWORD lastError;  // NOLINT(cppcoreguidelines-init-variables): Guaranteed to be initialized before first read.
-	if (constexpr std::size_t kFixedBufferSize = 256; length <= kFixedBufferSize) {
-		// try with a fixed size buffer
-		char sz[kFixedBufferSize];
-		const int sizeInBytes = WideCharToMultiByte(CP_UTF8, 0, message, static_cast<int>(length), sz, sizeof(sz), nullptr, nullptr);
-		if (sizeInBytes) {
-			return std::copy(sz, sz + sizeInBytes / sizeof(char), ctx.out());
-		}
-		lastError = GetLastError();
-		if (lastError != ERROR_INSUFFICIENT_BUFFER) {
-			goto error;  // NOLINT(cppcoreguidelines-avoid-goto, hicpp-avoid-goto): Yes, I DO want a goto here.
-		}
+/// @brief Get the format specification from the format string.
+/// @param ctx The parse context.
+/// @param begin Receives the start of the format specification.
+/// @return The end of the format specification.
+[[nodiscard]] fmt::format_parse_context::iterator GetFormatSpecification(const fmt::format_parse_context& ctx, fmt::format_parse_context::iterator& begin) noexcept {
+	begin = ctx.begin();
+	const auto last = ctx.end();
+	if (begin != last && *begin == ':') {
+		++begin;
 	}
-	{
-		const int sizeInBytes = WideCharToMultiByte(CP_UTF8, 0, message, static_cast<int>(length), nullptr, 0, nullptr, nullptr);
-		if (sizeInBytes) {
-			std::unique_ptr<char[]> str = std::make_unique<char[]>(sizeInBytes / sizeof(char));
-			if (WideCharToMultiByte(CP_UTF8, 0, message, static_cast<int>(length), str.get(), sizeInBytes, nullptr, nullptr)) {
-				return std::copy(str.get(), str.get() + sizeInBytes / sizeof(char), ctx.out());
-			}
-		}
-		lastError = GetLastError();
+	auto end = begin;
+	while (end != last && *end != '}') {
+		++end;
 	}
+	return end;
+}
 
-error:
-	LLAMALOG_INTERNAL_ERROR("WideCharToMultiByte for length {}: {}", length, error_code{lastError});
-	const std::string_view sv("<ERROR>");
-	return std::copy(sv.cbegin(), sv.cend(), ctx.out());
+/// @brief Parse a format specification using a formatter of {fmt}.
+/// @tparam T The type of the formatted value.
+/// @param formatter The formatter which stores the parsed format specification.
+/// @param begin The start of the format specification.
+/// @param end The end of the format specification.
+template <typename T>
+void ParseFormatSpecification(fmt::formatter<T>& formatter, const fmt::format_parse_context::iterator begin, const fmt::format_parse_context::iterator end) {
+	fmt::format_parse_context specs(fmt::string_view(begin, end - begin));
+	if (formatter.parse(specs) != specs.end()) {
+		throw fmt::format_error("invalid format specifier");
+	}
 }
 
-/// @brief Create an error message from a system error code and print.
-/// @param errorCode The system error code.
+/// @brief Copy a string to the output and update the context.
+/// @param sv The string.
 /// @param ctx The output target.
 /// @result The output iterator.
-fmt::format_context::iterator FormatSystemErrorCodeTo(const std::uint32_t errorCode, fmt::format_context& ctx) {
-	constexpr std::size_t kDefaultBufferSize = 256;
-	wchar_t buffer[kDefaultBufferSize];
-	DWORD length = FormatMessageW(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS | FORMAT_MESSAGE_MAX_WIDTH_MASK, nullptr, errorCode, 0, buffer, sizeof(buffer) / sizeof(*buffer), nullptr);
-	if (length) {
-		return PostProcessErrorMessage(buffer, length, ctx);
-	}
+fmt::format_context::iterator Append(const std::string_view& sv, fmt::format_context& ctx) {
+	ctx.advance_to(std::copy(sv.cbegin(), sv.cend(), ctx.out()));
+	return ctx.out();
+}
 
-	DWORD lastError = GetLastError();
-	if (lastError == ERROR_INSUFFICIENT_BUFFER) {
-		wchar_t* pBuffer = nullptr;
-
-		auto finally = llamalog::finally([&pBuffer]() noexcept {
-			LocalFree(pBuffer);
-		});
-		length = FormatMessageW(FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS | FORMAT_MESSAGE_MAX_WIDTH_MASK, nullptr, errorCode, 0, reinterpret_cast<wchar_t*>(&pBuffer), 0, nullptr);
-		if (length) {
-			return PostProcessErrorMessage(pBuffer, length, ctx);
-		}
-		lastError = GetLastError();
+/// @brief Print an error code as decimal value if it is a system error code and as hex value else.
+/// @param code The error code.
+/// @param out The output iterator.
+/// @result The output iterator.
+fmt::format_context::iterator FormatErrorCode(std::uint32_t code, fmt::format_context::iterator out) {
+	constexpr std::uint32_t kMaxSystemErrorCode = 0xFFFF;
+	constexpr std::size_t kMaxHexDigits = sizeof(code) * 2;
+	constexpr std::uint32_t kRadix = 16;
+
+	*out++ = ' ';
+	*out++ = '(';
+	if (code <= kMaxSystemErrorCode) {
+		const fmt::format_int value(code);
+		out = std::copy(value.data(), value.data() + value.size(), out);
+	} else {
+		char hex[kMaxHexDigits];
+		std::size_t pos = kMaxHexDigits;
+		do {
+			hex[--pos] = "0123456789abcdef"[code % kRadix];
+			code /= kRadix;
+		} while (code);
+		*out++ = '0';
+		*out++ = 'x';
+		out = std::copy(&hex[pos], &hex[kMaxHexDigits], out);
 	}
-	LLAMALOG_INTERNAL_ERROR("FormatMessageW for code {}: {}", errorCode, error_code{lastError});
-	const std::string_view sv("<ERROR>");
-	return std::copy(sv.cbegin(), sv.cend(), ctx.out());
+	*out++ = ')';
+	return out;
 }
 
-constexpr char kSuppressErrorCode = '%';  ///< @brief Special character used in the format string to suppress printing the error code.
-
 }  // namespace
 }  // namespace llamalog
 
@@ -136,95 +120,69 @@ constexpr char kSuppressErrorCode = '%';  ///< @brief Special character used in
 //
 
 fmt::format_parse_context::iterator fmt::formatter<llamalog::error_code>::parse(const fmt::format_parse_context& ctx) {  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
-	auto it = ctx.begin();
-	const auto last = ctx.end();
-	if (it != last && *it == ':') {
-		++it;
-	}
-	auto end = it;
-	while (end != last && *end != '}') {
-		++end;
-	}
+	fmt::format_parse_context::iterator it;  // NOLINT(cppcoreguidelines-init-variables): Initialized by GetFormatSpecification.
+	const auto end = llamalog::GetFormatSpecification(ctx, it);
 	if (end - it == 1 && *it == llamalog::kSuppressErrorCode) {
 		// a pattern consisting of only a percent is used to suppress the error code
-		m_format.push_back(llamalog::kSuppressErrorCode);
+		m_mode = Mode::kSuppress;
 	} else if (end != it) {
-		constexpr std::size_t kGroupingCharacters = 3;
-		m_format.reserve(end - it + 3 + kGroupingCharacters);
-		m_format.append(" ({:");
-		m_format.append(it, end);
-		m_format.append("})");
-		assert(m_format.length() == static_cast<std::size_t>(end - it) + 3 + kGroupingCharacters);
+		llamalog::ParseFormatSpecification(m_formatter, it, end);
+		m_mode = Mode::kCustom;
 	} else {
-		// use an empty format
+		// use the default format
 	}
 	return end;
 }
 
 fmt::format_context::iterator fmt::formatter<llamalog::error_code>::format(const llamalog::error_code& arg, fmt::format_context& ctx) {  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
-	auto out = llamalog::FormatSystemErrorCodeTo(arg.code, ctx);
-	if (m_format.empty()) {
-		// system error codes lie in the range <= 0xFFFF
-		return fmt::format_to(ctx.out(), arg.code <= std::numeric_limits<std::uint16_t>::max() ? " ({})" : " ({:#x})", arg.code);
-	}
-	if (m_format[0] == llamalog::kSuppressErrorCode) {
-		return out;
+	llamalog::Append(llamalog::internal::GetSystemErrorMessage(arg.code), ctx);
+	switch (m_mode) {
+	case Mode::kDefault:
+		return llamalog::FormatErrorCode(arg.code, ctx.out());
+	case Mode::kCustom:
+		llamalog::Append(" (", ctx);
+		ctx.advance_to(m_formatter.format(arg.code, ctx));
+		return llamalog::Append(")", ctx);
+	case Mode::kSuppress:
+		break;
 	}
-	return fmt::format_to(out, m_format, arg.code);
+	return ctx.out();
 }
 
 
 fmt::format_parse_context::iterator fmt::formatter<POINT>::parse(const fmt::format_parse_context& ctx) {  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
-	auto it = ctx.begin();
-	const auto last = ctx.end();
-	if (it != last && *it == ':') {
-		++it;
-	}
-	auto end = it;
-	while (end != last && *end != '}') {
-		++end;
-	}
-	constexpr std::size_t kGroupingCharacters = 4;
-	m_format.reserve((end - it + 3) * 2 + kGroupingCharacters);
-	m_format.append("({:");
-	m_format.append(it, end);
-	m_format.append("}, {:");
-	m_format.append(it, end);
-	m_format.append("})");
-	assert(m_format.length() == (static_cast<std::size_t>(end - it) + 3) * 2 + kGroupingCharacters);
+	fmt::format_parse_context::iterator it;  // NOLINT(cppcoreguidelines-init-variables): Initialized by GetFormatSpecification.
+	const auto end = llamalog::GetFormatSpecification(ctx, it);
+	llamalog::ParseFormatSpecification(m_formatter, it, end);
 	return end;
 }
 
 fmt::format_context::iterator fmt::formatter<POINT>::format(const POINT& arg, fmt::format_context& ctx) {  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
-	return fmt::format_to(ctx.out(), m_format, arg.x, arg.y);
+	static_assert(sizeof(LONG) == sizeof(std::int32_t), "size of LONG");
+
+	llamalog::Append("(", ctx);
+	ctx.advance_to(m_formatter.format(arg.x, ctx));
+	llamalog::Append(", ", ctx);
+	ctx.advance_to(m_formatter.format(arg.y, ctx));
+	return llamalog::Append(")", ctx);
 }
 
 
 fmt::format_parse_context::iterator fmt::formatter<RECT>::parse(const fmt::format_parse_context& ctx) {  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
-	auto it = ctx.begin();
-	const auto last = ctx.end();
-	if (it != last && *it == ':') {
-		++it;
-	}
-	auto end = it;
-	while (end != last && *end != '}') {
-		++end;
-	}
-	constexpr std::size_t kGroupingCharacters = 13;
-	m_format.reserve((end - it + 3) * 4 + kGroupingCharacters);
-	m_format.append("(({:");
-	m_format.append(it, end);
-	m_format.append("}, {:");
-	m_format.append(it, end);
-	m_format.append("}) - ({:");
-	m_format.append(it, end);
-	m_format.append("}, {:");
-	m_format.append(it, end);
-	m_format.append("}))");
-	assert(m_format.length() == (static_cast<std::size_t>(end - it) + 3) * 4 + kGroupingCharacters);
+	fmt::format_parse_context::iterator it;  // NOLINT(cppcoreguidelines-init-variables): Initialized by GetFormatSpecification.
+	const auto end = llamalog::GetFormatSpecification(ctx, it);
+	llamalog::ParseFormatSpecification(m_formatter, it, end);
 	return end;
 }
 
 fmt::format_context::iterator fmt::formatter<RECT>::format(const RECT& arg, fmt::format_context& ctx) {  // NOLINT(readability-identifier-naming): MUST use name as in fmt::formatter.
-	return fmt::format_to(ctx.out(), m_format, arg.left, arg.top, arg.right, arg.bottom);
+	llamalog::Append("((", ctx);
+	ctx.advance_to(m_formatter.format(arg.left, ctx));
+	llamalog::Append(", ", ctx);
+	ctx.advance_to(m_formatter.format(arg.top, ctx));
+	llamalog::Append(") - (", ctx);
+	ctx.advance_to(m_formatter.format(arg.right, ctx));
+	llamalog::Append(", ", ctx);
+	ctx.advance_to(m_formatter.format(arg.bottom, ctx));
+	return llamalog::Append("))", ctx);
 }
@@ -21,6 +21,7 @@ limitations under the License.
 
 #include <gtest/gtest.h>
 
+#include <array>
 #include <cfloat>
 #include <climits>
 #include <cstddef>
@@ -28,6 +29,8 @@ limitations under the License.
 #include <cstdio>
 #include <new>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 namespace llamalog::test {
 
@@ -37,6 +40,19 @@ LogLine GetLogLine(const char* const pattern = "{} {}") {
 	return LogLine(Priority::kDebug, "file.cpp", 99, "myfunction()", pattern);
 }
 
+std::size_t g_allocations = 0;
+std::size_t g_deallocations = 0;
+
+void* CountingAllocate(const std::size_t size) {
+	++g_allocations;
+	return ::operator new(size);
+}
+
+void CountingDeallocate(void* const ptr, std::size_t /* size */) noexcept {
+	++g_deallocations;
+	::operator delete(ptr);
+}
+
 class CustomTypeTrivial {
 public:
 	CustomTypeTrivial(int value) noexcept
@@ -104,9 +120,18 @@ private:
 	const int m_moves;
 };
 
+class CustomTypeRelocatable : public CustomTypeMove {
+	// empty
+};
+
 }  // namespace
 }  // namespace llamalog::test
 
+template <>
+struct llamalog::IsTriviallyRelocatable<llamalog::test::CustomTypeRelocatable> : std::true_type {
+	// empty
+};
+
 llamalog::LogLine& operator<<(llamalog::LogLine& logLine, const llamalog::test::CustomTypeTrivial& arg) {
 	return logLine.AddCustomArgument(arg);
 }
@@ -119,6 +144,14 @@ llamalog::LogLine& operator<<(llamalog::LogLine& logLine, const llamalog::test::
 	return logLine.AddCustomArgument(arg);
 }
 
+llamalog::LogLine& operator<<(llamalog::LogLine& logLine, llamalog::test::CustomTypeMove&& arg) {
+	return logLine.AddCustomArgument(std::move(arg));
+}
+
+llamalog::LogLine& operator<<(llamalog::LogLine& logLine, const llamalog::test::CustomTypeRelocatable& arg) {
+	return logLine.AddCustomArgument(arg);
+}
+
 template <>
 struct fmt::formatter<llamalog::test::CustomTypeTrivial> {
 public:
@@ -170,6 +203,11 @@ public:
 	}
 };
 
+template <>
+struct fmt::formatter<llamalog::test::CustomTypeRelocatable> : public fmt::formatter<llamalog::test::CustomTypeMove> {
+	// empty
+};
+
 namespace llamalog::test {
 
 //
@@ -968,6 +1006,28 @@ TEST(LogLine_Test, charptr_Escape_PrintEscaped) {
 	EXPECT_EQ("\\\n\r\t\b\f\v\a\u0002\u0019 \\\\\\n\\r\\t\\b\\f\\v\\a\\x02\\x19", str);
 }
 
+TEST(LogLine_Test, charptr_EscapeLongValue_PrintEscaped) {
+	LogLine logLine = GetLogLine("{}");
+	std::string expected;
+	{
+		std::string arg;
+		for (std::size_t i = 0; i < 100; ++i) {
+			// characters requiring escaping at and around the boundaries of 16 and 32 byte blocks
+			if (i == 0 || i == 15 || i == 16 || i == 31 || i == 32 || i == 63 || i == 99) {
+				arg.push_back(i % 2 ? '\\' : '\x0F');
+				expected.append(i % 2 ? "\\\\" : "\\x0F");
+			} else {
+				arg.push_back(i % 3 ? '\xE4' : 'x');
+				expected.push_back(i % 3 ? '\xE4' : 'x');
+			}
+		}
+		logLine << escape(arg.c_str());
+	}
+	const std::string str = logLine.GetLogMessage();
+
+	EXPECT_EQ(expected, str);
+}
+
 TEST(LogLine_Test, charptr_IsNullptr_PrintNull) {
 	LogLine logLine = GetLogLine();
 	{
@@ -1088,6 +1148,54 @@ TEST(LogLine_Test, wcharptr_IsLongValueAfterConversion_PrintUtf8) {
 	EXPECT_EQ("\xC3\xA4xxx", str);
 }
 
+TEST(LogLine_Test, wcharptr_IsSurrogatePair_PrintUtf8) {
+	LogLine logLine = GetLogLine("{} {:s}");
+	{
+		const wchar_t* const arg = L"\xD83D\xDE00";
+		logLine << arg << arg;
+	}
+	const std::string str = logLine.GetLogMessage();
+
+	EXPECT_EQ("\xF0\x9F\x98\x80 \xF0\x9F\x98\x80", str);
+}
+
+TEST(LogLine_Test, wcharptr_IsUnpairedSurrogate_PrintReplacementCharacter) {
+	LogLine logLine = GetLogLine();
+	{
+		const wchar_t* const arg0 = L"x\xD83Dx";
+		const wchar_t* const arg1 = L"\xDE00\xD83D";
+		logLine << arg0 << arg1;
+	}
+	const std::string str = logLine.GetLogMessage();
+
+	EXPECT_EQ("x\xEF\xBF\xBDx \xEF\xBF\xBD\xEF\xBF\xBD", str);
+}
+
+TEST(LogLine_Test, wcharptr_IsLongMixedValue_PrintUtf8) {
+	LogLine logLine = GetLogLine("{}");
+	std::string expected;
+	{
+		std::wstring arg;
+		for (std::size_t i = 0; i < 1000; ++i) {
+			if (i % 85 == 0) {
+				// surrogate pair at varying positions including the boundaries of internal buffers
+				arg.append(L"\xD83D\xDE00");
+				expected.append("\xF0\x9F\x98\x80");
+			} else if (i % 7 == 0) {
+				arg.push_back(L'\xE4');
+				expected.append("\xC3\xA4");
+			} else {
+				arg.push_back(static_cast<wchar_t>(L'a' + i % 26));
+				expected.push_back(static_cast<char>('a' + i % 26));
+			}
+		}
+		logLine << arg.c_str();
+	}
+	const std::string str = logLine.GetLogMessage();
+
+	EXPECT_EQ(expected, str);
+}
+
 TEST(LogLine_Test, wcharptr_Escape_PrintEscaped) {
 	LogLine logLine = GetLogLine();
 	{
@@ -1184,6 +1292,18 @@ TEST(LogLine_Test, string_IsUtf8_PrintUtf8) {
 	EXPECT_EQ(static_cast<char>(0xBC), str[4]);
 }
 
+TEST(LogLine_Test, string_IsLongTemporary_PrintValue) {
+	LogLine logLine = GetLogLine("{:.3} {:?null} {}");
+	{
+		logLine << std::string(1000, 'x') << std::string(70000, 'y') << escape(std::string(1000, '\n'));
+	}
+	const std::string str = logLine.GetLogMessage();
+
+	ASSERT_EQ(3 + 1 + 70000 + 1 + 2000, str.length());
+	EXPECT_EQ("xxx yyy", str.substr(0, 7));
+	EXPECT_EQ("\\n\\n", str.substr(str.length() - 4));
+}
+
 //
 // wstring
 //
@@ -1236,6 +1356,17 @@ TEST(LogLine_Test, wstring_IsUtf8_PrintUtf8) {
 	EXPECT_EQ(static_cast<char>(0xBC), str[4]);
 }
 
+TEST(LogLine_Test, wstring_IsLongTemporary_PrintValue) {
+	LogLine logLine = GetLogLine("{:.3} {:?null}");
+	{
+		logLine << std::wstring(1000, L'x') << std::wstring(70000, L'y');
+	}
+	const std::string str = logLine.GetLogMessage();
+
+	ASSERT_EQ(3 + 1 + 70000, str.length());
+	EXPECT_EQ("xxx yyy", str.substr(0, 7));
+}
+
 //
 // string_view
 //
@@ -1266,6 +1397,191 @@ TEST(LogLine_Test, wstringview_IsReference_PrintValue) {
 	EXPECT_EQ("Test Test", str);
 }
 
+//
+// literal
+//
+
+TEST(LogLine_Test, literal_IsValue_PrintValue) {
+	LogLine logLine = GetLogLine();
+	{
+		const literal arg("Test");
+		logLine << arg << escape(arg);
+	}
+	const std::string str = logLine.GetLogMessage();
+
+	EXPECT_EQ("Test Test", str);
+}
+
+TEST(LogLine_Test, literal_Escape_PrintEscaped) {
+	LogLine logLine = GetLogLine();
+	{
+		const literal arg("\\\n\r\t\b\f\v\a\u0002\u0019");
+		logLine << arg << escape(arg);
+	}
+	const std::string str = logLine.GetLogMessage();
+
+	EXPECT_EQ("\\\n\r\t\b\f\v\a\u0002\u0019 \\\\\\n\\r\\t\\b\\f\\v\\a\\x02\\x19", str);
+}
+
+TEST(LogLine_Test, literal_IsValueWithCustomFormat_PrintValue) {
+	LogLine logLine = GetLogLine("{:>6?null} {:?null}");
+	{
+		const literal arg("Test");
+		logLine << arg << escape(arg);
+	}
+	const std::string str = logLine.GetLogMessage();
+
+	EXPECT_EQ("  Test Test", str);
+}
+
+TEST(LogLine_Test, literal_IsLongValue_StoreAddress) {
+	static constexpr char kValue[] = "0123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789"
+									 "0123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789"
+									 "0123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789";
+	SetHeapBufferAllocator(CountingAllocate, CountingDeallocate);
+	g_allocations = 0;
+	{
+		LogLine logLine = GetLogLine("{:.3} {:.3} {:.3} {:.3}");
+		logLine << literal(kValue) << literal(kValue) << literal(kValue) << literal(kValue);
+		const std::string str = logLine.GetLogMessage();
+
+		EXPECT_EQ("012 012 012 012", str);
+	}
+	EXPECT_EQ(0u, g_allocations);
+
+	SetHeapBufferAllocator(nullptr, nullptr);
+}
+
+TEST(LogLine_Test, literal_EmbeddedNull_PrintUntilNull) {
+	static constexpr char kValue[8] = "Te\0st";
+	LogLine logLine = GetLogLine();
+	logLine << literal(kValue) << literal("Test");
+	const std::string str = logLine.GetLogMessage();
+
+	EXPECT_EQ("Te Test", str);
+}
+
+//
+// hexdump
+//
+
+TEST(LogLine_Test, hexdump_IsValue_PrintHex) {
+	LogLine logLine = GetLogLine("{} {:X} {:s} {:sX.2}");
+	{
+		const std::uint8_t arg[] = {0x01, 0xab, 0xff};
+		logLine << hexdump(arg, sizeof(arg)) << hexdump(arg, sizeof(arg)) << hexdump(arg, sizeof(arg)) << hexdump(arg, sizeof(arg));
+	}
+	const std::string str = logLine.GetLogMessage();
+
+	EXPECT_EQ("01abff 01ABFF 01 ab ff 01 AB...", str);
+}
+
+TEST(LogLine_Test, hexdump_IsLongValue_PrintHex) {
+	LogLine logLine = GetLogLine();
+	std::string expected;
+	{
+		std::uint8_t arg[300];
+		for (std::size_t i = 0; i < sizeof(arg); ++i) {
+			arg[i] = static_cast<std::uint8_t>(i * 7);
+			expected += fmt::format("{:02x}", arg[i]);
+		}
+		logLine << hexdump(arg, sizeof(arg));
+	}
+	const std::string str = logLine.GetLogMessage();
+
+	EXPECT_EQ(expected, str);
+}
+
+TEST(LogLine_Test, hexdump_WithOffsetAndAscii_PrintLines) {
+	LogLine logLine = GetLogLine("{:oa}\n{:o}");
+	{
+		const char arg[] = "Hello World!\n\x01 llamalog";
+		logLine << hexdump(arg, sizeof(arg) - 1) << hexdump(arg, 4);
+	}
+	const std::string str = logLine.GetLogMessage();
+
+	EXPECT_EQ("00000000  48 65 6c 6c 6f 20 57 6f  72 6c 64 21 0a 01 20 6c  |Hello World!.. l|\n"
+			  "00000010  6c 61 6d 61 6c 6f 67                              |lamalog|\n"
+			  "00000000  48 65 6c 6c",
+			  str);
+}
+
+TEST(LogLine_Test, hexdump_IsEmpty_PrintEmpty) {
+	LogLine logLine = GetLogLine("[{}]");
+	{
+		const std::uint8_t arg[] = {0x01};
+		logLine << hexdump(arg, 0);
+	}
+	const std::string str = logLine.GetLogMessage();
+
+	EXPECT_EQ("[]", str);
+}
+
+//
+// ranges
+//
+
+TEST(LogLine_Test, vector_IsValue_PrintValue) {
+	LogLine logLine = GetLogLine("{} {}");
+	{
+		const std::vector<int> arg = {1, -2, 3};
+		logLine << arg << escape(arg);
+	}
+	const std::string str = logLine.GetLogMessage();
+
+	EXPECT_EQ("[1, -2, 3] [1, -2, 3]", str);
+}
+
+TEST(LogLine_Test, vector_IsEmpty_PrintBrackets) {
+	LogLine logLine = GetLogLine();
+	{
+		const std::vector<double> arg;
+		logLine << arg;
+	}
+	const std::string str = logLine.GetLogMessage();
+
+	EXPECT_EQ("[]", str);
+}
+
+TEST(LogLine_Test, vector_IsValueWithCustomFormat_PrintValue) {
+	LogLine logLine = GetLogLine("{::.1f} {:n} {:n:+}");
+	{
+		const std::vector<double> arg = {1.26, 2.5};
+		logLine << arg << arg << arg;
+	}
+	const std::string str = logLine.GetLogMessage();
+
+	EXPECT_EQ("[1.3, 2.5] 1.26, 2.5 +1.26, +2.5", str);
+}
+
+TEST(LogLine_Test, array_IsValueWithCustomFormat_PrintValue) {
+	LogLine logLine = GetLogLine("{::02x}");
+	{
+		const std::array<std::uint8_t, 4> arg = {0x0a, 0xff, 0x01, 0x00};
+		logLine << arg;
+	}
+	const std::string str = logLine.GetLogMessage();
+
+	EXPECT_EQ("[0a, ff, 01, 00]", str);
+}
+
+TEST(LogLine_Test, vector_IsLongValue_AllocateOnce) {
+	SetHeapBufferAllocator(CountingAllocate, CountingDeallocate);
+	g_allocations = 0;
+	{
+		const std::vector<std::uint64_t> arg(1000, 7);
+		LogLine logLine = GetLogLine();
+		internal::AddArguments(logLine, arg);
+		const std::string str = logLine.GetLogMessage();
+
+		EXPECT_EQ("[7, 7,", str.substr(0, 6));
+		EXPECT_EQ(3000u, str.length());
+	}
+	EXPECT_EQ(1u, g_allocations);
+
+	SetHeapBufferAllocator(nullptr, nullptr);
+}
+
 //
 // std::align_val_t
 //
@@ -1325,6 +1641,91 @@ TEST(LogLine_Test, Multiple_ThreeArgumentsWithLong_PrintValues) {
 }
 
 
+//
+// Heap Buffer
+//
+
+TEST(LogLine_Test, HeapBuffer_LargeArguments_PrintValues) {
+	LogLine logLine = GetLogLine("{:.3} {:.3} {:.3} {}");
+	{
+		const std::string arg0 = std::string(1024, 'x');
+		const std::string arg1 = std::string(8192, 'y');
+		const std::string arg2 = std::string(65000, 'z');
+		logLine << arg0 << arg1 << arg2 << 7;
+	}
+	const std::string str = logLine.GetLogMessage();
+
+	EXPECT_EQ("xxx yyy zzz 7", str);
+}
+
+TEST(LogLine_Test, SetHeapBufferAllocator_Custom_ReuseBuffer) {
+	SetHeapBufferAllocator(CountingAllocate, CountingDeallocate);
+	g_allocations = 0;
+	g_deallocations = 0;
+	{
+		LogLine logLine = GetLogLine("{:.3}");
+		logLine << std::string(1000, 'x');
+
+		EXPECT_EQ("xxx", logLine.GetLogMessage());
+	}
+	EXPECT_EQ(1u, g_allocations);
+	EXPECT_EQ(0u, g_deallocations);
+	{
+		LogLine logLine = GetLogLine("{:.3}");
+		logLine << std::string(1000, 'y');
+
+		EXPECT_EQ("yyy", logLine.GetLogMessage());
+	}
+	EXPECT_EQ(1u, g_allocations);
+	EXPECT_EQ(0u, g_deallocations);
+
+	SetHeapBufferAllocator(nullptr, nullptr);
+	EXPECT_EQ(1u, g_deallocations);
+}
+
+TEST(LogLine_Test, SetHeapBufferAllocator_ChangedWhileInUse_ReleaseWithPrevious) {
+	SetHeapBufferAllocator(CountingAllocate, CountingDeallocate);
+	g_allocations = 0;
+	g_deallocations = 0;
+	{
+		LogLine logLine = GetLogLine("{:.3}");
+		logLine << std::string(1000, 'x');
+
+		SetHeapBufferAllocator(nullptr, nullptr);
+		EXPECT_EQ("xxx", logLine.GetLogMessage());
+	}
+	EXPECT_EQ(1u, g_allocations);
+	EXPECT_EQ(1u, g_deallocations);
+	{
+		LogLine logLine = GetLogLine("{:.3}");
+		logLine << std::string(1000, 'y');
+
+		EXPECT_EQ("yyy", logLine.GetLogMessage());
+	}
+	EXPECT_EQ(1u, g_allocations);
+	EXPECT_EQ(1u, g_deallocations);
+}
+
+TEST(LogLine_Test, AddArguments_LargeArguments_AllocateOnce) {
+	SetHeapBufferAllocator(CountingAllocate, CountingDeallocate);
+	g_allocations = 0;
+	{
+		LogLine logLine = GetLogLine("{:.3} {:.3} {:.3} {} {}");
+		{
+			const std::string arg0 = std::string(1000, 'x');
+			const std::wstring arg1 = std::wstring(2000, L'y');
+			const std::string arg2 = std::string(4000, 'z');
+			internal::AddArguments(logLine, arg0, arg1, arg2.c_str(), 7, static_cast<const char*>(nullptr));
+		}
+
+		EXPECT_EQ("xxx yyy zzz 7 (null)", logLine.GetLogMessage());
+	}
+	EXPECT_EQ(1u, g_allocations);
+
+	SetHeapBufferAllocator(nullptr, nullptr);
+}
+
+
 //
 // Copy and Move
 //
@@ -1388,6 +1789,48 @@ TEST(LogLine_Test, CopyMove_StackBufferWithNonTriviallyCopyable_IsSame) {
 	EXPECT_EQ("(7) (copy #5) (copy #3 move #2) Test", moveAssign.GetLogMessage());
 }
 
+TEST(LogLine_Test, CopyMove_StackBufferWithTriviallyRelocatable_MoveBytes) {
+	LogLine logLine = GetLogLine("{} {}");
+	{
+		const CustomTypeMove customMove;
+		const CustomTypeRelocatable customRelocatable;
+
+		logLine << customMove << customRelocatable;
+	}
+	EXPECT_EQ("(copy #1 move #0) (copy #1 move #0)", logLine.GetLogMessage());
+
+	LogLine move(std::move(logLine));  // move +1 for CustomTypeMove only
+
+	LogLine moveAssign(Priority::kError, "", 0, "", "");
+	moveAssign = std::move(move);  // move +1 for CustomTypeMove only
+
+	EXPECT_EQ("(copy #1 move #2) (copy #1 move #0)", moveAssign.GetLogMessage());
+}
+
+TEST(LogLine_Test, CopyMove_GrowBufferWithTriviallyRelocatable_MoveBytes) {
+	LogLine logLine = GetLogLine("{} {}");
+	const std::string arg(300, 'x');
+	{
+		const CustomTypeRelocatable customRelocatable;
+
+		logLine << customRelocatable << arg;
+	}
+	LogLine move(std::move(logLine));
+
+	EXPECT_EQ("(copy #1 move #0) " + arg, move.GetLogMessage());
+}
+
+TEST(LogLine_Test, CustomArgument_IsTemporary_Move) {
+	LogLine logLine = GetLogLine("{} {}");
+	{
+		const CustomTypeMove customMove;
+		logLine << customMove << CustomTypeMove();
+	}
+	const std::string str = logLine.GetLogMessage();
+
+	EXPECT_EQ("(copy #1 move #0) (copy #0 move #1)", str);
+}
+
 TEST(LogLine_Test, CopyMove_HeapBuffer_IsSame) {
 	LogLine logLine = GetLogLine(
 		"{} {} {} {} {} "
@@ -1652,4 +2095,48 @@ TEST(LogLine_Test, CopyMove_Exceptions_IsSame) {
 	EXPECT_EQ(str, moveAssign.GetLogMessage());
 }
 
+
+//
+// GetHash
+//
+
+TEST(LogLine_Test, GetHash_SameArguments_IsSame) {
+	const char* const pattern = "{} {} {}";
+	LogLine logLine = GetLogLine(pattern);
+	logLine << 7 << L"test" << CustomTypeTrivial(3);
+	LogLine other = GetLogLine(pattern);
+	other << 7 << L"test" << CustomTypeTrivial(3);
+
+	EXPECT_EQ(logLine.GetHash(), other.GetHash());
+}
+
+TEST(LogLine_Test, GetHash_DifferentArguments_IsDifferent) {
+	const char* const pattern = "{} {}";
+	LogLine logLine = GetLogLine(pattern);
+	logLine << 7 << "test";
+	LogLine other = GetLogLine(pattern);
+	other << 7 << "tesT";
+
+	EXPECT_NE(logLine.GetHash(), other.GetHash());
+}
+
+TEST(LogLine_Test, GetHash_DifferentPattern_IsDifferent) {
+	LogLine logLine = GetLogLine("{}");
+	logLine << 7;
+	LogLine other = GetLogLine("{} ");
+	other << 7;
+
+	EXPECT_NE(logLine.GetHash(), other.GetHash());
+}
+
+TEST(LogLine_Test, GetHash_HeapBuffer_IsSame) {
+	const char* const pattern = "{}";
+	LogLine logLine = GetLogLine(pattern);
+	logLine << std::string(1024, 'x');
+	LogLine other = GetLogLine(pattern);
+	other << std::string(1024, 'x');
+
+	EXPECT_EQ(logLine.GetHash(), other.GetHash());
+}
+
 }  // namespace llamalog::test
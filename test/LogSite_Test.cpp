@@ -0,0 +1,288 @@
+/*
+Copyright 2020 Michael Beckh
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "llamalog/LogSite.h"
+
+#include "llamalog/LogLine.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace llamalog::test {
+
+namespace {
+
+class LogSite_Test : public testing::Test {
+protected:
+	void TearDown() override {
+		ResetLogSites();
+	}
+};
+
+[[nodiscard]] bool IsRegistered(const LogSite& site) {
+	const std::vector<LogSite*> sites = GetLogSites();
+	return std::find(sites.cbegin(), sites.cend(), &site) != sites.cend();
+}
+
+}  // namespace
+
+//
+// IsEnabled
+//
+
+TEST_F(LogSite_Test, IsEnabled_FirstCall_RegisterAndEnabled) {
+	static LogSite site("site_first.cpp", 10, "First");
+
+	EXPECT_FALSE(IsRegistered(site));
+	EXPECT_TRUE(site.IsEnabled(Priority::kDebug));
+	EXPECT_TRUE(IsRegistered(site));
+	EXPECT_TRUE(site.IsEnabled(Priority::kDebug));
+}
+
+TEST_F(LogSite_Test, IsEnabled_SetEnabledFalse_Disabled) {
+	static LogSite site("site_set.cpp", 10, "Set");
+
+	site.SetEnabled(false);
+	EXPECT_TRUE(IsRegistered(site));
+	EXPECT_FALSE(site.IsEnabled(Priority::kDebug));
+
+	site.SetEnabled(true);
+	EXPECT_TRUE(site.IsEnabled(Priority::kDebug));
+}
+
+TEST_F(LogSite_Test, IsEnabled_Error_EnabledIfDisabled) {
+	static LogSite site("site_error.cpp", 10, "Error");
+
+	site.SetEnabled(false);
+	EXPECT_FALSE(site.IsEnabled(Priority::kWarn));
+	EXPECT_TRUE(site.IsEnabled(Priority::kError));
+	EXPECT_TRUE(site.IsEnabled(Priority::kFatal));
+}
+
+TEST_F(LogSite_Test, IsEnabled_WithFunction_SetFunctionOnFirstCall) {
+	static LogSite site("site_function.cpp", 10, nullptr);
+	EXPECT_STREQ("", site.GetFunction());
+
+	EXPECT_TRUE(site.IsEnabled(Priority::kDebug, "Caller"));
+	EXPECT_STREQ("Caller", site.GetFunction());
+
+	EXPECT_TRUE(site.IsEnabled(Priority::kDebug, "Other"));
+	EXPECT_STREQ("Caller", site.GetFunction());
+}
+
+TEST_F(LogSite_Test, IsEnabled_WithFunctionNotYetRegistered_ApplyRuleForFunction) {
+	static LogSite site("site_function_rule.cpp", 10, nullptr);
+
+	EXPECT_EQ(0u, SetLogSitesEnabled("", "FunctionRule", false));
+	EXPECT_FALSE(site.IsEnabled(Priority::kDebug, "FunctionRule"));
+	EXPECT_TRUE(IsRegistered(site));
+}
+
+
+//
+// SetLogSitesEnabled
+//
+
+TEST_F(LogSite_Test, SetLogSitesEnabled_ByFile_DisableMatching) {
+	static LogSite match("site_file.cpp", 10, "File");
+	static LogSite other("site_other.cpp", 10, "File");
+	ASSERT_TRUE(match.IsEnabled(Priority::kDebug));
+	ASSERT_TRUE(other.IsEnabled(Priority::kDebug));
+
+	EXPECT_EQ(1u, SetLogSitesEnabled("site_file.cpp", "", false));
+
+	EXPECT_FALSE(match.IsEnabled(Priority::kDebug));
+	EXPECT_TRUE(other.IsEnabled(Priority::kDebug));
+}
+
+TEST_F(LogSite_Test, SetLogSitesEnabled_ByFunction_DisableMatching) {
+	static LogSite match("site_function.cpp", 10, "MatchingFunction");
+	static LogSite other("site_function.cpp", 20, "OtherFunction");
+	ASSERT_TRUE(match.IsEnabled(Priority::kDebug));
+	ASSERT_TRUE(other.IsEnabled(Priority::kDebug));
+
+	EXPECT_EQ(1u, SetLogSitesEnabled("", "MatchingFunction", false));
+
+	EXPECT_FALSE(match.IsEnabled(Priority::kDebug));
+	EXPECT_TRUE(other.IsEnabled(Priority::kDebug));
+}
+
+TEST_F(LogSite_Test, SetLogSitesEnabled_ByGlob_DisableMatching) {
+	static LogSite match1("site_glob_a.cpp", 10, "Glob");
+	static LogSite match2("site_glob_bc.cpp", 10, "Glob");
+	static LogSite other("site_glob.h", 10, "Glob");
+	ASSERT_TRUE(match1.IsEnabled(Priority::kDebug));
+	ASSERT_TRUE(match2.IsEnabled(Priority::kDebug));
+	ASSERT_TRUE(other.IsEnabled(Priority::kDebug));
+
+	EXPECT_EQ(2u, SetLogSitesEnabled("site_glob_*.c?p", "G?o*", false));
+
+	EXPECT_FALSE(match1.IsEnabled(Priority::kDebug));
+	EXPECT_FALSE(match2.IsEnabled(Priority::kDebug));
+	EXPECT_TRUE(other.IsEnabled(Priority::kDebug));
+}
+
+TEST_F(LogSite_Test, SetLogSitesEnabled_NotYetRegistered_ApplyOnRegistration) {
+	static LogSite site("site_late.cpp", 10, "Late");
+
+	EXPECT_EQ(0u, SetLogSitesEnabled("site_late.cpp", "", false));
+	EXPECT_FALSE(site.IsEnabled(Priority::kDebug));
+	EXPECT_TRUE(IsRegistered(site));
+}
+
+TEST_F(LogSite_Test, SetLogSitesEnabled_MultipleRules_LastRuleWins) {
+	static LogSite site("site_rules.cpp", 10, "Rules");
+
+	SetLogSitesEnabled("site_rules.*", "", false);
+	SetLogSitesEnabled("", "Rules", true);
+	EXPECT_TRUE(site.IsEnabled(Priority::kDebug));
+}
+
+TEST_F(LogSite_Test, SetLogSitesEnabled_DisableAllEnableOne_LogErrorsOfOthers) {
+	static LogSite registered("site_all_registered.cpp", 10, "All");
+	static LogSite late("site_all_late.cpp", 10, "All");
+	static LogSite one("site_one.cpp", 10, "One");
+	ASSERT_TRUE(registered.IsEnabled(Priority::kDebug));
+
+	SetLogSitesEnabled("*", "", false);
+	SetLogSitesEnabled("site_one.cpp", "", true);
+
+	EXPECT_TRUE(one.IsEnabled(Priority::kDebug));
+	EXPECT_FALSE(registered.IsEnabled(Priority::kWarn));
+	EXPECT_TRUE(registered.IsEnabled(Priority::kError));
+	EXPECT_TRUE(late.IsEnabled(Priority::kFatal));
+	EXPECT_TRUE(IsRegistered(late));
+	EXPECT_FALSE(late.IsEnabled(Priority::kWarn));
+}
+
+
+//
+// Sampling
+//
+
+TEST_F(LogSite_Test, Sampling_EveryNth_LogFirstAndEveryNth) {
+	static LogSite site("site_nth.cpp", 10, "Nth", Sampling::EveryNth(3));
+
+	std::vector<bool> result;
+	for (int i = 0; i < 7; ++i) {
+		result.push_back(site.IsEnabled(Priority::kDebug));
+	}
+
+	EXPECT_THAT(result, testing::ElementsAre(true, false, false, true, false, false, true));
+	Priority priority = Priority::kNone;
+	EXPECT_EQ(4u, site.TakeSuppressed(priority));
+	EXPECT_EQ(Priority::kDebug, priority);
+	EXPECT_EQ(0u, site.TakeSuppressed(priority));
+}
+
+TEST_F(LogSite_Test, Sampling_PerSecond_LogBurst) {
+	static LogSite site("site_rate.cpp", 10, "Rate", Sampling::PerSecond(5));
+
+	int count = 0;
+	for (int i = 0; i < 100; ++i) {
+		count += site.IsEnabled(Priority::kInfo) ? 1 : 0;
+	}
+
+	// allow for one additional token being added during the loop
+	EXPECT_GE(count, 5);
+	EXPECT_LE(count, 6);
+	Priority priority = Priority::kNone;
+	EXPECT_EQ(100u - count, site.TakeSuppressed(priority));
+	EXPECT_EQ(Priority::kInfo, priority);
+}
+
+TEST_F(LogSite_Test, Sampling_ProbabilityZero_LogNothing) {
+	static LogSite site("site_never.cpp", 10, "Never", Sampling::Probability(0));
+
+	for (int i = 0; i < 100; ++i) {
+		EXPECT_FALSE(site.IsEnabled(Priority::kDebug));
+	}
+}
+
+TEST_F(LogSite_Test, Sampling_ProbabilityOne_LogEverything) {
+	static LogSite site("site_always.cpp", 10, "Always", Sampling::Probability(1));
+
+	for (int i = 0; i < 100; ++i) {
+		EXPECT_TRUE(site.IsEnabled(Priority::kDebug));
+	}
+}
+
+TEST_F(LogSite_Test, Sampling_ProbabilityHalf_LogSome) {
+	static LogSite site("site_half.cpp", 10, "Half", Sampling::Probability(0.5));
+
+	int count = 0;
+	for (int i = 0; i < 1000; ++i) {
+		count += site.IsEnabled(Priority::kDebug) ? 1 : 0;
+	}
+
+	EXPECT_GT(count, 350);
+	EXPECT_LT(count, 650);
+}
+
+TEST_F(LogSite_Test, SetLogSitesSampling_ByFunction_LimitMatching) {
+	static LogSite site("site_sampling.cpp", 10, "Sampling");
+	ASSERT_TRUE(site.IsEnabled(Priority::kDebug));
+
+	EXPECT_EQ(1u, SetLogSitesSampling("", "Sampling", Sampling::EveryNth(2)));
+
+	EXPECT_TRUE(site.IsEnabled(Priority::kDebug));
+	EXPECT_FALSE(site.IsEnabled(Priority::kDebug));
+	EXPECT_TRUE(site.IsEnabled(Priority::kDebug));
+
+	ResetLogSites();
+	EXPECT_TRUE(site.IsEnabled(Priority::kDebug));
+	EXPECT_TRUE(site.IsEnabled(Priority::kDebug));
+}
+
+TEST_F(LogSite_Test, SetLogSitesSampling_Disabled_RemainDisabled) {
+	static LogSite site("site_sampling_disabled.cpp", 10, "SamplingDisabled");
+	site.SetEnabled(false);
+
+	SetLogSitesSampling("site_sampling_disabled.cpp", "", Sampling::EveryNth(2));
+
+	EXPECT_FALSE(site.IsEnabled(Priority::kDebug));
+}
+
+TEST_F(LogSite_Test, SetLogSitesSampling_Error_LogEverything) {
+	static LogSite site("site_sampling_error.cpp", 10, "SamplingError");
+
+	SetLogSitesSampling("site_sampling_error.cpp", "", Sampling::EveryNth(0));
+
+	EXPECT_FALSE(site.IsEnabled(Priority::kWarn));
+	EXPECT_TRUE(site.IsEnabled(Priority::kError));
+	EXPECT_TRUE(site.IsEnabled(Priority::kError));
+}
+
+
+//
+// ResetLogSites
+//
+
+TEST_F(LogSite_Test, ResetLogSites_Disabled_EnableAll) {
+	static LogSite site("site_reset.cpp", 10, "Reset");
+	ASSERT_TRUE(site.IsEnabled(Priority::kDebug));
+	SetLogSitesEnabled("site_reset.cpp", "", false);
+	ASSERT_FALSE(site.IsEnabled(Priority::kDebug));
+
+	ResetLogSites();
+
+	EXPECT_TRUE(site.IsEnabled(Priority::kDebug));
+}
+
+}  // namespace llamalog::test
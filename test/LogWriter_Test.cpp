@@ -26,13 +26,18 @@ limitations under the License.
 #include <detours_gmock.h>
 #include <windows.h>
 
+#include <chrono>
 #include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <future>
 #include <memory>
 #include <regex>
 #include <sstream>
 #include <string>
 #include <string_view>
 #include <utility>
+#include <vector>
 
 namespace llamalog::test {
 
@@ -46,6 +51,10 @@ MATCHER_P(MatchesRegex, pattern, "") {
 }
 
 #define WIN32_FUNCTIONS(fn_)                                                                                                                                                                       \
+	fn_(1, void, WINAPI, GetSystemTimeAsFileTime,                                                                                                                                                  \
+		(LPFILETIME lpSystemTimeAsFileTime),                                                                                                                                                       \
+		(lpSystemTimeAsFileTime),                                                                                                                                                                  \
+		nullptr);                                                                                                                                                                                  \
 	fn_(2, BOOL, WINAPI, FileTimeToSystemTime,                                                                                                                                                     \
 		(const FILETIME* lpFileTime, LPSYSTEMTIME lpSystemTime),                                                                                                                                   \
 		(lpFileTime, lpSystemTime),                                                                                                                                                                \
@@ -58,10 +67,50 @@ MATCHER_P(MatchesRegex, pattern, "") {
 		(HANDLE hFile, LPCVOID lpBuffer, DWORD nNumberOfBytesToWrite, LPDWORD lpNumberOfBytesWritten, LPOVERLAPPED lpOverlapped),                                                                  \
 		(hFile, lpBuffer, nNumberOfBytesToWrite, lpNumberOfBytesWritten, lpOverlapped),                                                                                                            \
 		nullptr);                                                                                                                                                                                  \
+	fn_(5, BOOL, WINAPI, ReadFile,                                                                                                                                                                 \
+		(HANDLE hFile, LPVOID lpBuffer, DWORD nNumberOfBytesToRead, LPDWORD lpNumberOfBytesRead, LPOVERLAPPED lpOverlapped),                                                                       \
+		(hFile, lpBuffer, nNumberOfBytesToRead, lpNumberOfBytesRead, lpOverlapped),                                                                                                                \
+		nullptr);                                                                                                                                                                                  \
+	fn_(4, BOOL, WINAPI, GetOverlappedResult,                                                                                                                                                      \
+		(HANDLE hFile, LPOVERLAPPED lpOverlapped, LPDWORD lpNumberOfBytesTransferred, BOOL bWait),                                                                                                 \
+		(hFile, lpOverlapped, lpNumberOfBytesTransferred, bWait),                                                                                                                                  \
+		nullptr);                                                                                                                                                                                  \
 	fn_(1, BOOL, WINAPI, CloseHandle,                                                                                                                                                              \
 		(HANDLE hObject),                                                                                                                                                                          \
 		(hObject),                                                                                                                                                                                 \
 		nullptr);                                                                                                                                                                                  \
+	fn_(2, BOOL, WINAPI, GetFileSizeEx,                                                                                                                                                            \
+		(HANDLE hFile, PLARGE_INTEGER lpFileSize),                                                                                                                                                 \
+		(hFile, lpFileSize),                                                                                                                                                                       \
+		nullptr);                                                                                                                                                                                  \
+	fn_(8, BOOL, WINAPI, DeviceIoControl,                                                                                                                                                          \
+		(HANDLE hDevice, DWORD dwIoControlCode, LPVOID lpInBuffer, DWORD nInBufferSize, LPVOID lpOutBuffer, DWORD nOutBufferSize, LPDWORD lpBytesReturned, LPOVERLAPPED lpOverlapped),             \
+		(hDevice, dwIoControlCode, lpInBuffer, nInBufferSize, lpOutBuffer, nOutBufferSize, lpBytesReturned, lpOverlapped),                                                                         \
+		nullptr);                                                                                                                                                                                  \
+	fn_(4, BOOL, WINAPI, SetFilePointerEx,                                                                                                                                                         \
+		(HANDLE hFile, LARGE_INTEGER liDistanceToMove, PLARGE_INTEGER lpNewFilePointer, DWORD dwMoveMethod),                                                                                       \
+		(hFile, liDistanceToMove, lpNewFilePointer, dwMoveMethod),                                                                                                                                 \
+		nullptr);                                                                                                                                                                                  \
+	fn_(4, BOOL, WINAPI, SetFileInformationByHandle,                                                                                                                                               \
+		(HANDLE hFile, FILE_INFO_BY_HANDLE_CLASS FileInformationClass, LPVOID lpFileInformation, DWORD dwBufferSize),                                                                              \
+		(hFile, FileInformationClass, lpFileInformation, dwBufferSize),                                                                                                                            \
+		nullptr);                                                                                                                                                                                  \
+	fn_(6, HANDLE, WINAPI, CreateFileMappingW,                                                                                                                                                     \
+		(HANDLE hFile, LPSECURITY_ATTRIBUTES lpFileMappingAttributes, DWORD flProtect, DWORD dwMaximumSizeHigh, DWORD dwMaximumSizeLow, LPCWSTR lpName),                                           \
+		(hFile, lpFileMappingAttributes, flProtect, dwMaximumSizeHigh, dwMaximumSizeLow, lpName),                                                                                                  \
+		nullptr);                                                                                                                                                                                  \
+	fn_(5, LPVOID, WINAPI, MapViewOfFile,                                                                                                                                                          \
+		(HANDLE hFileMappingObject, DWORD dwDesiredAccess, DWORD dwFileOffsetHigh, DWORD dwFileOffsetLow, SIZE_T dwNumberOfBytesToMap),                                                            \
+		(hFileMappingObject, dwDesiredAccess, dwFileOffsetHigh, dwFileOffsetLow, dwNumberOfBytesToMap),                                                                                            \
+		nullptr);                                                                                                                                                                                  \
+	fn_(1, BOOL, WINAPI, UnmapViewOfFile,                                                                                                                                                          \
+		(LPCVOID lpBaseAddress),                                                                                                                                                                   \
+		(lpBaseAddress),                                                                                                                                                                           \
+		nullptr);                                                                                                                                                                                  \
+	fn_(1, BOOL, WINAPI, FlushFileBuffers,                                                                                                                                                         \
+		(HANDLE hFile),                                                                                                                                                                            \
+		(hFile),                                                                                                                                                                                   \
+		nullptr);                                                                                                                                                                                  \
 	fn_(1, BOOL, WINAPI, DeleteFileW,                                                                                                                                                              \
 		(LPCWSTR lpFileName),                                                                                                                                                                      \
 		(lpFileName),                                                                                                                                                                              \
@@ -342,8 +391,9 @@ TEST_F(LogWriter_Test, CreateFile_TemporaryErrorDuringRollFile_LogError) {
 		.Times(1);  // one log event is lost when CreateFileW fails
 	EXPECT_CALL(m_mock, CloseHandle(m_hFile));
 
+	// search only after the file has been created
 	EXPECT_CALL(m_mock, FindFirstFileExW(t::StrEq(L"X:\\testing\\logs\\ll_test.????????.log"), DTGM_ARG5))
-		.Times(2);
+		.Times(1);
 
 	std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
 	std::unique_ptr<llamalog::RollingFileWriter> fileWriter = std::make_unique<llamalog::RollingFileWriter>(Priority::kDebug, "X:\\testing\\logs\\", "ll_test.log", llamalog::RollingFileWriter::Frequency::kDaily, 3u);
@@ -361,8 +411,8 @@ TEST_F(LogWriter_Test, CreateFile_PermanentErrorDuringRollFile_LogError) {
 	EXPECT_CALL(m_mock, CreateFileW(MatchesRegex(L"X:\\\\testing\\\\logs\\\\ll_test\\.2[0-9]{3}[01][0-9][0-3][0-9]\\.log"), DTGM_ARG6))
 		.WillRepeatedly(detours_gmock::SetLastErrorAndReturn(ERROR_FILE_EXISTS, INVALID_HANDLE_VALUE));
 
-	EXPECT_CALL(m_mock, FindFirstFileExW(t::StrEq(L"X:\\testing\\logs\\ll_test.????????.log"), DTGM_ARG5))
-		.Times(3);
+	EXPECT_CALL(m_mock, FindFirstFileExW(DTGM_ARG6))
+		.Times(0);
 
 	std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
 	std::unique_ptr<llamalog::RollingFileWriter> fileWriter = std::make_unique<llamalog::RollingFileWriter>(Priority::kDebug, "X:\\testing\\logs\\", "ll_test.log", llamalog::RollingFileWriter::Frequency::kDaily, 3u);
@@ -493,8 +543,9 @@ TEST_F(LogWriter_Test, CloseHandle_ErrorDuringRollFile_LogError) {
 		.WillOnce(detours_gmock::SetLastErrorAndReturn(ERROR_NOT_SUPPORTED, FALSE))
 		.WillRepeatedly(t::DoDefault());
 
+	// search only once
 	EXPECT_CALL(m_mock, FindFirstFileExW(t::StrEq(L"X:\\testing\\logs\\ll_test.????????_??????.log"), DTGM_ARG5))
-		.Times(t::Between(2, 3));
+		.Times(1);
 
 	std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
 	std::unique_ptr<llamalog::RollingFileWriter> fileWriter = std::make_unique<llamalog::RollingFileWriter>(Priority::kDebug, "X:\\testing\\logs\\", "ll_test.log", llamalog::RollingFileWriter::Frequency::kEverySecond, 3u);
@@ -511,13 +562,20 @@ TEST_F(LogWriter_Test, CloseHandle_ErrorDuringRollFile_LogError) {
 }
 
 TEST_F(LogWriter_Test, FindFirstFileEx_ErrorDuringRollFile_LogError) {
+	// the search runs in the background while the logger writes the first line
+	t::Sequence write;
+	t::Sequence search;
 	EXPECT_CALL(m_mock, CreateFileW(MatchesRegex(L"X:\\\\testing\\\\logs\\\\ll_test\\.2[0-9]{3}[01][0-9][0-3][0-9]\\.log"), DTGM_ARG6))
+		.InSequence(write, search)
 		.WillOnce(t::Return(m_hFile));
 	EXPECT_CALL(m_mock, WriteFile(m_hFile, DTGM_ARG4))
-		.Times(2);
-	EXPECT_CALL(m_mock, CloseHandle(m_hFile));
+		.Times(2)
+		.InSequence(write);
+	EXPECT_CALL(m_mock, CloseHandle(m_hFile))
+		.InSequence(write);
 
 	EXPECT_CALL(m_mock, FindFirstFileExW(t::StrEq(L"X:\\testing\\logs\\ll_test.????????.log"), DTGM_ARG5))
+		.InSequence(search)
 		.WillOnce(detours_gmock::SetLastErrorAndReturn(ERROR_INVALID_PARAMETER, INVALID_HANDLE_VALUE));
 	EXPECT_CALL(m_mock, FindNextFileW(DTGM_ARG2))
 		.Times(0);
@@ -535,24 +593,33 @@ TEST_F(LogWriter_Test, FindFirstFileEx_ErrorDuringRollFile_LogError) {
 	llamalog::Shutdown();
 
 	EXPECT_EQ(2, m_lines);
-	EXPECT_THAT(m_out.str(), MatchesRegex("[^\\n]+\\n[0-9:. -]{23} WARN [^\\n]* RollFile Error deleting log: [^\\n]+ \\(87\\)\\n"));
+	EXPECT_THAT(m_out.str(), MatchesRegex("[^\\n]+\\n[0-9:. -]{23} WARN [^\\n]* DeleteOldFiles Error deleting log: [^\\n]+ \\(87\\)\\n"));
 }
 
 TEST_F(LogWriter_Test, FindNextFileW_ErrorDuringRollFile_LogError) {
+	// the search runs in the background while the logger writes the first line
+	t::Sequence write;
+	t::Sequence search;
 	EXPECT_CALL(m_mock, CreateFileW(MatchesRegex(L"X:\\\\testing\\\\logs\\\\ll_test\\.2[0-9]{3}[01][0-9][0-3][0-9]\\.log"), DTGM_ARG6))
+		.InSequence(write, search)
 		.WillOnce(t::Return(m_hFile));
 	EXPECT_CALL(m_mock, WriteFile(m_hFile, DTGM_ARG4))
-		.Times(2);
-	EXPECT_CALL(m_mock, CloseHandle(m_hFile));
+		.Times(2)
+		.InSequence(write);
+	EXPECT_CALL(m_mock, CloseHandle(m_hFile))
+		.InSequence(write);
 
 	EXPECT_CALL(m_mock, FindFirstFileExW(t::StrEq(L"X:\\testing\\logs\\ll_test.????????.log"), DTGM_ARG5))
+		.InSequence(search)
 		.WillOnce(t::Invoke([this](t::Unused, t::Unused, LPVOID lpFindFileData, t::Unused, t::Unused, t::Unused) {
 			wcscpy_s(((WIN32_FIND_DATAW*) lpFindFileData)->cFileName, L"ll_test.2019-01-05.log");
 			return m_hFind;
 		}));
 	EXPECT_CALL(m_mock, FindNextFileW(m_hFind, DTGM_ARG1))
+		.InSequence(search)
 		.WillOnce(detours_gmock::SetLastErrorAndReturn(ERROR_INVALID_PARAMETER, FALSE));
-	EXPECT_CALL(m_mock, FindClose(m_hFind));
+	EXPECT_CALL(m_mock, FindClose(m_hFind))
+		.InSequence(search);
 
 	EXPECT_CALL(m_mock, DeleteFileW(DTGM_ARG1))
 		.Times(0);
@@ -565,27 +632,37 @@ TEST_F(LogWriter_Test, FindNextFileW_ErrorDuringRollFile_LogError) {
 	llamalog::Shutdown();
 
 	EXPECT_EQ(2, m_lines);
-	EXPECT_THAT(m_out.str(), MatchesRegex("[^\\n]+\\n[0-9:. -]{23} WARN [^\\n]* RollFile Error deleting log: [^\\n]+ \\(87\\)\\n"));
+	EXPECT_THAT(m_out.str(), MatchesRegex("[^\\n]+\\n[0-9:. -]{23} WARN [^\\n]* DeleteOldFiles Error deleting log: [^\\n]+ \\(87\\)\\n"));
 }
 
 TEST_F(LogWriter_Test, FindClose_ErrorDuringRollFile_LogError) {
+	// the search runs in the background while the logger writes the first line
+	t::Sequence write;
+	t::Sequence search;
 	EXPECT_CALL(m_mock, CreateFileW(MatchesRegex(L"X:\\\\testing\\\\logs\\\\ll_test\\.2[0-9]{3}[01][0-9][0-3][0-9]\\.log"), DTGM_ARG6))
+		.InSequence(write, search)
 		.WillOnce(t::Return(m_hFile));
 	EXPECT_CALL(m_mock, WriteFile(m_hFile, DTGM_ARG4))
-		.Times(2);
-	EXPECT_CALL(m_mock, CloseHandle(m_hFile));
+		.Times(2)
+		.InSequence(write);
+	EXPECT_CALL(m_mock, CloseHandle(m_hFile))
+		.InSequence(write);
 
 	EXPECT_CALL(m_mock, FindFirstFileExW(t::StrEq(L"X:\\testing\\logs\\ll_test.????????.log"), DTGM_ARG5))
+		.InSequence(search)
 		.WillOnce(t::Invoke([this](t::Unused, t::Unused, LPVOID lpFindFileData, t::Unused, t::Unused, t::Unused) {
 			wcscpy_s(((WIN32_FIND_DATAW*) lpFindFileData)->cFileName, L"ll_test.2019-01-05.log");
 			return m_hFind;
 		}));
-	EXPECT_CALL(m_mock, FindNextFileW(m_hFind, DTGM_ARG1));
+	EXPECT_CALL(m_mock, FindNextFileW(m_hFind, DTGM_ARG1))
+		.InSequence(search);
 	EXPECT_CALL(m_mock, FindClose(m_hFind))
+		.InSequence(search)
 		.WillOnce(detours_gmock::SetLastErrorAndReturn(ERROR_INVALID_HANDLE, FALSE));
 
 	EXPECT_CALL(m_mock, DeleteFileW(t::StrEq(L"X:\\testing\\logs\\ll_test.2019-01-05.log")))
-		.Times(1);
+		.Times(1)
+		.InSequence(search);
 
 	std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
 	std::unique_ptr<llamalog::RollingFileWriter> fileWriter = std::make_unique<llamalog::RollingFileWriter>(Priority::kDebug, "X:\\testing\\logs\\", "ll_test.log", llamalog::RollingFileWriter::Frequency::kDaily, 0u);
@@ -595,32 +672,44 @@ TEST_F(LogWriter_Test, FindClose_ErrorDuringRollFile_LogError) {
 	llamalog::Shutdown();
 
 	EXPECT_EQ(2, m_lines);
-	EXPECT_THAT(m_out.str(), MatchesRegex("[^\\n]+\\n[0-9:. -]{23} WARN [^\\n]* RollFile Error deleting log: [^\\n]+ \\(6\\)\\n"));
+	EXPECT_THAT(m_out.str(), MatchesRegex("[^\\n]+\\n[0-9:. -]{23} WARN [^\\n]* DeleteOldFiles Error deleting log: [^\\n]+ \\(6\\)\\n"));
 }
 
 TEST_F(LogWriter_Test, DeleteFileW_ErrorDuringRollFile_LogError) {
+	// the search runs in the background while the logger writes the first line
+	t::Sequence write;
+	t::Sequence search;
 	EXPECT_CALL(m_mock, CreateFileW(MatchesRegex(L"X:\\\\testing\\\\logs\\\\ll_test\\.2[0-9]{3}[01][0-9][0-3][0-9]\\.log"), DTGM_ARG6))
+		.InSequence(write, search)
 		.WillOnce(t::Return(m_hFile));
 	EXPECT_CALL(m_mock, WriteFile(m_hFile, DTGM_ARG4))
-		.Times(2);
-	EXPECT_CALL(m_mock, CloseHandle(m_hFile));
+		.Times(2)
+		.InSequence(write);
+	EXPECT_CALL(m_mock, CloseHandle(m_hFile))
+		.InSequence(write);
 
 	EXPECT_CALL(m_mock, FindFirstFileExW(t::StrEq(L"X:\\testing\\logs\\ll_test.????????.log"), DTGM_ARG5))
+		.InSequence(search)
 		.WillOnce(t::Invoke([this](t::Unused, t::Unused, LPVOID lpFindFileData, t::Unused, t::Unused, t::Unused) {
 			wcscpy_s(((WIN32_FIND_DATAW*) lpFindFileData)->cFileName, L"ll_test.2019-01-05.log");
 			return m_hFind;
 		}));
 	EXPECT_CALL(m_mock, FindNextFileW(m_hFind, DTGM_ARG1))
+		.InSequence(search)
 		.WillOnce(t::Invoke([](t::Unused, LPVOID lpFindFileData) {
 			wcscpy_s(((WIN32_FIND_DATAW*) lpFindFileData)->cFileName, L"ll_test.2019-01-03.log");
 			return TRUE;
 		}))
 		.WillOnce(t::DoDefault());
-	EXPECT_CALL(m_mock, FindClose(m_hFind));
+	EXPECT_CALL(m_mock, FindClose(m_hFind))
+		.InSequence(search);
 
+	// files are deleted oldest first
+	EXPECT_CALL(m_mock, DeleteFileW(t::StrEq(L"X:\\testing\\logs\\ll_test.2019-01-03.log")))
+		.InSequence(search);
 	EXPECT_CALL(m_mock, DeleteFileW(t::StrEq(L"X:\\testing\\logs\\ll_test.2019-01-05.log")))
+		.InSequence(search)
 		.WillOnce(detours_gmock::SetLastErrorAndReturn(ERROR_FILE_NOT_FOUND, FALSE));
-	EXPECT_CALL(m_mock, DeleteFileW(t::StrEq(L"X:\\testing\\logs\\ll_test.2019-01-03.log")));
 
 	std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
 	std::unique_ptr<llamalog::RollingFileWriter> fileWriter = std::make_unique<llamalog::RollingFileWriter>(Priority::kDebug, "X:\\testing\\logs\\", "ll_test.log", llamalog::RollingFileWriter::Frequency::kDaily, 0u);
@@ -630,7 +719,691 @@ TEST_F(LogWriter_Test, DeleteFileW_ErrorDuringRollFile_LogError) {
 	llamalog::Shutdown();
 
 	EXPECT_EQ(2, m_lines);
-	EXPECT_THAT(m_out.str(), MatchesRegex("[^\\n]+\\n[0-9:. -]{23} WARN [^\\n]* RollFile Error deleting log 'll_test.2019-01-05.log': [^\\n]+ \\(2\\)\\n"));
+	EXPECT_THAT(m_out.str(), MatchesRegex("[^\\n]+\\n[0-9:. -]{23} WARN [^\\n]* DeleteOldFiles Error deleting log 'll_test.2019-01-05.log': [^\\n]+ \\(2\\)\\n"));
+}
+
+TEST_F(LogWriter_Test, DeleteFileW_ErrorWithoutDefaultLogger_LogErrorToOwner) {
+	t::Sequence write;
+	t::Sequence search;
+	EXPECT_CALL(m_mock, CreateFileW(MatchesRegex(L"X:\\\\testing\\\\logs\\\\ll_test\\.2[0-9]{3}[01][0-9][0-3][0-9]\\.log"), DTGM_ARG6))
+		.InSequence(write, search)
+		.WillOnce(t::Return(m_hFile));
+	EXPECT_CALL(m_mock, WriteFile(m_hFile, DTGM_ARG4))
+		.Times(2)
+		.InSequence(write);
+	EXPECT_CALL(m_mock, CloseHandle(m_hFile))
+		.InSequence(write);
+
+	EXPECT_CALL(m_mock, FindFirstFileExW(t::StrEq(L"X:\\testing\\logs\\ll_test.????????.log"), DTGM_ARG5))
+		.InSequence(search)
+		.WillOnce(t::Invoke([this](t::Unused, t::Unused, LPVOID lpFindFileData, t::Unused, t::Unused, t::Unused) {
+			wcscpy_s(((WIN32_FIND_DATAW*) lpFindFileData)->cFileName, L"ll_test.2019-01-05.log");
+			return m_hFind;
+		}));
+	EXPECT_CALL(m_mock, FindNextFileW(m_hFind, DTGM_ARG1))
+		.InSequence(search);
+	EXPECT_CALL(m_mock, FindClose(m_hFind))
+		.InSequence(search);
+	EXPECT_CALL(m_mock, DeleteFileW(t::StrEq(L"X:\\testing\\logs\\ll_test.2019-01-05.log")))
+		.InSequence(search)
+		.WillOnce(detours_gmock::SetLastErrorAndReturn(ERROR_ACCESS_DENIED, FALSE));
+
+	{
+		// the warning of the background thread is sent to the logger owning the writer
+		Logger logger(std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines),
+					  std::make_unique<llamalog::RollingFileWriter>(Priority::kDebug, "X:\\testing\\logs\\", "ll_test.log", llamalog::RollingFileWriter::Frequency::kDaily, 0u));
+
+		llamalog::Log(logger, Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+	}
+
+	EXPECT_FALSE(llamalog::IsInitialized());
+	EXPECT_EQ(2, m_lines);
+	EXPECT_THAT(m_out.str(), MatchesRegex("[^\\n]+\\n[0-9:. -]{23} WARN [^\\n]* DeleteOldFiles Error deleting log 'll_test.2019-01-05.log': [^\\n]+ \\(5\\)\\n"));
+}
+
+TEST_F(LogWriter_Test, Log_MaxFileSizeReached_CreateNextFile) {
+	EXPECT_CALL(m_mock, CreateFileW(MatchesRegex(L"X:\\\\testing\\\\logs\\\\ll_test\\.2[0-9]{3}[01][0-9][0-3][0-9]\\.log"), DTGM_ARG6))
+		.WillOnce(t::Return(m_hFile));
+	EXPECT_CALL(m_mock, CreateFileW(MatchesRegex(L"X:\\\\testing\\\\logs\\\\ll_test\\.2[0-9]{3}[01][0-9][0-3][0-9]_001\\.log"), DTGM_ARG6))
+		.WillOnce(t::Return(m_hFile));
+	EXPECT_CALL(m_mock, GetFileSizeEx(m_hFile, DTGM_ARG1))
+		.Times(2)
+		.WillRepeatedly(t::Invoke([](t::Unused, PLARGE_INTEGER lpFileSize) {
+			lpFileSize->QuadPart = 0;
+			return TRUE;
+		}));
+	EXPECT_CALL(m_mock, WriteFile(m_hFile, DTGM_ARG4))
+		.Times(2);
+	EXPECT_CALL(m_mock, CloseHandle(m_hFile))
+		.Times(2);
+
+	EXPECT_CALL(m_mock, FindFirstFileExW(t::StrEq(L"X:\\testing\\logs\\ll_test.????????.log"), DTGM_ARG5));
+	EXPECT_CALL(m_mock, FindFirstFileExW(t::StrEq(L"X:\\testing\\logs\\ll_test.????????_???.log"), DTGM_ARG5));
+
+	std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
+	std::unique_ptr<llamalog::RollingFileWriter> fileWriter = std::make_unique<llamalog::RollingFileWriter>(Priority::kDebug, "X:\\testing\\logs\\", "ll_test.log", llamalog::RollingFileWriter::Frequency::kDaily, 3u);
+	fileWriter->SetMaxFileSize(10);
+	llamalog::Initialize(std::move(writer), std::move(fileWriter));
+
+	llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+	llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+	llamalog::Shutdown();
+
+	EXPECT_EQ(2, m_lines);
+}
+
+TEST_F(LogWriter_Test, Log_MaxFilesReachedAfterRollFile_DeleteWithoutSearch) {
+	EXPECT_CALL(m_mock, CreateFileW(MatchesRegex(L"X:\\\\testing\\\\logs\\\\ll_test\\.2[0-9]{3}[01][0-9][0-3][0-9]\\.log"), DTGM_ARG6))
+		.WillOnce(t::Return(m_hFile));
+	EXPECT_CALL(m_mock, CreateFileW(MatchesRegex(L"X:\\\\testing\\\\logs\\\\ll_test\\.2[0-9]{3}[01][0-9][0-3][0-9]_001\\.log"), DTGM_ARG6))
+		.WillOnce(t::Return(m_hFile));
+	EXPECT_CALL(m_mock, GetFileSizeEx(m_hFile, DTGM_ARG1))
+		.Times(2)
+		.WillRepeatedly(t::Invoke([](t::Unused, PLARGE_INTEGER lpFileSize) {
+			lpFileSize->QuadPart = 0;
+			return TRUE;
+		}));
+	EXPECT_CALL(m_mock, WriteFile(m_hFile, DTGM_ARG4))
+		.Times(2);
+	EXPECT_CALL(m_mock, CloseHandle(m_hFile))
+		.Times(2);
+
+	// search only once after the first roll over, i.e. each pattern once
+	EXPECT_CALL(m_mock, FindFirstFileExW(t::StrEq(L"X:\\testing\\logs\\ll_test.????????.log"), DTGM_ARG5));
+	EXPECT_CALL(m_mock, FindFirstFileExW(t::StrEq(L"X:\\testing\\logs\\ll_test.????????_???.log"), DTGM_ARG5));
+
+	EXPECT_CALL(m_mock, DeleteFileW(MatchesRegex(L"X:\\\\testing\\\\logs\\\\ll_test\\.2[0-9]{3}[01][0-9][0-3][0-9]\\.log")));
+
+	std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
+	std::unique_ptr<llamalog::RollingFileWriter> fileWriter = std::make_unique<llamalog::RollingFileWriter>(Priority::kDebug, "X:\\testing\\logs\\", "ll_test.log", llamalog::RollingFileWriter::Frequency::kDaily, 0u);
+	fileWriter->SetMaxFileSize(10);
+	llamalog::Initialize(std::move(writer), std::move(fileWriter));
+
+	llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+	llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+	llamalog::Shutdown();
+
+	EXPECT_EQ(2, m_lines);
+}
+
+TEST_F(LogWriter_Test, Log_ExistingFileFull_OpenNextFile) {
+	EXPECT_CALL(m_mock, CreateFileW(MatchesRegex(L"X:\\\\testing\\\\logs\\\\ll_test\\.2[0-9]{3}[01][0-9][0-3][0-9]\\.log"), DTGM_ARG6))
+		.WillOnce(t::Return(m_hFile));
+	EXPECT_CALL(m_mock, CreateFileW(MatchesRegex(L"X:\\\\testing\\\\logs\\\\ll_test\\.2[0-9]{3}[01][0-9][0-3][0-9]_001\\.log"), DTGM_ARG6))
+		.WillOnce(t::Return(m_hFile));
+	EXPECT_CALL(m_mock, GetFileSizeEx(m_hFile, DTGM_ARG1))
+		.WillOnce(t::Invoke([](t::Unused, PLARGE_INTEGER lpFileSize) {
+			lpFileSize->QuadPart = 100;
+			return TRUE;
+		}))
+		.WillOnce(t::Invoke([](t::Unused, PLARGE_INTEGER lpFileSize) {
+			lpFileSize->QuadPart = 0;
+			return TRUE;
+		}));
+	EXPECT_CALL(m_mock, WriteFile(m_hFile, DTGM_ARG4));
+	EXPECT_CALL(m_mock, CloseHandle(m_hFile))
+		.Times(2);
+
+	EXPECT_CALL(m_mock, FindFirstFileExW(DTGM_ARG6))
+		.Times(2);
+
+	std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
+	std::unique_ptr<llamalog::RollingFileWriter> fileWriter = std::make_unique<llamalog::RollingFileWriter>(Priority::kDebug, "X:\\testing\\logs\\", "ll_test.log", llamalog::RollingFileWriter::Frequency::kDaily, 3u);
+	fileWriter->SetMaxFileSize(100);
+	llamalog::Initialize(std::move(writer), std::move(fileWriter));
+
+	llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+	llamalog::Shutdown();
+
+	EXPECT_EQ(1, m_lines);
+}
+
+TEST_F(LogWriter_Test, Log_MaxFileIndexReached_AppendToLastFile) {
+	// all files of the period up to the last index already exist and are full
+	EXPECT_CALL(m_mock, CreateFileW(MatchesRegex(L"X:\\\\testing\\\\logs\\\\ll_test\\.2[0-9]{3}[01][0-9][0-3][0-9](_[0-9]{3})?\\.log"), DTGM_ARG6))
+		.Times(1000)
+		.WillRepeatedly(t::Return(m_hFile));
+	EXPECT_CALL(m_mock, GetFileSizeEx(m_hFile, DTGM_ARG1))
+		.Times(1000)
+		.WillRepeatedly(t::Invoke([](t::Unused, PLARGE_INTEGER lpFileSize) {
+			lpFileSize->QuadPart = 100;
+			return TRUE;
+		}));
+	// no further roll over for lines exceeding the limit
+	EXPECT_CALL(m_mock, WriteFile(m_hFile, DTGM_ARG4))
+		.Times(2);
+	EXPECT_CALL(m_mock, CloseHandle(m_hFile))
+		.Times(1000);
+
+	EXPECT_CALL(m_mock, FindFirstFileExW(DTGM_ARG6))
+		.Times(2);
+
+	std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
+	std::unique_ptr<llamalog::RollingFileWriter> fileWriter = std::make_unique<llamalog::RollingFileWriter>(Priority::kDebug, "X:\\testing\\logs\\", "ll_test.log", llamalog::RollingFileWriter::Frequency::kDaily, 3u);
+	fileWriter->SetMaxFileSize(100);
+	llamalog::Initialize(std::move(writer), std::move(fileWriter));
+
+	llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+	llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+	llamalog::Shutdown();
+
+	EXPECT_EQ(2, m_lines);
+}
+
+TEST_F(LogWriter_Test, Log_CompressionAfterRollFile_CompressPreviousFile) {
+	const HANDLE hCompress = &m_out;
+	EXPECT_CALL(m_mock, CreateFileW(MatchesRegex(L"X:\\\\testing\\\\logs\\\\ll_test\\.2[0-9]{3}[01][0-9][0-3][0-9]\\.log"), FILE_APPEND_DATA, DTGM_ARG5))
+		.WillOnce(t::Return(m_hFile));
+	EXPECT_CALL(m_mock, CreateFileW(MatchesRegex(L"X:\\\\testing\\\\logs\\\\ll_test\\.2[0-9]{3}[01][0-9][0-3][0-9]_001\\.log"), FILE_APPEND_DATA, DTGM_ARG5))
+		.WillOnce(t::Return(m_hFile));
+	EXPECT_CALL(m_mock, GetFileSizeEx(m_hFile, DTGM_ARG1))
+		.Times(2)
+		.WillRepeatedly(t::Invoke([](t::Unused, PLARGE_INTEGER lpFileSize) {
+			lpFileSize->QuadPart = 0;
+			return TRUE;
+		}));
+	EXPECT_CALL(m_mock, WriteFile(m_hFile, DTGM_ARG4))
+		.Times(2);
+	EXPECT_CALL(m_mock, CloseHandle(m_hFile))
+		.Times(2);
+
+	EXPECT_CALL(m_mock, CreateFileW(MatchesRegex(L"X:\\\\testing\\\\logs\\\\ll_test\\.2[0-9]{3}[01][0-9][0-3][0-9]\\.log"), GENERIC_READ | GENERIC_WRITE, DTGM_ARG5))
+		.WillOnce(t::Return(hCompress));
+	EXPECT_CALL(m_mock, DeviceIoControl(hCompress, FSCTL_SET_COMPRESSION, t::_, sizeof(USHORT), nullptr, 0, t::_, nullptr))
+		.WillOnce(t::Return(TRUE));
+	EXPECT_CALL(m_mock, CloseHandle(hCompress))
+		.WillOnce(t::Return(TRUE));
+
+	std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
+	std::unique_ptr<llamalog::RollingFileWriter> fileWriter = std::make_unique<llamalog::RollingFileWriter>(Priority::kDebug, "X:\\testing\\logs\\", "ll_test.log", llamalog::RollingFileWriter::Frequency::kDaily, 3u);
+	fileWriter->SetMaxFileSize(10);
+	fileWriter->SetCompression(true);
+	llamalog::Initialize(std::move(writer), std::move(fileWriter));
+
+	llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+	llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+	llamalog::Shutdown();  // waits for the compression
+
+	EXPECT_EQ(2, m_lines);
+}
+
+TEST_F(LogWriter_Test, Log_PreallocationSize_ReserveSpaceOnce) {
+	EXPECT_CALL(m_mock, CreateFileW(MatchesRegex(L"X:\\\\testing\\\\logs\\\\ll_test\\.2[0-9]{3}[01][0-9][0-3][0-9]\\.log"), FILE_WRITE_DATA | FILE_APPEND_DATA, DTGM_ARG5))
+		.WillOnce(t::Return(m_hFile));
+	EXPECT_CALL(m_mock, SetFilePointerEx(m_hFile, t::_, nullptr, FILE_END))
+		.WillOnce(t::Return(TRUE));
+	EXPECT_CALL(m_mock, GetFileSizeEx(m_hFile, DTGM_ARG1))
+		.WillOnce(t::Invoke([](t::Unused, PLARGE_INTEGER lpFileSize) {
+			lpFileSize->QuadPart = 0;
+			return TRUE;
+		}));
+	EXPECT_CALL(m_mock, SetFileInformationByHandle(m_hFile, FileAllocationInfo, t::_, sizeof(FILE_ALLOCATION_INFO)))
+		.WillOnce(t::Invoke([](t::Unused, t::Unused, LPVOID lpFileInformation, t::Unused) {
+			EXPECT_EQ(4096, static_cast<FILE_ALLOCATION_INFO*>(lpFileInformation)->AllocationSize.QuadPart);
+			return TRUE;
+		}));
+	EXPECT_CALL(m_mock, WriteFile(m_hFile, DTGM_ARG4))
+		.Times(2);
+	EXPECT_CALL(m_mock, CloseHandle(m_hFile));
+
+	std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
+	std::unique_ptr<llamalog::RollingFileWriter> fileWriter = std::make_unique<llamalog::RollingFileWriter>(Priority::kDebug, "X:\\testing\\logs\\", "ll_test.log", llamalog::RollingFileWriter::Frequency::kDaily, 3u);
+	fileWriter->SetPreallocationSize(4096);
+	llamalog::Initialize(std::move(writer), std::move(fileWriter));
+
+	llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+	llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+	llamalog::Shutdown();
+
+	EXPECT_EQ(2, m_lines);
+}
+
+TEST_F(LogWriter_Test, Log_PreallocationSizeForFile_ReserveSpace) {
+	std::wstring path;
+	EXPECT_CALL(m_mock, CreateFileW(t::HasSubstr(L"ll_prealloc."), FILE_WRITE_DATA | FILE_APPEND_DATA, DTGM_ARG5))
+		.WillOnce(t::Invoke([&path](LPCWSTR lpFileName, DWORD dwDesiredAccess, DWORD dwShareMode, LPSECURITY_ATTRIBUTES lpSecurityAttributes, DWORD dwCreationDisposition, DWORD dwFlagsAndAttributes, HANDLE hTemplateFile) {
+			path = lpFileName;
+			// clang-format off
+			return DTGM_REAL(Win32, CreateFileW)(lpFileName, dwDesiredAccess, dwShareMode, lpSecurityAttributes, dwCreationDisposition, dwFlagsAndAttributes, hTemplateFile);
+			// clang-format on
+		}));
+
+	std::unique_ptr<llamalog::RollingFileWriter> fileWriter = std::make_unique<llamalog::RollingFileWriter>(Priority::kDebug, std::filesystem::temp_directory_path().string(), "ll_prealloc.log", llamalog::RollingFileWriter::Frequency::kDaily, 3u);
+	fileWriter->SetPreallocationSize(65536);
+	llamalog::Initialize(std::move(fileWriter));
+
+	llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+	llamalog::Flush();
+
+	// the unused space is released when the writer closes the file
+	// clang-format off
+	const HANDLE hFile = DTGM_REAL(Win32, CreateFileW)(path.c_str(), FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	// clang-format on
+	ASSERT_NE(INVALID_HANDLE_VALUE, hFile);
+	FILE_STANDARD_INFO info;
+	const BOOL result = GetFileInformationByHandleEx(hFile, FileStandardInfo, &info, sizeof(info));
+	// clang-format off
+	DTGM_REAL(Win32, CloseHandle)(hFile);
+	// clang-format on
+
+	llamalog::Shutdown();
+	// clang-format off
+	DTGM_REAL(Win32, DeleteFileW)(path.c_str());
+	// clang-format on
+
+	ASSERT_TRUE(result);
+	EXPECT_GE(info.AllocationSize.QuadPart, 65536);
+	EXPECT_LT(info.EndOfFile.QuadPart, 65536);
+}
+
+TEST_F(LogWriter_Test, Log_PrepareNextFile_OpenInBackground) {
+	const auto toFileTime = [](const WORD day, const WORD hour, const WORD minute, const WORD second) noexcept {
+		const SYSTEMTIME systemTime = {.wYear = 2019, .wMonth = 1, .wDay = day, .wHour = hour, .wMinute = minute, .wSecond = second};
+		FILETIME fileTime;
+		EXPECT_TRUE(SystemTimeToFileTime(&systemTime, &fileTime));
+		return fileTime;
+	};
+	FILETIME now = toFileTime(5, 10, 0, 0);
+	EXPECT_CALL(m_mock, GetSystemTimeAsFileTime(t::_))
+		.WillRepeatedly(t::Invoke([&now](LPFILETIME lpSystemTimeAsFileTime) {
+			*lpSystemTimeAsFileTime = now;
+		}));
+
+	const HANDLE hNextFile = &m_hFind;
+	DWORD loggerThreadId = 0;
+	DWORD workerThreadId = 0;
+	std::promise<void> opening;
+	std::future<void> opened = opening.get_future();
+
+	t::Sequence current;
+	t::Sequence next;
+	EXPECT_CALL(m_mock, CreateFileW(t::StrEq(L"X:\\testing\\logs\\ll_test.20190105.log"), DTGM_ARG6))
+		.InSequence(current)
+		.WillOnce(t::Invoke([this, &loggerThreadId](t::Unused, t::Unused, t::Unused, t::Unused, t::Unused, t::Unused, t::Unused) {
+			loggerThreadId = GetCurrentThreadId();
+			return m_hFile;
+		}));
+	EXPECT_CALL(m_mock, WriteFile(m_hFile, DTGM_ARG4))
+		.Times(2)
+		.InSequence(current);
+	EXPECT_CALL(m_mock, CloseHandle(m_hFile))
+		.InSequence(current);
+
+	// the file for the next day is opened by the background thread before the first line is written to it
+	EXPECT_CALL(m_mock, CreateFileW(t::StrEq(L"X:\\testing\\logs\\ll_test.20190106.log"), DTGM_ARG6))
+		.InSequence(next)
+		.WillOnce(t::Invoke([hNextFile, &workerThreadId, &opening](t::Unused, t::Unused, t::Unused, t::Unused, t::Unused, t::Unused, t::Unused) {
+			workerThreadId = GetCurrentThreadId();
+			opening.set_value();
+			return hNextFile;
+		}));
+	EXPECT_CALL(m_mock, WriteFile(hNextFile, DTGM_ARG4))
+		.InSequence(next)
+		.WillOnce(t::Invoke([](t::Unused, t::Unused, DWORD nNumberOfBytesToWrite, LPDWORD lpNumberOfBytesWritten, t::Unused) {
+			*lpNumberOfBytesWritten = nNumberOfBytesToWrite;
+			return TRUE;
+		}));
+	EXPECT_CALL(m_mock, CloseHandle(hNextFile))
+		.InSequence(next)
+		.WillOnce(t::Return(TRUE));
+
+	EXPECT_CALL(m_mock, FindFirstFileExW(t::StrEq(L"X:\\testing\\logs\\ll_test.????????.log"), DTGM_ARG5));
+	EXPECT_CALL(m_mock, DeleteFileW(DTGM_ARG1))
+		.Times(0);
+
+	std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
+	std::unique_ptr<llamalog::RollingFileWriter> fileWriter = std::make_unique<llamalog::RollingFileWriter>(Priority::kDebug, "X:\\testing\\logs\\", "ll_test.log", llamalog::RollingFileWriter::Frequency::kDaily, 3u);
+	fileWriter->SetPrepareNextFile(true);
+	llamalog::Initialize(std::move(writer), std::move(fileWriter));
+
+	llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+
+	// within the last minutes of the day
+	now = toFileTime(5, 23, 59, 30);
+	llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+
+	// the roll over waits for the file once the background thread has started opening it
+	EXPECT_EQ(std::future_status::ready, opened.wait_for(std::chrono::seconds(5)));
+	now = toFileTime(6, 0, 0, 1);
+	llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+	llamalog::Shutdown();
+
+	EXPECT_EQ(3, m_lines);
+	EXPECT_NE(loggerThreadId, workerThreadId);
+}
+
+TEST_F(LogWriter_Test, Log_AsyncWriteBuffers_AppendUsingOverlappedIO) {
+	EXPECT_CALL(m_mock, CreateFileW(MatchesRegex(L"X:\\\\testing\\\\logs\\\\ll_test\\.2[0-9]{3}[01][0-9][0-3][0-9]\\.log"), FILE_APPEND_DATA, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN | FILE_FLAG_OVERLAPPED, nullptr))
+		.WillOnce(t::Return(m_hFile));
+	EXPECT_CALL(m_mock, WriteFile(m_hFile, t::_, t::_, nullptr, t::AllOf(t::Field(&OVERLAPPED::Offset, 0xFFFFFFFFu), t::Field(&OVERLAPPED::OffsetHigh, 0xFFFFFFFFu), t::Field(&OVERLAPPED::hEvent, t::NotNull()))))
+		.Times(3)
+		.WillRepeatedly(detours_gmock::SetLastErrorAndReturn(ERROR_IO_PENDING, FALSE));
+	// wait for the first buffer when logging the third line and for all remaining ones before closing the file
+	EXPECT_CALL(m_mock, GetOverlappedResult(m_hFile, t::NotNull(), t::NotNull(), TRUE))
+		.Times(3)
+		.WillRepeatedly(t::Return(TRUE));
+	EXPECT_CALL(m_mock, CloseHandle(m_hFile));
+	EXPECT_CALL(m_mock, CloseHandle(t::Ne(m_hFile)))
+		.Times(2)
+		.WillRepeatedly(t::Return(TRUE));
+
+	std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
+	std::unique_ptr<llamalog::RollingFileWriter> fileWriter = std::make_unique<llamalog::RollingFileWriter>(Priority::kDebug, "X:\\testing\\logs\\", "ll_test.log", llamalog::RollingFileWriter::Frequency::kDaily, 3u);
+	fileWriter->SetAsyncWriteBuffers(2);
+	llamalog::Initialize(std::move(writer), std::move(fileWriter));
+
+	llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+	llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+	llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+	llamalog::Shutdown();
+
+	EXPECT_EQ(3, m_lines);
+}
+
+TEST_F(LogWriter_Test, Log_MappingSize_CopyToViewAndTruncate) {
+	const HANDLE hMapping = &m_out;
+	std::vector<char> view(64 * 1024);
+	EXPECT_CALL(m_mock, CreateFileW(MatchesRegex(L"X:\\\\testing\\\\logs\\\\ll_test\\.2[0-9]{3}[01][0-9][0-3][0-9]\\.log"), GENERIC_READ | GENERIC_WRITE, DTGM_ARG5))
+		.WillOnce(t::Return(m_hFile));
+	EXPECT_CALL(m_mock, GetFileSizeEx(m_hFile, DTGM_ARG1))
+		.WillOnce(t::Invoke([](t::Unused, PLARGE_INTEGER lpFileSize) {
+			lpFileSize->QuadPart = 0;
+			return TRUE;
+		}));
+	EXPECT_CALL(m_mock, CreateFileMappingW(m_hFile, nullptr, PAGE_READWRITE, 0, 64 * 1024, nullptr))
+		.WillOnce(t::Return(hMapping));
+	EXPECT_CALL(m_mock, MapViewOfFile(hMapping, FILE_MAP_WRITE, 0, 0, 64 * 1024))
+		.WillOnce(t::Return(view.data()));
+	EXPECT_CALL(m_mock, WriteFile(m_hFile, DTGM_ARG4))
+		.Times(0);
+
+	LONGLONG endOfFile = 0;
+	EXPECT_CALL(m_mock, UnmapViewOfFile(view.data()))
+		.WillOnce(t::Return(TRUE));
+	EXPECT_CALL(m_mock, CloseHandle(hMapping))
+		.WillOnce(t::Return(TRUE));
+	EXPECT_CALL(m_mock, SetFileInformationByHandle(m_hFile, FileEndOfFileInfo, t::_, sizeof(FILE_END_OF_FILE_INFO)))
+		.WillOnce(t::Invoke([&endOfFile](t::Unused, t::Unused, LPVOID lpFileInformation, t::Unused) {
+			endOfFile = static_cast<FILE_END_OF_FILE_INFO*>(lpFileInformation)->EndOfFile.QuadPart;
+			return TRUE;
+		}));
+	EXPECT_CALL(m_mock, CloseHandle(m_hFile));
+
+	std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
+	std::unique_ptr<llamalog::RollingFileWriter> fileWriter = std::make_unique<llamalog::RollingFileWriter>(Priority::kDebug, "X:\\testing\\logs\\", "ll_test.log", llamalog::RollingFileWriter::Frequency::kDaily, 3u);
+	fileWriter->SetMappingSize(1);
+	llamalog::Initialize(std::move(writer), std::move(fileWriter));
+
+	llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+	llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+	llamalog::Shutdown();
+
+	EXPECT_EQ(2, m_lines);
+	const std::string data(view.data());
+	EXPECT_EQ(static_cast<LONGLONG>(data.size()), endOfFile);
+	EXPECT_THAT(data, MatchesRegex("([0-9:. -]{23} DEBUG [^\\n]+ Test\\n){2}"));
+}
+
+TEST_F(LogWriter_Test, Log_MappedViewFull_MapNextView) {
+	const HANDLE hMapping = &m_out;
+	std::vector<char> view1(64 * 1024);
+	std::vector<char> view2(64 * 1024);
+	EXPECT_CALL(m_mock, CreateFileW(MatchesRegex(L"X:\\\\testing\\\\logs\\\\ll_test\\.2[0-9]{3}[01][0-9][0-3][0-9]\\.log"), GENERIC_READ | GENERIC_WRITE, DTGM_ARG5))
+		.WillOnce(t::Return(m_hFile));
+	// start with an existing file which has room for 10 more bytes in the first view
+	EXPECT_CALL(m_mock, GetFileSizeEx(m_hFile, DTGM_ARG1))
+		.WillOnce(t::Invoke([](t::Unused, PLARGE_INTEGER lpFileSize) {
+			lpFileSize->QuadPart = 64 * 1024 - 10;
+			return TRUE;
+		}));
+	EXPECT_CALL(m_mock, ReadFile(m_hFile, DTGM_ARG4))
+		.WillOnce(t::Invoke([](t::Unused, LPVOID lpBuffer, DWORD nNumberOfBytesToRead, LPDWORD lpNumberOfBytesRead, t::Unused) {
+			std::memset(lpBuffer, '\n', nNumberOfBytesToRead);
+			*lpNumberOfBytesRead = nNumberOfBytesToRead;
+			return TRUE;
+		}));
+	EXPECT_CALL(m_mock, CreateFileMappingW(m_hFile, nullptr, PAGE_READWRITE, 0, 64 * 1024, nullptr))
+		.WillOnce(t::Return(hMapping));
+	EXPECT_CALL(m_mock, MapViewOfFile(hMapping, FILE_MAP_WRITE, 0, 0, 64 * 1024))
+		.WillOnce(t::Return(view1.data()));
+	EXPECT_CALL(m_mock, CreateFileMappingW(m_hFile, nullptr, PAGE_READWRITE, 0, 128 * 1024, nullptr))
+		.WillOnce(t::Return(hMapping));
+	EXPECT_CALL(m_mock, MapViewOfFile(hMapping, FILE_MAP_WRITE, 0, 64 * 1024, 64 * 1024))
+		.WillOnce(t::Return(view2.data()));
+
+	EXPECT_CALL(m_mock, UnmapViewOfFile(t::_))
+		.Times(2)
+		.WillRepeatedly(t::Return(TRUE));
+	EXPECT_CALL(m_mock, CloseHandle(hMapping))
+		.Times(2)
+		.WillRepeatedly(t::Return(TRUE));
+	EXPECT_CALL(m_mock, SetFileInformationByHandle(m_hFile, FileEndOfFileInfo, DTGM_ARG2))
+		.WillOnce(t::Return(TRUE));
+	EXPECT_CALL(m_mock, CloseHandle(m_hFile));
+
+	std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
+	std::unique_ptr<llamalog::RollingFileWriter> fileWriter = std::make_unique<llamalog::RollingFileWriter>(Priority::kDebug, "X:\\testing\\logs\\", "ll_test.log", llamalog::RollingFileWriter::Frequency::kDaily, 3u);
+	fileWriter->SetMappingSize(64 * 1024);
+	llamalog::Initialize(std::move(writer), std::move(fileWriter));
+
+	llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+	llamalog::Shutdown();
+
+	EXPECT_EQ(1, m_lines);
+	const std::string data = std::string(&view1[64 * 1024 - 10], 10) + std::string(view2.data());
+	EXPECT_THAT(data, MatchesRegex("[0-9:. -]{23} DEBUG [^\\n]+ Test\\n"));
+}
+
+TEST_F(LogWriter_Test, Log_MappedFileWithZerosAfterCrash_TrimFile) {
+	const HANDLE hMapping = &m_out;
+	std::vector<char> view(64 * 1024);
+	// an existing file with a line of 100 bytes followed by the zeros of a view which has not been truncated
+	std::string file(100, 'x');
+	file.back() = '\n';
+	file.resize(128 * 1024, '\0');
+	EXPECT_CALL(m_mock, CreateFileW(MatchesRegex(L"X:\\\\testing\\\\logs\\\\ll_test\\.2[0-9]{3}[01][0-9][0-3][0-9]\\.log"), GENERIC_READ | GENERIC_WRITE, DTGM_ARG5))
+		.WillOnce(t::Return(m_hFile));
+	EXPECT_CALL(m_mock, GetFileSizeEx(m_hFile, DTGM_ARG1))
+		.WillOnce(t::Invoke([&file](t::Unused, PLARGE_INTEGER lpFileSize) {
+			lpFileSize->QuadPart = static_cast<LONGLONG>(file.size());
+			return TRUE;
+		}));
+	EXPECT_CALL(m_mock, ReadFile(m_hFile, DTGM_ARG4))
+		.WillRepeatedly(t::Invoke([&file](t::Unused, LPVOID lpBuffer, DWORD nNumberOfBytesToRead, LPDWORD lpNumberOfBytesRead, LPOVERLAPPED lpOverlapped) {
+			const std::size_t offset = (static_cast<std::size_t>(lpOverlapped->OffsetHigh) << 32u) | lpOverlapped->Offset;
+			std::memcpy(lpBuffer, file.data() + offset, nNumberOfBytesToRead);
+			*lpNumberOfBytesRead = nNumberOfBytesToRead;
+			return TRUE;
+		}));
+	EXPECT_CALL(m_mock, CreateFileMappingW(m_hFile, nullptr, PAGE_READWRITE, 0, 64 * 1024, nullptr))
+		.WillOnce(t::Return(hMapping));
+	EXPECT_CALL(m_mock, MapViewOfFile(hMapping, FILE_MAP_WRITE, 0, 0, 64 * 1024))
+		.WillOnce(t::Return(view.data()));
+
+	std::vector<LONGLONG> endOfFile;
+	EXPECT_CALL(m_mock, UnmapViewOfFile(view.data()))
+		.WillOnce(t::Return(TRUE));
+	EXPECT_CALL(m_mock, CloseHandle(hMapping))
+		.WillOnce(t::Return(TRUE));
+	EXPECT_CALL(m_mock, SetFileInformationByHandle(m_hFile, FileEndOfFileInfo, t::_, sizeof(FILE_END_OF_FILE_INFO)))
+		.Times(2)
+		.WillRepeatedly(t::Invoke([&endOfFile](t::Unused, t::Unused, LPVOID lpFileInformation, t::Unused) {
+			endOfFile.push_back(static_cast<FILE_END_OF_FILE_INFO*>(lpFileInformation)->EndOfFile.QuadPart);
+			return TRUE;
+		}));
+	EXPECT_CALL(m_mock, CloseHandle(m_hFile));
+
+	std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
+	std::unique_ptr<llamalog::RollingFileWriter> fileWriter = std::make_unique<llamalog::RollingFileWriter>(Priority::kDebug, "X:\\testing\\logs\\", "ll_test.log", llamalog::RollingFileWriter::Frequency::kDaily, 3u);
+	fileWriter->SetMappingSize(64 * 1024);
+	llamalog::Initialize(std::move(writer), std::move(fileWriter));
+
+	llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+	llamalog::Shutdown();
+
+	EXPECT_EQ(1, m_lines);
+	// the new line directly follows the existing one
+	const std::string data(&view[100]);
+	EXPECT_THAT(data, MatchesRegex("[0-9:. -]{23} DEBUG [^\\n]+ Test\\n"));
+	EXPECT_THAT(endOfFile, t::ElementsAre(100, static_cast<LONGLONG>(100 + data.size())));
+}
+
+TEST_F(LogWriter_Test, MapView_ErrorWithinLine_DropLine) {
+	const HANDLE hMapping = &m_out;
+	std::vector<char> view1(64 * 1024);
+	std::vector<char> view2(64 * 1024);
+	EXPECT_CALL(m_mock, CreateFileW(MatchesRegex(L"X:\\\\testing\\\\logs\\\\ll_test\\.2[0-9]{3}[01][0-9][0-3][0-9]\\.log"), GENERIC_READ | GENERIC_WRITE, DTGM_ARG5))
+		.WillOnce(t::Return(m_hFile));
+	// start with an existing file which has room for 10 more bytes in the first view
+	EXPECT_CALL(m_mock, GetFileSizeEx(m_hFile, DTGM_ARG1))
+		.WillOnce(t::Invoke([](t::Unused, PLARGE_INTEGER lpFileSize) {
+			lpFileSize->QuadPart = 64 * 1024 - 10;
+			return TRUE;
+		}));
+	EXPECT_CALL(m_mock, ReadFile(m_hFile, DTGM_ARG4))
+		.WillOnce(t::Invoke([](t::Unused, LPVOID lpBuffer, DWORD nNumberOfBytesToRead, LPDWORD lpNumberOfBytesRead, t::Unused) {
+			std::memset(lpBuffer, '\n', nNumberOfBytesToRead);
+			*lpNumberOfBytesRead = nNumberOfBytesToRead;
+			return TRUE;
+		}));
+	// the second view fails for the first line, the error message is written to the file instead
+	EXPECT_CALL(m_mock, CreateFileMappingW(m_hFile, nullptr, PAGE_READWRITE, 0, 64 * 1024, nullptr))
+		.Times(2)
+		.WillRepeatedly(t::Return(hMapping));
+	EXPECT_CALL(m_mock, MapViewOfFile(hMapping, FILE_MAP_WRITE, 0, 0, 64 * 1024))
+		.Times(2)
+		.WillRepeatedly(t::Return(view1.data()));
+	EXPECT_CALL(m_mock, CreateFileMappingW(m_hFile, nullptr, PAGE_READWRITE, 0, 128 * 1024, nullptr))
+		.WillOnce(detours_gmock::SetLastErrorAndReturn(ERROR_DISK_FULL, nullptr))
+		.WillOnce(t::Return(hMapping));
+	EXPECT_CALL(m_mock, MapViewOfFile(hMapping, FILE_MAP_WRITE, 0, 64 * 1024, 64 * 1024))
+		.WillOnce(t::Return(view2.data()));
+
+	LONGLONG endOfFile = 0;
+	EXPECT_CALL(m_mock, UnmapViewOfFile(t::_))
+		.Times(3)
+		.WillRepeatedly(t::Return(TRUE));
+	EXPECT_CALL(m_mock, CloseHandle(hMapping))
+		.Times(3)
+		.WillRepeatedly(t::Return(TRUE));
+	EXPECT_CALL(m_mock, SetFileInformationByHandle(m_hFile, FileEndOfFileInfo, t::_, sizeof(FILE_END_OF_FILE_INFO)))
+		.WillOnce(t::Invoke([&endOfFile](t::Unused, t::Unused, LPVOID lpFileInformation, t::Unused) {
+			endOfFile = static_cast<FILE_END_OF_FILE_INFO*>(lpFileInformation)->EndOfFile.QuadPart;
+			return TRUE;
+		}));
+	EXPECT_CALL(m_mock, CloseHandle(m_hFile));
+
+	std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
+	std::unique_ptr<llamalog::RollingFileWriter> fileWriter = std::make_unique<llamalog::RollingFileWriter>(Priority::kDebug, "X:\\testing\\logs\\", "ll_test.log", llamalog::RollingFileWriter::Frequency::kDaily, 3u);
+	fileWriter->SetMappingSize(64 * 1024);
+	llamalog::Initialize(std::move(writer), std::move(fileWriter));
+
+	llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+	llamalog::Shutdown();
+
+	EXPECT_EQ(2, m_lines);
+	// the error message replaces the start of the dropped line
+	const std::string data = std::string(&view1[64 * 1024 - 10], 10) + std::string(view2.data());
+	EXPECT_THAT(data, MatchesRegex("[0-9:. -]{23} ERROR [^\\n]* MapView Error mapping log: [^\\n]+ \\(112\\)\\n"));
+	EXPECT_EQ(static_cast<LONGLONG>(64 * 1024 - 10 + data.size()), endOfFile);
+}
+
+TEST_F(LogWriter_Test, Flush_Durable_SyncFile) {
+	t::InSequence sequence;
+	EXPECT_CALL(m_mock, CreateFileW(MatchesRegex(L"X:\\\\testing\\\\logs\\\\ll_test\\.2[0-9]{3}[01][0-9][0-3][0-9]\\.log"), DTGM_ARG6))
+		.WillOnce(t::Return(m_hFile));
+	EXPECT_CALL(m_mock, WriteFile(m_hFile, DTGM_ARG4));
+	EXPECT_CALL(m_mock, FlushFileBuffers(m_hFile))
+		.WillOnce(t::Return(TRUE));
+	EXPECT_CALL(m_mock, CloseHandle(m_hFile));
+
+	std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
+	std::unique_ptr<llamalog::RollingFileWriter> fileWriter = std::make_unique<llamalog::RollingFileWriter>(Priority::kDebug, "X:\\testing\\logs\\", "ll_test.log", llamalog::RollingFileWriter::Frequency::kDaily, 3u);
+	llamalog::Initialize(std::move(writer), std::move(fileWriter));
+
+	llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+	llamalog::Flush(true);
+	llamalog::Shutdown();
+
+	EXPECT_EQ(1, m_lines);
+}
+
+TEST_F(LogWriter_Test, Log_SyncPriority_SyncWithoutFlush) {
+	bool synced = false;
+	EXPECT_CALL(m_mock, CreateFileW(MatchesRegex(L"X:\\\\testing\\\\logs\\\\ll_test\\.2[0-9]{3}[01][0-9][0-3][0-9]\\.log"), DTGM_ARG6))
+		.WillOnce(t::Return(m_hFile));
+	EXPECT_CALL(m_mock, WriteFile(m_hFile, DTGM_ARG4))
+		.Times(2);
+	// a single flush covers both lines and no data is left for closing the file
+	EXPECT_CALL(m_mock, FlushFileBuffers(m_hFile))
+		.WillOnce(t::Invoke([&synced](t::Unused) {
+			synced = true;
+			return TRUE;
+		}));
+	EXPECT_CALL(m_mock, CloseHandle(m_hFile));
+
+	std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
+	std::unique_ptr<llamalog::RollingFileWriter> fileWriter = std::make_unique<llamalog::RollingFileWriter>(Priority::kDebug, "X:\\testing\\logs\\", "ll_test.log", llamalog::RollingFileWriter::Frequency::kDaily, 3u);
+	fileWriter->SetSyncPriority(Priority::kError);
+	llamalog::Initialize(std::move(writer), std::move(fileWriter));
+
+	llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+	llamalog::Log(Priority::kError, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+	// the logger commits before it waits for the next events
+	llamalog::Flush();
+	EXPECT_TRUE(synced);
+	llamalog::Shutdown();
+
+	EXPECT_EQ(2, m_lines);
+}
+
+TEST_F(LogWriter_Test, FlushFileBuffers_Error_SyncAgainOnClose) {
+	EXPECT_CALL(m_mock, CreateFileW(MatchesRegex(L"X:\\\\testing\\\\logs\\\\ll_test\\.2[0-9]{3}[01][0-9][0-3][0-9]\\.log"), DTGM_ARG6))
+		.WillOnce(t::Return(m_hFile));
+	EXPECT_CALL(m_mock, WriteFile(m_hFile, DTGM_ARG4))
+		.Times(2);
+	// the error message does not trigger another flush, but the data is still unsynced when the file is closed
+	EXPECT_CALL(m_mock, FlushFileBuffers(m_hFile))
+		.WillOnce(detours_gmock::SetLastErrorAndReturn(ERROR_NOT_READY, FALSE))
+		.WillOnce(t::Return(TRUE));
+	EXPECT_CALL(m_mock, CloseHandle(m_hFile));
+
+	std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
+	std::unique_ptr<llamalog::RollingFileWriter> fileWriter = std::make_unique<llamalog::RollingFileWriter>(Priority::kDebug, "X:\\testing\\logs\\", "ll_test.log", llamalog::RollingFileWriter::Frequency::kDaily, 3u);
+	fileWriter->SetSyncPriority(Priority::kError);
+	llamalog::Initialize(std::move(writer), std::move(fileWriter));
+
+	llamalog::Log(Priority::kError, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+	llamalog::Shutdown();
+
+	EXPECT_EQ(2, m_lines);
+	EXPECT_THAT(m_out.str(), MatchesRegex("[^\\n]+\\n[0-9:. -]{23} ERROR [^\\n]* Sync Error syncing log: [^\\n]+ \\(21\\)\\n"));
+}
+
+TEST_F(LogWriter_Test, Log_SyncIntervalWhileIdle_SyncWithinInterval) {
+	std::promise<void> syncing;
+	std::future<void> synced = syncing.get_future();
+	EXPECT_CALL(m_mock, CreateFileW(MatchesRegex(L"X:\\\\testing\\\\logs\\\\ll_test\\.2[0-9]{3}[01][0-9][0-3][0-9]\\.log"), DTGM_ARG6))
+		.WillOnce(t::Return(m_hFile));
+	EXPECT_CALL(m_mock, WriteFile(m_hFile, DTGM_ARG4));
+	EXPECT_CALL(m_mock, FlushFileBuffers(m_hFile))
+		.WillOnce(t::Invoke([&syncing](t::Unused) {
+			syncing.set_value();
+			return TRUE;
+		}));
+	EXPECT_CALL(m_mock, CloseHandle(m_hFile));
+
+	std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
+	std::unique_ptr<llamalog::RollingFileWriter> fileWriter = std::make_unique<llamalog::RollingFileWriter>(Priority::kDebug, "X:\\testing\\logs\\", "ll_test.log", llamalog::RollingFileWriter::Frequency::kDaily, 3u);
+	fileWriter->SetSyncInterval(10);
+	llamalog::Initialize(std::move(writer), std::move(fileWriter));
+
+	llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", "Test");
+	// without further events the logger thread would only wake up after 5 seconds
+	EXPECT_EQ(std::future_status::ready, synced.wait_for(std::chrono::seconds(2)));
+	llamalog::Shutdown();
+
+	EXPECT_EQ(1, m_lines);
 }
 
 TEST_F(LogWriter_Test, StdErrWriter_Log_WriteOutput) {
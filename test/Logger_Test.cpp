@@ -28,6 +28,7 @@ limitations under the License.
 #include <windows.h>
 
 #include <exception>
+#include <future>
 #include <memory>
 #include <regex>
 #include <sstream>
@@ -115,6 +116,45 @@ private:
 	int& m_lines;
 };
 
+
+/// @brief A writer which logs a fatal event itself when writing the event from line 99.
+class FatalWriter : public LogWriter {
+public:
+	using LogWriter::LogWriter;
+
+protected:
+	void Log(const LogLine& logLine) final {
+		if (logLine.GetLine() == 99) {
+			llamalog::Log(Priority::kFatal, GetFilename(__FILE__), 100, __func__, "{}", 9);
+		}
+	}
+};
+
+/// @brief A writer which waits when writing the first event from line 97 until the test has added more events.
+class BlockingWriter : public LogWriter {
+public:
+	BlockingWriter(const Priority logLevel, std::promise<void>& blocked, std::future<void>&& release)
+		: LogWriter(logLevel)
+		, m_blocked(blocked)
+		, m_release(std::move(release)) {
+		// empty
+	}
+
+protected:
+	void Log(const LogLine& logLine) final {
+		if (logLine.GetLine() == 97 && !m_waited) {
+			m_waited = true;
+			m_blocked.set_value();
+			m_release.wait();
+		}
+	}
+
+private:
+	std::promise<void>& m_blocked;
+	std::future<void> m_release;
+	bool m_waited = false;
+};
+
 }  // namespace
 
 //
@@ -208,6 +248,196 @@ TEST_F(Logger_Test, Log_1000Lines) {
 	EXPECT_EQ(1000, m_lines);
 }
 
+TEST_F(Logger_Test, Log_Repeated_Suppress) {
+	{
+		std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
+		llamalog::Initialize(std::move(writer));
+		llamalog::SetRepeatSuppression(true);
+
+		for (int i = 0; i < 6; ++i) {
+			llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", i < 4 ? 7 : 8);
+		}
+
+		llamalog::Shutdown();
+	}
+
+	EXPECT_EQ(4, m_lines);
+	EXPECT_THAT(m_out.str(), MatchesRegex("[^\\n]+:99 TestBody 7\\n[^\\n]+:99 TestBody last message repeated 3 times\\n[^\\n]+:99 TestBody 8\\n[^\\n]+:99 TestBody last message repeated once\\n"));
+}
+
+TEST_F(Logger_Test, Log_RepeatedWithFatalInBetween_Suppress) {
+	{
+		std::promise<void> blocked;
+		std::promise<void> release;
+		std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
+		std::unique_ptr<BlockingWriter> blockingWriter = std::make_unique<BlockingWriter>(Priority::kDebug, blocked, release.get_future());
+		llamalog::Initialize(std::move(writer), std::move(blockingWriter));
+		llamalog::SetRepeatSuppression(true);
+
+		llamalog::Log(Priority::kWarn, GetFilename(__FILE__), 97, __func__, "{}", 7);
+		blocked.get_future().wait();
+
+		// the fatal event overtakes the warnings which are added while the logger thread waits
+		for (int i = 0; i < 6; ++i) {
+			if (i == 2) {
+				llamalog::Log(Priority::kFatal, GetFilename(__FILE__), 98, __func__, "{}", 8);
+			} else {
+				llamalog::Log(Priority::kWarn, GetFilename(__FILE__), 97, __func__, "{}", 7);
+			}
+		}
+		release.set_value();
+
+		llamalog::Shutdown();
+	}
+
+	EXPECT_EQ(3, m_lines);
+	EXPECT_THAT(m_out.str(), MatchesRegex("[^\\n]+ WARN [^\\n]+:97 TestBody 7\\n[^\\n]+ FATAL [^\\n]+:98 TestBody 8\\n[^\\n]+ WARN [^\\n]+:97 TestBody last message repeated 5 times\\n"));
+}
+
+TEST_F(Logger_Test, Log_RepeatedNotSuppressed_LogAll) {
+	{
+		std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
+		llamalog::Initialize(std::move(writer));
+
+		for (int i = 0; i < 4; ++i) {
+			llamalog::Log(Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", 7);
+		}
+
+		llamalog::Shutdown();
+	}
+
+	EXPECT_EQ(4, m_lines);
+}
+
+TEST_F(Logger_Test, Log_SiteDisabled_NoOutput) {
+	{
+		std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
+		llamalog::Initialize(std::move(writer));
+
+		SetLogSitesEnabled("Logger_Test.cpp", "TestBody", false);
+		LLAMALOG_LOG(Priority::kDebug, "{}", 7);
+		SetLogSitesEnabled("Logger_Test.cpp", "TestBody", true);
+		LLAMALOG_LOG(Priority::kDebug, "{}", 8);
+		ResetLogSites();
+
+		llamalog::Shutdown();
+	}
+
+	EXPECT_EQ(1, m_lines);
+	EXPECT_THAT(m_out.str(), t::EndsWith(" TestBody 8\n"));
+}
+
+TEST_F(Logger_Test, Log_Sampled_ReportSuppressed) {
+	{
+		std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
+		llamalog::Initialize(std::move(writer));
+
+		for (int i = 0; i < 10; ++i) {
+			LLAMALOG_LOG_SAMPLED(Priority::kInfo, Sampling::EveryNth(5), "{}", i);
+		}
+
+		llamalog::Shutdown();
+	}
+
+	EXPECT_EQ(3, m_lines);
+	EXPECT_THAT(m_out.str(), MatchesRegex("[^\\n]+ INFO [^\\n]+ TestBody 0\\n[^\\n]+ INFO [^\\n]+ TestBody 5\\n[^\\n]+ INFO [^\\n]+ TestBody 8 messages suppressed\\n"));
+}
+
+TEST_F(Logger_Test, Log_SynchronousFatal_WrittenBeforeReturn) {
+	{
+		std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
+		llamalog::Initialize(std::move(writer));
+		llamalog::SetSynchronousFatal(true);
+
+		llamalog::Log(Priority::kError, GetFilename(__FILE__), 98, __func__, "{}", 7);
+		llamalog::Log(Priority::kFatal, GetFilename(__FILE__), 99, __func__, "{}", 8);
+
+		EXPECT_EQ(2, m_lines);
+		EXPECT_THAT(m_out.str(), MatchesRegex("[^\\n]+ ERROR [^\\n]+:98 TestBody 7\\n[^\\n]+ FATAL [^\\n]+:99 TestBody 8\\n"));
+
+		llamalog::Shutdown();
+	}
+
+	EXPECT_EQ(2, m_lines);
+}
+
+TEST_F(Logger_Test, Log_SynchronousFatalFromWriter_Queue) {
+	{
+		std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
+		std::unique_ptr<FatalWriter> fatalWriter = std::make_unique<FatalWriter>(Priority::kDebug);
+		llamalog::Initialize(std::move(writer), std::move(fatalWriter));
+		llamalog::SetSynchronousFatal(true);
+
+		// the second event is logged while the calling thread is writing the first one
+		llamalog::Log(Priority::kFatal, GetFilename(__FILE__), 99, __func__, "{}", 8);
+		llamalog::Flush();
+
+		EXPECT_EQ(2, m_lines);
+		EXPECT_THAT(m_out.str(), MatchesRegex("[^\\n]+ FATAL [^\\n]+:99 TestBody 8\\n[^\\n]+ FATAL [^\\n]+:100 Log 9\\n"));
+
+		llamalog::Shutdown();
+	}
+
+	EXPECT_EQ(2, m_lines);
+}
+
+TEST_F(Logger_Test, LogTo_TwoLoggers_Separate) {
+	std::ostringstream out;
+	int lines = 0;
+	{
+		std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
+		llamalog::Initialize(std::move(writer));
+		{
+			Logger logger(std::make_unique<StringWriter>(Priority::kDebug, out, lines));
+
+			LLAMALOG_LOG_TO(logger, Priority::kInfo, "{}", 7);
+			LLAMALOG_LOG(Priority::kInfo, "{}", 8);
+			LLAMALOG_LOG_TO_NOEXCEPT(logger, Priority::kInfo, "{}", 9);
+		}
+		llamalog::Shutdown();
+	}
+
+	EXPECT_EQ(1, m_lines);
+	EXPECT_THAT(m_out.str(), t::EndsWith(" TestBody 8\n"));
+	EXPECT_EQ(2, lines);
+	EXPECT_THAT(out.str(), MatchesRegex("[^\\n]+ TestBody 7\\n[^\\n]+ TestBody 9\\n"));
+}
+
+TEST_F(Logger_Test, LogTo_WithoutDefaultLogger_Log) {
+	{
+		Logger logger(std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines));
+
+		llamalog::Log(logger, Priority::kDebug, GetFilename(__FILE__), 99, __func__, "{}", 7);
+	}
+
+	EXPECT_FALSE(llamalog::IsInitialized());
+	EXPECT_EQ(1, m_lines);
+	EXPECT_THAT(m_out.str(), t::EndsWith(" Logger_Test.cpp:99 TestBody 7\n"));
+}
+
+TEST_F(Logger_Test, LogTo_Sampled_ReportSuppressedToLogger) {
+	std::ostringstream out;
+	int lines = 0;
+	{
+		std::unique_ptr<StringWriter> writer = std::make_unique<StringWriter>(Priority::kDebug, m_out, m_lines);
+		llamalog::Initialize(std::move(writer));
+		{
+			Logger logger(std::make_unique<StringWriter>(Priority::kDebug, out, lines));
+
+			SetLogSitesSampling("Logger_Test.cpp", "TestBody", Sampling::EveryNth(2));
+			for (int i = 0; i < 3; ++i) {
+				LLAMALOG_LOG_TO(logger, Priority::kInfo, "{}", i);
+			}
+			ResetLogSites();
+		}
+		llamalog::Shutdown();
+	}
+
+	EXPECT_EQ(0, m_lines);
+	EXPECT_EQ(3, lines);
+	EXPECT_THAT(out.str(), MatchesRegex("[^\\n]+ INFO [^\\n]+ TestBody 0\\n[^\\n]+ INFO [^\\n]+ TestBody 2\\n[^\\n]+ INFO [^\\n]+ TestBody 1 messages suppressed\\n"));
+}
+
 
 //
 // Log exception safe
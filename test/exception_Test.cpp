@@ -28,6 +28,7 @@ limitations under the License.
 #include <windows.h>
 
 #include <algorithm>
+#include <cstring>
 #include <exception>
 #include <memory>
 #include <regex>
@@ -355,6 +356,56 @@ TEST(exception_Test, ExceptionDetail_whatWithNullptrMessage_GetExceptionMessage)
 	}
 }
 
+TEST(exception_Test, ExceptionDetail_Copy_ShareMessage) {
+	try {
+		throw internal::ExceptionDetail(std::range_error("testmsg"), "myfile.cpp", 15, "exfunc", "MyMessage {}", std::string(1000, 'x'));
+	} catch (internal::ExceptionDetail<std::range_error>& e) {
+		const internal::ExceptionDetail<std::range_error> copy(e);
+		internal::ExceptionDetail<std::range_error> assigned = e;
+		assigned = copy;
+
+		EXPECT_EQ(1010u, std::strlen(copy.what()));
+		EXPECT_EQ(copy.what(), e.what());
+		EXPECT_EQ(assigned.what(), e.what());
+	}
+}
+
+TEST(exception_Test, ExceptionDetail_Move_SourceKeepsMessage) {
+	try {
+		throw internal::ExceptionDetail(std::range_error("testmsg"), "myfile.cpp", 15, "exfunc", "MyMessage {}", 7);
+	} catch (internal::ExceptionDetail<std::range_error>& e) {
+		internal::ExceptionDetail<std::range_error> moved(std::move(e));
+		internal::ExceptionDetail<std::range_error> assigned = moved;
+		assigned = std::move(moved);
+
+		EXPECT_STREQ("MyMessage 7", e.what());  // NOLINT(bugprone-use-after-move, hicpp-invalid-access-moved): Test use after move.
+		EXPECT_EQ(e.what(), moved.what());  // NOLINT(bugprone-use-after-move, hicpp-invalid-access-moved): Test use after move.
+		EXPECT_EQ(e.what(), assigned.what());
+	}
+}
+
+TEST(exception_Test, ExceptionDetail_LogOutsideOfCatch_PrintValue) {
+	LogLine logLine = GetLogLine("{0:%w} {0:%[%F:%L]}");
+	{
+		const internal::ExceptionDetail exception(std::range_error("testmsg"), "myfile.cpp", 15, "exfunc", "MyMessage {}", "myarg");
+		logLine << exception;
+	}
+	const std::string str = logLine.GetLogMessage();
+
+	EXPECT_EQ("MyMessage myarg myfile.cpp:15", str);
+}
+
+TEST(exception_Test, systemerror_LogOutsideOfCatch_PrintValue) {
+	LogLine logLine = GetLogLine("{0:%w} {0:%[%C %c]}");
+	{
+		const system_error exception(7, kTestCategory, "testmsg");
+		logLine << exception;
+	}
+	const std::string str = logLine.GetLogMessage();
+
+	EXPECT_EQ("testmsg: This is an error message TestError 7", str);
+}
+
 TEST(exception_Test, ExceptionDetail_Formatting_FirstCalledWhenLogging) {
 	LogLine logLine = GetLogLine();
 	int called = 0;
@@ -1788,6 +1839,24 @@ TEST(exception_Test, SubFormat_IssystemerrorPlain_PrintValue) {
 	EXPECT_EQ("TestError testmsg: This is an error message", str);
 }
 
+TEST(exception_Test, SubFormat_SamePatternTwice_PrintValues) {
+	LogLine logLine = GetLogLine("{0:%[%F:%L ]%w{2:>4}} {1:%[%F:%L ]%w{2:>4}}");
+	try {
+		llamalog::Throw(std::invalid_argument("testmsg"), "myfile.cpp", 15, "exfunc");
+	} catch (const std::exception& e) {
+		logLine << e;
+	}
+	try {
+		throw std::invalid_argument("plainmsg");
+	} catch (const std::exception& e) {
+		logLine << e;
+	}
+	logLine << 7;
+	const std::string str = logLine.GetLogMessage();
+
+	EXPECT_EQ("myfile.cpp:15 testmsg   7 plainmsg   7", str);
+}
+
 TEST(exception_Test, GetCurrentExceptionAsBaseException_IsBaseException_ReturnPointer) {
 	try {
 		LLAMALOG_THROW(system_error(7, kTestCategory, "testmsg"));
@@ -18,16 +18,20 @@ limitations under the License.
 
 #include "llamalog/LogLine.h"
 
+#include <fmt/core.h>
+#include <fmt/format.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <crtdbg.h>
 #include <windows.h>
 
 #include <cinttypes>
+#include <cstddef>
 #include <cstdint>
 #include <cstdio>
 #include <string>
-
+#include <vector>
 
 namespace llamalog::test {
 
@@ -79,6 +83,21 @@ TEST(winapi_log_Test, errorcode_LastError_PrintMessage) {
 	EXPECT_THAT(str, t::MatchesRegex(".+\\S \\(5\\)"));
 }
 
+TEST(winapi_log_Test, errorcode_LogSameCodeTwice_PrintSameMessage) {
+	LogLine logLine = GetLogLine("{}|{:%}|{}");
+	{
+		const error_code arg{ERROR_FILE_NOT_FOUND};
+		logLine << arg << arg << error_code{ERROR_PATH_NOT_FOUND};
+	}
+	const std::string str = logLine.GetLogMessage();
+
+	const std::size_t first = str.find('|');
+	const std::size_t second = str.find('|', first + 1);
+	ASSERT_NE(std::string::npos, second);
+	EXPECT_EQ(str.substr(0, first), str.substr(first + 1, second - first - 1) + " (2)");
+	EXPECT_THAT(str.substr(second + 1), t::MatchesRegex(".+\\S \\(3\\)"));
+}
+
 
 //
 // LARGE_INTEGER
@@ -388,4 +407,123 @@ TEST(winapi_log_Test, RECT_LogPointerNullptrPrintPaddedWithCustomFormat_PrintNul
 	EXPECT_EQ("nullptr", str);
 }
 
+
+//
+// Allocations
+//
+
+// the CRT allocation hook is only available with the debug CRT
+#ifdef _DEBUG
+
+namespace {
+
+DWORD g_countThreadId = 0;      ///< @brief The id of the thread whose allocations are counted or 0.
+std::size_t g_allocations = 0;  ///< @brief The number of allocations of the thread `g_countThreadId`.
+
+/// @brief A CRT allocation hook which counts the allocations of the thread `g_countThreadId`.
+/// @param allocType The type of the operation.
+/// @return Always `TRUE` to let the operation continue.
+int __cdecl CountAllocations(const int allocType, void* /* pUserData */, std::size_t /* size */, int /* blockType */, long /* requestNumber */, const unsigned char* /* filename */, int /* lineNumber */) noexcept {  // NOLINT(google-runtime-int): Signature of _CRT_ALLOC_HOOK.
+	if (allocType != _HOOK_FREE && GetCurrentThreadId() == g_countThreadId) {
+		++g_allocations;
+	}
+	return TRUE;
+}
+
+/// @brief Counts the heap allocations of the calling thread as long as the object exists.
+class AllocationCounter final {
+public:
+	AllocationCounter() noexcept
+		: m_previousHook(_CrtSetAllocHook(&CountAllocations)) {
+		g_allocations = 0;
+		g_countThreadId = GetCurrentThreadId();
+	}
+	AllocationCounter(const AllocationCounter&) = delete;
+	AllocationCounter(AllocationCounter&&) = delete;
+	~AllocationCounter() noexcept {
+		g_countThreadId = 0;
+		_CrtSetAllocHook(m_previousHook);
+	}
+
+public:
+	AllocationCounter& operator=(const AllocationCounter&) = delete;
+	AllocationCounter& operator=(AllocationCounter&&) = delete;
+
+public:
+	[[nodiscard]] std::size_t GetAllocations() const noexcept {
+		return g_allocations;
+	}
+
+private:
+	_CRT_ALLOC_HOOK m_previousHook;
+};
+
+/// @brief Format the arguments of a `LogLine` and count the allocations.
+/// @details The arguments are formatted twice and only the second call is counted because the first call adds the
+/// error messages to the cache.
+/// @param logLine The `LogLine`.
+/// @param allocations Receives the number of allocations.
+/// @return The formatted message.
+std::string FormatAndCountAllocations(const LogLine& logLine, std::size_t& allocations) {
+	std::vector<fmt::format_context::format_arg> args;
+	logLine.CopyArgumentsTo(args);
+	const fmt::basic_format_args<fmt::format_context> formatArgs(args.data(), static_cast<fmt::format_args::size_type>(args.size()));
+	fmt::memory_buffer buf;
+
+	fmt::vformat_to(buf, fmt::to_string_view(logLine.GetPattern()), formatArgs);
+	buf.clear();
+	{
+		const AllocationCounter counter;
+		fmt::vformat_to(buf, fmt::to_string_view(logLine.GetPattern()), formatArgs);
+		allocations = counter.GetAllocations();
+	}
+	return fmt::to_string(buf);
+}
+
+}  // namespace
+
+TEST(winapi_log_Test, Format_MarkerAndWindowsTypes_NoAllocation) {
+	LogLine logLine = GetLogLine("{} {:>6} {:?none} {} {:%} {:x} {: >4}");
+	{
+		const char* const arg = nullptr;
+		logLine << "Test" << L"ab" << arg << error_code{ERROR_ACCESS_DENIED} << error_code{ERROR_ACCESS_DENIED} << error_code{E_INVALIDARG} << POINT{-10, 20};
+	}
+	std::size_t allocations = 0;
+	const std::string str = FormatAndCountAllocations(logLine, allocations);
+
+	EXPECT_EQ(0u, allocations);
+	EXPECT_THAT(str, t::MatchesRegex("Test     ab none .+\\S \\(5\\) .+\\S .+\\S \\(80070057\\) \\( -10,   20\\)"));
+}
+
+TEST(winapi_log_Test, Format_NullValues_NoAllocation) {
+	LogLine logLine = GetLogLine("{} {:?none} {: > 04?nullptr} {:?null}");
+	{
+		const char* const str = nullptr;
+		const POINT* const point = nullptr;
+		const RECT* const rect = nullptr;
+		logLine << str << point << rect << rect;
+	}
+	std::size_t allocations = 0;
+	const std::string str = FormatAndCountAllocations(logLine, allocations);
+
+	EXPECT_EQ(0u, allocations);
+	EXPECT_EQ("(null) none nullptr null", str);
+}
+
+TEST(winapi_log_Test, Format_PointAndRect_NoAllocation) {
+	LogLine logLine = GetLogLine("{} {: > 04} {} {: > 04}");
+	{
+		const POINT point = {-10, 20};
+		const RECT rect = {-10, 20, 30, 40};
+		logLine << point << &point << rect << &rect;
+	}
+	std::size_t allocations = 0;
+	const std::string str = FormatAndCountAllocations(logLine, allocations);
+
+	EXPECT_EQ(0u, allocations);
+	EXPECT_EQ("(-10, 20) (-010,  020) ((-10, 20) - (30, 40)) ((-010,  020) - ( 030,  040))", str);
+}
+
+#endif
+
 }  // namespace llamalog::test